@@ -35,6 +35,9 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte  4KB
 // static constexpr int BUFFER_POOL_SIZE = 65536;                                // size of buffer pool 256MB
 static constexpr int BUFFER_POOL_SIZE = 262144 * 4.5;                                // size of buffer pool 1GB
+static constexpr int BUFFER_POOL_MAX_SIZE = 262144 * 16;                      // rmdb默认可在线扩容到的最大帧数 16GB, 启动时只预留地址空间
+static constexpr int BUFFER_POOL_CHUNK_SIZE = 8192;                           // 在线调整缓冲池大小时每次增减的帧数 32MB
+static constexpr int PAGE_TABLE_PARTITIONS = 64;                              // number of independently latched page table partitions
 // static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
 static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
@@ -53,5 +56,67 @@ static const std::string LOG_FILE_NAME = "db.log";
 
 // replacer
 static const std::string REPLACER_TYPE = "LRU";
+static constexpr int LRUK_K = 2;                                              // LRU-K中的K, 至少被访问K次的帧才进入缓存队列
+static constexpr int LRUK_CORRELATED_PERIOD = 16;                             // 相关访问窗口(以访问次数计), 窗口内的重复访问只算一次
+
+// async io
+static constexpr int ASYNC_IO_QUEUE_DEPTH = 128;                              // io_uring提交队列的深度
+static constexpr int ASYNC_IO_WORKERS = 4;                                    // 不支持io_uring时pread/pwrite工作线程的数量
+
+// read ahead
+static constexpr int READ_AHEAD_PAGES = 64;                                   // 顺序扫描每次预读的页面数
+static constexpr int PREFETCH_QUEUE_LIMIT = 16;                               // 预读请求队列的最大长度, 超出时丢弃新的请求
+
+// page cleaner
+static constexpr double PAGE_CLEANER_CLEAN_RATIO = 0.05;                      // 后台写线程在淘汰端保持干净的帧占缓冲池的比例, 为0时不启动后台写线程
+static constexpr auto PAGE_CLEANER_INTERVAL = std::chrono::milliseconds(20);  // 后台写线程两轮之间的最长间隔
+
+// buffer pool arena
+static constexpr bool BUFFER_POOL_USE_HUGE_PAGES = true;                      // 缓冲池页面数据是否尝试使用大页
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;                     // MAP_HUGETLB大页的大小 2MB
+
+// direct io
+static constexpr bool DATA_FILE_DIRECT_IO = false;                            // 表和索引文件是否默认使用O_DIRECT绕过内核页缓存, 可用rmdb -d开启
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;                           // O_DIRECT要求的缓冲区地址、文件偏移和读写长度的对齐粒度
+
+// warm restart
+static const std::string BUFFER_POOL_HOT_PAGES_NAME = "buffer_pool.hot";      // 按热度排列的缓冲池页面列表, 重启后据此预热
+static constexpr auto HOT_PAGES_DUMP_INTERVAL = std::chrono::seconds(60);     // 定期保存页面列表的间隔
+static constexpr int WARM_UP_BATCH_PAGES = 256;                               // 预热时一个读批次最多包含的页面数
+
+// optimistic latch
+static constexpr int OPTIMISTIC_READ_RETRIES = 8;                             // 乐观读版本号校验失败的最大重试次数, 超过后加读锁读取
+static constexpr int OPTIMISTIC_WRITE_RETRIES = 8;                            // B+树插入删除乐观下降到叶子结点的最大重试次数, 超过后持有root_latch_执行
+
+// index search
+static constexpr int IX_SIMD_SCAN_KEYS = 64;                                  // INT索引结点内二分查找缩小到这么多个key以内后改用SIMD扫描
+static constexpr bool IX_KEY_PREFIX_COMPRESSION = true;                        // 新建的只含CHAR字段的索引是否对结点中的key做前缀压缩
+
+// index bulk load
+static constexpr size_t IX_BULK_SORT_MEMORY = 256 * 1024 * 1024;              // 批量建立B+树时外部排序在内存中暂存的最大字节数 256MB
+static constexpr double IX_BULK_LOAD_FILL_FACTOR = 0.9;                       // 批量建立B+树时每个结点的填充率, 留出的空位供之后的插入使用
+
+// bitmap heap scan
+static constexpr int BITMAP_HEAP_SCAN_MIN_RIDS = 256;                         // 索引范围扫描命中的rid达到这么多时, 按页面排序后回表, 每个页面只读一次
+
+// hash index
+static constexpr int HASH_INDEX_MAX_GLOBAL_DEPTH = 19;                        // 哈希索引目录的最大全局深度, 桶达到这个局部深度后不再分裂, 改为链接溢出页面
+
+// bloom filter
+static constexpr bool IX_BLOOM_FILTER = true;                                 // 是否为每个索引维护内存中的布隆过滤器, 插入时先查过滤器再做唯一性检查
+static constexpr bool IX_BLOOM_FILTER_PERSIST = true;                         // 关闭数据库时是否把过滤器写到索引文件旁的.bloom文件, 下次打开时不用扫描索引重建
+static constexpr int IX_BLOOM_BITS_PER_KEY = 10;                              // 每个key占用的位数, 误判率约1%
+static constexpr int IX_BLOOM_NUM_HASHES = 7;                                 // 每个key置位的个数
+static constexpr uint64_t IX_BLOOM_MIN_BITS = 1 << 16;                        // 过滤器的最小位数 8KB
+static constexpr int IX_BLOOM_GROWTH_FACTOR = 4;                              // 插入时过滤器写满, 换上的新过滤器按已加入key数量的这个倍数分配
+
+// online index build
+static constexpr int ONLINE_INDEX_BUILD_THREADS = 8;                          // 在线建立索引时并行扫描表的最大线程数
+static constexpr size_t ONLINE_INDEX_CATCHUP_ENTRIES = 1024;                  // 旁路日志中的写操作少于这么多时, 持有元数据写锁重放剩余部分并发布索引
+
+// load
+static constexpr size_t LOAD_CHUNK_SIZE = 4 * 1024 * 1024;                    // LOAD每次从CSV文件读取的字节数 4MB, 在行边界切分后交给一个解析线程
+static constexpr int LOAD_PARSER_THREADS = 4;                                 // LOAD解析CSV的最大线程数
+static constexpr int LOAD_PIPELINE_DEPTH = 8;                                 // 已读入但还没有写入表的块数上限
 
 static const std::string DB_META_NAME = "db.meta";
@@ -0,0 +1,261 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "csv_loader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "errors.h"
+
+CsvLoader::CsvLoader(const std::string &file_name, const std::vector<ColMeta> &cols, int record_size)
+    : cols_(cols), record_size_(record_size) {
+    file_ = fopen(file_name.c_str(), "rb");
+    if (file_ == nullptr) {
+        throw FileNotFoundError(file_name);
+    }
+    // 写入阶段占用调用者的线程, 其余的核用于解析
+    int num_parsers = std::min(LOAD_PARSER_THREADS, std::max(1, (int)std::thread::hardware_concurrency() - 1));
+    reader_ = std::thread(&CsvLoader::read_loop, this);
+    for (int i = 0; i < num_parsers; ++i) {
+        parsers_.emplace_back(&CsvLoader::parse_loop, this);
+    }
+}
+
+CsvLoader::~CsvLoader() {
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stopped_ = true;
+    }
+    read_cv_.notify_all();
+    parse_cv_.notify_all();
+    reader_.join();
+    for (auto &parser : parsers_) {
+        parser.join();
+    }
+    fclose(file_);
+}
+
+/**
+ * @description: 按文件中的顺序取出下一块解析好的记录, 读线程或解析线程出错时在这里抛出异常
+ * @param {Batch*} batch 传出参数
+ * @return {bool} 文件是否还有数据
+ */
+bool CsvLoader::next(Batch *batch) {
+    std::unique_lock<std::mutex> lock(latch_);
+    result_cv_.wait(lock, [&]() { return error_ || results_.count(next_seq_) || (read_done_ && next_seq_ == num_read_); });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    auto iter = results_.find(next_seq_);
+    if (iter == results_.end()) {
+        return false;
+    }
+    *batch = std::move(iter->second);
+    results_.erase(iter);
+    next_seq_++;
+    read_cv_.notify_one();
+    return true;
+}
+
+void CsvLoader::fail(std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        if (!error_) {
+            error_ = error;
+        }
+        stopped_ = true;
+    }
+    read_cv_.notify_all();
+    parse_cv_.notify_all();
+    result_cv_.notify_all();
+}
+
+/**
+ * @description: 读线程, 每次读LOAD_CHUNK_SIZE字节, 跳过第一行表头, 最后一个换行符之后不完整的行留到下一块
+ */
+void CsvLoader::read_loop() {
+    try {
+        std::vector<char> carry;
+        bool skip_header = true;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(latch_);
+                read_cv_.wait(lock, [&]() { return stopped_ || num_read_ < next_seq_ + LOAD_PIPELINE_DEPTH; });
+                if (stopped_) {
+                    return;
+                }
+            }
+            std::vector<char> data;
+            data.swap(carry);
+            size_t old_size = data.size();
+            data.resize(old_size + LOAD_CHUNK_SIZE);
+            size_t n = fread(data.data() + old_size, 1, LOAD_CHUNK_SIZE, file_);
+            if (n == 0 && ferror(file_)) {
+                throw UnixError();
+            }
+            data.resize(old_size + n);
+            bool eof = n == 0;
+            if (skip_header) {
+                auto header_end = static_cast<const char *>(memchr(data.data(), '\n', data.size()));
+                if (header_end == nullptr) {
+                    if (eof) {
+                        break;
+                    }
+                    carry.swap(data);
+                    continue;
+                }
+                data.erase(data.begin(), data.begin() + (header_end - data.data() + 1));
+                skip_header = false;
+            }
+            if (!eof) {
+                auto last = static_cast<const char *>(memrchr(data.data(), '\n', data.size()));
+                if (last == nullptr) {
+                    // 一行比一块还长, 继续读
+                    carry.swap(data);
+                    continue;
+                }
+                size_t len = last - data.data() + 1;
+                carry.assign(data.begin() + len, data.end());
+                data.resize(len);
+            }
+            if (!data.empty()) {
+                std::lock_guard<std::mutex> guard(latch_);
+                chunks_.push_back({num_read_++, std::move(data)});
+                parse_cv_.notify_one();
+            }
+            if (eof) {
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            read_done_ = true;
+        }
+        parse_cv_.notify_all();
+        result_cv_.notify_all();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+/**
+ * @description: 解析线程, 取出一块解析后放进results_, 由next()按块的顺序取走
+ */
+void CsvLoader::parse_loop() {
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(latch_);
+            parse_cv_.wait(lock, [&]() { return stopped_ || !chunks_.empty() || read_done_; });
+            if (stopped_ || chunks_.empty()) {
+                return;
+            }
+            chunk = std::move(chunks_.front());
+            chunks_.pop_front();
+        }
+        Batch batch;
+        try {
+            parse_chunk(chunk, &batch);
+        } catch (...) {
+            fail(std::current_exception());
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            results_.emplace(chunk.seq, std::move(batch));
+        }
+        result_cv_.notify_all();
+    }
+}
+
+/**
+ * @description: 把一块中的每一行按逗号切分, 各字段转换后写到记录中对应的位置
+ */
+void CsvLoader::parse_chunk(const Chunk &chunk, Batch *batch) const {
+    const char *p = chunk.data.data();
+    const char *end = p + chunk.data.size();
+    batch->records.reserve((std::count(p, end, '\n') + 1) * record_size_);
+    while (p < end) {
+        auto eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        const char *line_end = eol;
+        if (line_end > p && line_end[-1] == '\r') {
+            line_end--;
+        }
+        size_t offset = batch->records.size();
+        batch->records.resize(offset + record_size_);
+        char *rec = batch->records.data() + offset;
+        const char *field = p;
+        for (size_t i = 0; i < cols_.size(); ++i) {
+            auto comma = static_cast<const char *>(memchr(field, ',', line_end - field));
+            bool last = i + 1 == cols_.size();
+            if (last == (comma != nullptr)) {
+                throw InvalidValueCountError();
+            }
+            const char *field_end = last ? line_end : comma;
+            parse_field(cols_[i], field, field_end, rec + cols_[i].offset);
+            field = field_end + 1;
+        }
+        batch->num_records++;
+        p = eol + 1;
+    }
+}
+
+/**
+ * @description: 把一个字段转换成列的存储格式写到dst, dst已清零
+ * 整数和浮点数用from_chars解析, 不常见的写法(前导空白、正号等)交给strtoll/strtof, 结果与逐个字段setData()相同
+ */
+void CsvLoader::parse_field(const ColMeta &col, const char *begin, const char *end, char *dst) const {
+    size_t len = end - begin;
+    if (col.type == TYPE_STRING || col.type == TYPE_DATETIME) {
+        if (len > (size_t)col.len) {
+            throw StringOverflowError();
+        }
+        memcpy(dst, begin, len);
+        return;
+    }
+    char buf[64];
+    auto slow_path = [&]() {
+        size_t n = std::min(len, sizeof(buf) - 1);
+        memcpy(buf, begin, n);
+        buf[n] = '\0';
+        return buf;
+    };
+    if (col.type == TYPE_FLOAT) {
+        float val;
+        auto res = std::from_chars(begin, end, val);
+        if (res.ec != std::errc()) {
+            val = strtof(slow_path(), nullptr);
+        }
+        memcpy(dst, &val, sizeof(float));
+        return;
+    }
+    long long val;
+    auto res = std::from_chars(begin, end, val);
+    if (res.ec != std::errc()) {
+        errno = 0;
+        val = strtoll(slow_path(), nullptr, 10);
+        if (errno) {
+            throw ResultOutOfRangeError();
+        }
+    }
+    if (col.type == TYPE_INT) {
+        int int_val = static_cast<int>(val);
+        memcpy(dst, &int_val, sizeof(int));
+    } else {
+        memcpy(dst, &val, sizeof(long long));
+    }
+}
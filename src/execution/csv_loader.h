@@ -0,0 +1,80 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "system/sm_meta.h"
+
+/* LOAD读取CSV文件的流水线
+ * 读线程按大块读文件, 在行边界切分; 多个解析线程把各块中的行直接转换成表的记录格式; 调用者(写入阶段)按文件中的顺序取出记录写入表.
+ * 已读入但还没有被取走的块最多LOAD_PIPELINE_DEPTH个, 写入慢时读和解析会停下来等待 */
+class CsvLoader {
+   public:
+    /* 一块数据解析出的记录, 每条record_size字节, 连续存放 */
+    struct Batch {
+        std::vector<char> records;
+        int num_records = 0;
+    };
+
+   private:
+    /* 读线程切分出的一块数据, 只包含完整的行 */
+    struct Chunk {
+        size_t seq;
+        std::vector<char> data;
+    };
+
+    FILE *file_;
+    std::vector<ColMeta> cols_;
+    int record_size_;
+
+    std::mutex latch_;
+    std::condition_variable read_cv_;       // 等待写入阶段取走数据, 腾出流水线的空间
+    std::condition_variable parse_cv_;      // 等待新的块
+    std::condition_variable result_cv_;     // 等待下一块的解析结果
+    std::deque<Chunk> chunks_;              // 等待解析的块
+    std::map<size_t, Batch> results_;       // 解析完成、等待按顺序取走的块
+    size_t num_read_ = 0;                   // 读线程已切分出的块数
+    size_t next_seq_ = 0;                   // 下一个要取走的块
+    bool read_done_ = false;
+    bool stopped_ = false;
+    std::exception_ptr error_;              // 读线程或解析线程遇到的第一个错误
+
+    std::thread reader_;
+    std::vector<std::thread> parsers_;
+
+   public:
+    CsvLoader(const std::string &file_name, const std::vector<ColMeta> &cols, int record_size);
+
+    ~CsvLoader();
+
+    bool next(Batch *batch);
+
+   private:
+    void read_loop();
+
+    void parse_loop();
+
+    void parse_chunk(const Chunk &chunk, Batch *batch) const;
+
+    void parse_field(const ColMeta &col, const char *begin, const char *end, char *dst) const;
+
+    void fail(std::exception_ptr error);
+};
@@ -25,8 +25,11 @@ const char *help_info = "Supported SQL syntax:\n"
                    "command:\n"
                    "  CREATE TABLE table_name (column_name type [, column_name type ...])\n"
                    "  DROP TABLE table_name\n"
-                   "  CREATE INDEX table_name (column_name)\n"
+                   "  CREATE INDEX table_name (column_name) [INCLUDE (column_name [, column_name ...])]\n"
+                   "  CREATE INDEX table_name (column_name) USING HASH\n"
                    "  DROP INDEX table_name (column_name)\n"
+                   "  SHOW SPACE\n"
+                   "  SHOW INDEX STATS\n"
                    "  INSERT INTO table_name VALUES (value [, value ...])\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
@@ -60,24 +63,9 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
             }
             case T_CreateIndex:
             {
-                sm_manager_->create_index(x->tab_name_, x->tab_col_names_, context);
-                // 创建索引时将当前表中的所有tuple插入到B+树中
-                std::unique_ptr<SeqScanExecutor> exec = std::make_unique<SeqScanExecutor>(sm_manager_, x->tab_name_, std::vector<Condition>(), context);
-                // open index
-                auto ih_ptr = sm_manager_->get_ix_manager()->open_index(x->tab_name_, x->tab_col_names_ );
-                sm_manager_->ihs_.emplace(sm_manager_->get_ix_manager()->get_index_name(x->tab_name_, x->tab_col_names_), std::move(ih_ptr));
-                auto index = sm_manager_->db_.get_table(x->tab_name_).get_index_meta(x->tab_col_names_);
-                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(x->tab_name_, x->tab_col_names_)).get();
-                for(exec->beginTuple(); !exec->is_end() ; exec->nextTuple()){
-                    auto rec = exec->Next(); 
-                    char* key = new char[(*index).col_tot_len];
-                    int offset = 0;
-                    for(size_t i = 0; i < (size_t)(*index).col_num; ++i) {
-                        memcpy(key + offset, rec->data + (*index).cols[i].offset, (*index).cols[i].len);
-                        offset += (*index).cols[i].len;
-                    }
-                    ih->insert_entry(key, exec->rid(), context->txn_);
-                }
+                auto build = sm_manager_->create_index(x->tab_name_, x->tab_col_names_, x->include_col_names_, x->using_hash_, context);
+                // 扫描表中已有的tuple建立索引, 期间不阻塞修改这张表的语句, 建好后发布到元数据中
+                sm_manager_->build_index(build, context);
                 break;
             }
             case T_DropIndex:
@@ -105,6 +93,8 @@ void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Co
             case T_Set:{
                 if (x->tab_name_ == "output_file")
                     enable_output_file = x->value_[0] - '0';
+                else if (x->tab_name_ == "buffer_pool_size")
+                    sm_manager_->get_bpm()->resize(std::stoul(x->value_));
                 break;
             }
             case T_ShowTable:
@@ -117,6 +107,16 @@ void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Co
                 sm_manager_->show_index(x->tab_name_, context);
                 break;
             }
+            case T_ShowSpace:
+            {
+                sm_manager_->show_space(context);
+                break;
+            }
+            case T_ShowIndexStats:
+            {
+                sm_manager_->show_index_stats(context);
+                break;
+            }
             case T_DescTable:
             {
                 sm_manager_->desc_table(x->tab_name_, context);
@@ -71,6 +71,7 @@ class DeleteExecutor : public AbstractExecutor {
                 sm_manager_->get_bpm()->unpin_page({fh_->GetFd(), rid.page_no}, true);
             }
             fh_->delete_record(rid, context_);
+            sm_manager_->log_index_write(tab_name_, false, Tuple->data, rid);
         }
         return nullptr;
     }
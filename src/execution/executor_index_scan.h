@@ -27,12 +27,19 @@ class IndexScanExecutor : public AbstractExecutor {
     std::vector<Condition> fed_conds_;          // 扫描条件，和conds_字段相同
     std::vector<ColMeta> lhs_cols_meta;       // condition列的meta
 
-    IxIndexHandle *ix_;                          // 索引的数据文件句柄
+    IxIndexHandle *ix_;                          // 索引的数据文件句柄, 哈希索引时为nullptr
+    IxHashHandle *hash_;                        // 哈希索引的文件句柄, B+树索引时为nullptr
     std::vector<std::string> index_col_names_;  // index scan涉及到的索引包含的字段
     IndexMeta index_meta_;                      // index scan涉及到的索引元数据
+    bool index_only_;                           // 只读索引不回表, 记录中只填充索引包含的字段
+    std::vector<char> index_key_;               // index only scan读出的key
 
-    std::vector<Rid> rids_;
-    size_t rids_offset;
+    bool bitmap_heap_scan_;                     // 先取出范围内的全部rid, 数量较多时按页面排序后回表
+    std::vector<Rid> rids_;                     // bitmap heap scan待回表的rid
+    size_t rids_offset;                         // rids_中下一个待读取的位置
+    std::vector<std::unique_ptr<RmRecord>> batch_;  // bitmap heap scan从同一个页面读出的满足条件的记录
+    std::vector<Rid> batch_rids_;               // batch_中记录对应的rid
+    size_t batch_pos_;                          // batch_中当前记录的位置
     Rid rid_;
     // std::unique_ptr<RecScan> scan_;
     std::unique_ptr<IxScan> ix_scan_;
@@ -40,7 +47,7 @@ class IndexScanExecutor : public AbstractExecutor {
 
    public:
     IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, std::vector<std::string> index_col_names,
-                    Context *context) {
+                    Context *context, bool index_only = false, bool bitmap_heap_scan = false) {
         sm_manager_ = sm_manager;
         context_ = context;
         tab_name_ = std::move(tab_name);
@@ -49,8 +56,16 @@ class IndexScanExecutor : public AbstractExecutor {
         // index_no_ = index_no;
         index_col_names_ = index_col_names; 
         index_meta_ = *(tab_.get_index_meta(index_col_names_));
+        // 哈希索引只做等值查找, 查到的rid按bitmap heap scan的方式回表
+        index_only_ = index_only && !index_meta_.is_hash;
+        bitmap_heap_scan_ = (bitmap_heap_scan && !index_only_) || index_meta_.is_hash;
+        rids_offset = 0;
+        batch_pos_ = 0;
+        index_key_.resize(index_meta_.col_tot_len);
         fh_ = sm_manager_->fhs_.at(tab_name_).get();
-        ix_ = sm_manager_->ihs_.at(sm_manager->get_ix_manager()->get_index_name(tab_name_, index_col_names_)).get();
+        IxHandle *ih = sm_manager_->ihs_.at(sm_manager->get_ix_manager()->get_index_name(tab_name_, index_meta_.cols)).get();
+        ix_ = dynamic_cast<IxIndexHandle *>(ih);
+        hash_ = dynamic_cast<IxHashHandle *>(ih);
         cols_ = tab_.cols;
         len_ = cols_.back().offset + cols_.back().len;
         std::map<CompOp, CompOp> swap_op = {
@@ -97,6 +112,10 @@ class IndexScanExecutor : public AbstractExecutor {
     // 从seq_scan中拷贝
     bool check_cond(){
         std::unique_ptr<RmRecord> Tuple = Next();
+        return check_cond(Tuple.get());
+    }
+
+    bool check_cond(const RmRecord *Tuple){
         // TabMeta &lhs_tab = sm_manager_->db_.get_table(tab_name_);
         // for(auto &cond: conds_){
         for(size_t i=0; i<conds_.size(); i++){
@@ -194,8 +213,7 @@ class IndexScanExecutor : public AbstractExecutor {
         // 索引扫描，给表上意向读锁
         // context_->lock_mgr_->lock_IS_on_table(context_->txn_, fh_->GetFd());
         context_->lock_mgr_->lock_shared_on_table(context_->txn_, fh_->GetFd());
-        
-        IxIndexHandle* ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_col_names_)).get();
+
         // 这里设置ix_scan的lowwer和uppper，注意: 当前的设置只适用于planner.cpp中的索引匹配规则get_index_cols()
         // assert(conds_.size() == index_col_names_.size());
         char* min_key = new char[index_meta_.col_tot_len];
@@ -203,7 +221,7 @@ class IndexScanExecutor : public AbstractExecutor {
         // 构造等值索引的key，注意，这里conds的顺序可能和索引顺序是不一致的
         int offset = 0;
         size_t cond_j = 0;
-        for(size_t i = 0; i < (size_t)index_meta_.col_num; ++i) {
+        for(size_t i = 0; i < (size_t)index_meta_.key_num(); ++i) {
             bool max_set = false;
             bool min_set = false;
             bool equ_set = false;
@@ -262,7 +280,7 @@ class IndexScanExecutor : public AbstractExecutor {
                 setMaxKey(max_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                 setMinKey(min_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                 offset += index_meta_.cols[i++].len;
-                while (i<(size_t)index_meta_.col_num){
+                while (i<(size_t)index_meta_.key_num()){
                     setMaxKey(max_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     setMinKey(min_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     offset += index_meta_.cols[i++].len;
@@ -272,7 +290,7 @@ class IndexScanExecutor : public AbstractExecutor {
             else if(!max_set){
                 setMaxKey(max_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                 offset += index_meta_.cols[i++].len;
-                while (i<(size_t)index_meta_.col_num){
+                while (i<(size_t)index_meta_.key_num()){
                     setMaxKey(max_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     setMinKey(min_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     offset += index_meta_.cols[i++].len;
@@ -282,7 +300,7 @@ class IndexScanExecutor : public AbstractExecutor {
             else if(!min_set){
                 setMinKey(min_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                 offset += index_meta_.cols[i++].len;
-                while (i<(size_t)index_meta_.col_num){
+                while (i<(size_t)index_meta_.key_num()){
                     setMaxKey(max_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     setMinKey(min_key, offset, index_meta_.cols[i].len, index_meta_.cols[i].type);
                     offset += index_meta_.cols[i++].len;
@@ -293,25 +311,52 @@ class IndexScanExecutor : public AbstractExecutor {
                 offset += index_meta_.cols[i].len;
             }
         }
+        // INCLUDE字段不限制扫描范围, 在B+树中按字节比较, 取全0和全0xff
+        std::fill(min_key + index_meta_.key_tot_len(), min_key + index_meta_.col_tot_len, 0x00);
+        std::fill(max_key + index_meta_.key_tot_len(), max_key + index_meta_.col_tot_len, 0xff);
+
+        if(hash_ != nullptr){
+            // planner只在所有key字段都是等值条件时选择哈希索引, min_key就是完整的key
+            rids_.clear();
+            hash_->get_value(min_key, &rids_, context_->txn_);
+            rids_offset = 0;
+            load_batch();
+            delete[] min_key;
+            delete[] max_key;
+            return;
+        }
         // Iid lower_bound, upper_bound;
         
-        Iid lower_bound = ih->lower_bound(min_key);
-        Iid upper_bound = ih->upper_bound(max_key);
+        Iid lower_bound = ix_->lower_bound(min_key);
+        Iid upper_bound = ix_->upper_bound(max_key);
 
         // 这里对表一次性上间隙锁
         // ih->gap_lock(min_key, max_key, rids_, context_, fh_->GetFd());
 
-        for(ix_scan_ = std::make_unique<IxScan>(ih,lower_bound,upper_bound,sm_manager_->get_bpm()); !is_end(); ix_scan_->next()){
-            // context_->lock_mgr_->lock_gap_on_index(context_->txn_, ix_scan_->rid(), ix_->GetFd());
-            // context_->lock_mgr_->lock_shared_on_record(context_->txn_, ix_scan_->rid(), fh_->GetFd());
-            if(!check_cond()) continue;
-            else break;
-        };
-
-        for(rids_offset =0; rids_offset < rids_.size(); rids_offset++){
-            rid_ = rids_[rids_offset];
-            if(!check_cond()) continue;
-            else break;
+        if(bitmap_heap_scan_){
+            // 叶子结点是按key有序的, rid在堆表中可能分散在各处; 先只读叶子结点取出全部rid
+            rids_.clear();
+            for(ix_scan_ = std::make_unique<IxScan>(ix_,lower_bound,upper_bound,sm_manager_->get_bpm()); !ix_scan_->is_end(); ix_scan_->next()){
+                rids_.push_back(ix_scan_->rid());
+            }
+            // rid较多时按页面排序, 同一页面上的记录连在一起, 每个页面只读一次, 页面按文件中的顺序访问
+            // 排序后输出不再按key有序, 需要有序时上层有SortPlan
+            if(rids_.size() >= (size_t)BITMAP_HEAP_SCAN_MIN_RIDS){
+                std::sort(rids_.begin(), rids_.end(), [](const Rid &a, const Rid &b) {
+                    return a.page_no < b.page_no || (a.page_no == b.page_no && a.slot_no < b.slot_no);
+                });
+                rids_.erase(std::unique(rids_.begin(), rids_.end()), rids_.end());
+            }
+            rids_offset = 0;
+            load_batch();
+        }
+        else{
+            for(ix_scan_ = std::make_unique<IxScan>(ix_,lower_bound,upper_bound,sm_manager_->get_bpm()); !is_end(); ix_scan_->next()){
+                // context_->lock_mgr_->lock_gap_on_index(context_->txn_, ix_scan_->rid(), ix_->GetFd());
+                // context_->lock_mgr_->lock_shared_on_record(context_->txn_, ix_scan_->rid(), fh_->GetFd());
+                if(!check_cond()) continue;
+                else break;
+            };
         }
 
         delete[] min_key;
@@ -320,7 +365,43 @@ class IndexScanExecutor : public AbstractExecutor {
         return;
     }
 
+    /**
+     * @brief bitmap heap scan从rids_offset开始逐个页面读取记录, 直到读到满足条件的记录或者rids_读完
+     * 同一页面上连续的rid只fetch一次页面
+     */
+    void load_batch() {
+        batch_.clear();
+        batch_rids_.clear();
+        batch_pos_ = 0;
+        std::vector<std::unique_ptr<RmRecord>> records;
+        while(batch_.empty() && rids_offset < rids_.size()){
+            size_t end = rids_offset + 1;
+            while(end < rids_.size() && rids_[end].page_no == rids_[rids_offset].page_no) end++;
+            records.clear();
+            fh_->get_page_records(&rids_[rids_offset], end - rids_offset, &records);
+            for(size_t i = 0; i < records.size(); i++){
+                if(check_cond(records[i].get())){
+                    batch_.push_back(std::move(records[i]));
+                    batch_rids_.push_back(rids_[rids_offset + i]);
+                }
+            }
+            rids_offset = end;
+        }
+        if(!batch_.empty()){
+            rid_ = batch_rids_[0];
+        }
+    }
+
     void nextTuple() override {
+        if(bitmap_heap_scan_){
+            if(++batch_pos_ == batch_.size()){
+                load_batch();
+            }
+            else{
+                rid_ = batch_rids_[batch_pos_];
+            }
+            return;
+        }
         for(ix_scan_->next(); !is_end(); ix_scan_->next()){
             // context_->lock_mgr_->lock_shared_on_record(context_->txn_, ix_scan_->rid(), fh_->GetFd());
             if(!check_cond()) continue;
@@ -336,11 +417,28 @@ class IndexScanExecutor : public AbstractExecutor {
     }
 
     bool is_end() const override { 
+        if(bitmap_heap_scan_){
+            return batch_pos_ >= batch_.size();
+        }
         return ix_scan_->is_end();
         // return rids_offset >= rids_.size();
     }
 
     std::unique_ptr<RmRecord> Next() override {
+        if (bitmap_heap_scan_) {
+            return std::make_unique<RmRecord>(*batch_[batch_pos_]);
+        }
+        if (index_only_) {
+            // 索引覆盖了查询用到的字段, 把key中的字段放回它们在记录中的位置, 其余字段不填充
+            auto rec = std::make_unique<RmRecord>(len_);
+            ix_->read_entry(ix_scan_->iid(), index_key_.data(), &rid_);
+            int offset = 0;
+            for (auto &col : index_meta_.cols) {
+                memcpy(rec->data + col.offset, index_key_.data() + offset, col.len);
+                offset += col.len;
+            }
+            return rec;
+        }
         rid_ = ix_scan_->rid();
         return fh_->get_record(rid_, nullptr);
     }
@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #include "index/ix.h"
 #include "system/sm.h"
 #include "common/tools.h"
+#include "csv_loader.h"
 
 
 class InsertExecutor : public AbstractExecutor {
@@ -27,14 +28,11 @@ class InsertExecutor : public AbstractExecutor {
     Rid rid_;                       // 插入的位置，由于系统默认插入时不指定位置，因此当前rid_在插入后才赋值
     SmManager *sm_manager_;
     std::vector<std::string> index_names_; 
+    std::vector<IxHandle *> load_ihs_;    // load file时表上各个索引的句柄, 建立算子时持有元数据读锁取出, 之后不再查ihs_
+    std::vector<std::unique_ptr<IxExternalSorter>> sorters_;   // load file时空B+树索引的key先排序, 读完文件后批量建立, 其他索引为nullptr
+    bool fast_load_ = true;         // load file时是否不加页面锁地写入当前页面; 表上正在在线建立索引时为false
 
-    FILE* load_file_ = nullptr;
-    char* buffer[2];
-    char* values_buf_;
-    size_t buffer_remain_[2] = {0, 0};
-    size_t cur_pos_ = 0;
-    bool cur_buffer_idx_ = 1;
-    std::vector<ColMeta> all_cols;
+    std::unique_ptr<CsvLoader> loader_;   // load file时读取并解析CSV文件
 
    public:
     InsertExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Value> values, std::string load_file_name, Context *context) : values_(std::move(values)){
@@ -52,72 +50,28 @@ class InsertExecutor : public AbstractExecutor {
 
         if (!load_file_name.empty()) {    
             load_file_name_ = load_file_name;
-            all_cols = sm_manager_->db_.get_table(tab_name_).cols;
-            int maxColWidth = 0;
-            for (auto &col : all_cols) 
-                maxColWidth = (maxColWidth > col.len+1) ? maxColWidth : col.len+1;
-            values_buf_ = (char*)malloc(maxColWidth * sizeof(char));
-            buffer[0] = (char*)malloc(4096 * sizeof(char));
-            buffer[1] = (char*)malloc(4096 * sizeof(char));
-            load_file_ = fopen(load_file_name_.c_str(), "r");
-            assert(load_file_ != nullptr);
-            fill_buffer();
-            cur_buffer_idx_ = 1 - cur_buffer_idx_;
-            fill_buffer();
-            while(getchar_from_buffer() != '\n'); // 跳过第一行
-            values_.resize(all_cols.size());
+            loader_ = std::make_unique<CsvLoader>(load_file_name_, tab_.cols, fh_->get_file_hdr().record_size);
+            // 在线建立索引的线程会并发地乐观读取表的页面, 写入时必须加页面锁更新版本号
+            fast_load_ = !sm_manager_->is_index_building(tab_name_);
+            sorters_.resize(tab_.indexes.size());
+            for(size_t i = 0; i < tab_.indexes.size(); ++i) {
+                load_ihs_.push_back(sm_manager_->ihs_.at(index_names_[i]).get());
+                auto ix = dynamic_cast<IxIndexHandle *>(load_ihs_[i]);
+                if(ix != nullptr && ix->can_bulk_load()){
+                    sorters_[i] = std::make_unique<IxExternalSorter>(ix->get_file_hdr(), index_names_[i] + ".sort");
+                }
+            }
         } else if (values_.size() != tab_.cols.size()) {
             throw InvalidValueCountError();
         }
     };
-    ~InsertExecutor() {
-        if ( !load_file_name_.empty()) {
-            fclose(load_file_);
-            free(values_buf_);
-            free(buffer[0]);
-            free(buffer[1]);
-        }
-    }
-
-    inline bool fill_buffer(){
-        buffer_remain_[1 - cur_buffer_idx_] = fread(buffer[1 - cur_buffer_idx_], 1, 4096, load_file_);
-        return buffer_remain_[1 - cur_buffer_idx_];
-    }
-
-    inline char getchar_from_buffer(){
-        if(cur_pos_ == 4096){
-            cur_pos_ = 0;
-            cur_buffer_idx_ = 1 - cur_buffer_idx_;
-            fill_buffer();
-        }
-        if(cur_pos_ == buffer_remain_[cur_buffer_idx_])
-            return EOF;
-        return buffer[cur_buffer_idx_][cur_pos_++];
-    }
-
-    bool get_values(){
-        size_t colNum = all_cols.size(), col = 0, p;
-        for (char ch = getchar_from_buffer(); ch != EOF && col < colNum; ch = getchar_from_buffer(), ++col) {
-            for (p = 0; (ch != ',' && ch != '\n' && ch != EOF) || (values_buf_[p] = '\0'); ch = getchar_from_buffer())
-                values_buf_[p++] = ch;
-            values_[col].setData(all_cols[col].type, all_cols[col].len, values_buf_, p);
-            if(ch == '\n' || ch == EOF) {
-                ++col;
-                break;
-            }
-        }
-        if (col == 0)return false;
-        else if(col == colNum) return true;
-        else throw InvalidValueCountError();
-    }
 
     std::unique_ptr<RmRecord> Next() override {
-        // for(auto& values: values_){
-            // Make record buffer
-        while(!load_file_ || get_values()){
-        if(values_.size() != tab_.cols.size()){
-            throw InvalidValueCountError();
-        };
+        if(loader_ != nullptr){
+            load();
+            return nullptr;
+        }
+        // Make record buffer
         RmRecord rec(fh_->get_file_hdr().record_size);
         for (size_t i = 0; i < values_.size(); i++) {
             auto &col = tab_.cols[i];
@@ -132,66 +86,36 @@ class InsertExecutor : public AbstractExecutor {
             memcpy(rec.data + col.offset, val.raw.data, col.len);
         }
         // 判断是否唯一索引上的元素是否重复
-        std::vector<char*> index_key;
-        
-        // if(tab_.indexes.size() == 0){
-            // // 没有索引，即没有间隙，直接上X锁
-            // context_->lock_mgr_->lock_exclusive_on_table(context_->txn_, fh_->GetFd());
-        // }
+        std::vector<std::unique_ptr<char[]>> index_key;
 
-        if(!load_file_){
-            context_->lock_mgr_->lock_exclusive_on_table(context_->txn_, fh_->GetFd());
-        }
+        context_->lock_mgr_->lock_exclusive_on_table(context_->txn_, fh_->GetFd());
 
         for(size_t i = 0; i < tab_.indexes.size(); ++i) {
             auto& index = tab_.indexes[i];
-            // auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
             auto ih = sm_manager_->ihs_.at(index_names_[i]).get();
-            char* key = new char[index.col_tot_len];
-            int offset = 0;
-            for(size_t i = 0; i < (size_t)index.col_num; ++i) {
-                memcpy(key + offset, rec.data + index.cols[i].offset, index.cols[i].len);
-                offset += index.cols[i].len;
-            }
-            index_key.push_back(key);
+            index_key.push_back(make_key(index, rec.data));
             std::vector<Rid> tmp_val;
-            // if(values_.size() <= 1){
-            if(!load_file_){
-                // 优化：只有在指令不为load的时候，才需要进行校验
-                if(ih->get_value(key, &tmp_val, nullptr) == true){
-                    // 已经存在
-                    // print header into file
-                    AppendToOutputFile("failure\n");
-                    std::cout << "insert faliure." << std::endl;
-                    return nullptr;
-                }
-
-                // Iid insert_upper_iid = ih->upper_bound(key);
-                // Rid gap_rid = ih->get_rid(insert_upper_iid);
-                // context_->lock_mgr_->try_lock_in_gap(context_->txn_, gap_rid, ih->GetFd());
+            // 带INCLUDE字段的索引只按key字段检查唯一性; 布隆过滤器说key不存在时不用查索引
+            if(ih->may_contain(index_key[i].get()) && ih->get_value_by_prefix(index_key[i].get(), index.key_tot_len(), &tmp_val, nullptr) == true){
+                // 已经存在
+                // print header into file
+                AppendToOutputFile("failure\n");
+                std::cout << "insert faliure." << std::endl;
+                return nullptr;
             }
         }
-        
+
         // Insert into record file
-        if(!load_file_){
-            rid_ = fh_->insert_record(rec.data, context_);
-        }
-        else{
-            // 这里针对load file做了一个优化的insert load record
-            rid_ = fh_->insert_load_record(rec.data, context_);
-        }
+        rid_ = fh_->insert_record(rec.data, context_);
+        sm_manager_->log_index_write(tab_name_, true, rec.data, rid_);
 
-        if(!load_file_){
-            // 只有在指令不为load的时候，才需要上锁并且添加写集
-            // context_->lock_mgr_->lock_exclusive_on_record(context_->txn_, rid_, fh_->GetFd());
-            // 将写入数据添加到写集
-            if(context_->txn_ != nullptr){
-                WriteRecord* write_record = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_);
-                context_->txn_->append_write_record(write_record);
-            }
+        // 将写入数据添加到写集
+        if(context_->txn_ != nullptr){
+            WriteRecord* write_record = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_);
+            context_->txn_->append_write_record(write_record);
         }
 
-        if(!load_file_ && enable_logging){
+        if(enable_logging){
             //写Insert
             InsertLogRecord record(context_->txn_->get_transaction_id(), context_->txn_->get_prev_lsn(), rec, rid_, tab_name_);
             lsn_t lsn = context_->log_mgr_->add_log_to_buffer(&record);
@@ -200,42 +124,85 @@ class InsertExecutor : public AbstractExecutor {
             page->set_page_lsn(lsn);
             sm_manager_->get_bpm()->unpin_page({fh_->GetFd(), rid_.page_no}, true);
         }
-        
+
         // Insert into index
         for(size_t i = 0; i < tab_.indexes.size(); ++i) {
-            // auto& index = tab_.indexes[i];
             auto ih = sm_manager_->ihs_.at(index_names_[i]).get();
-            // auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-            // char* key = new char[index.col_tot_len];
-            // int offset = 0;
-            // for(size_t i = 0; i < (size_t)index.col_num; ++i) {
-            //     memcpy(key + offset, rec.data + index.cols[i].offset, index.cols[i].len);
-            //     offset += index.cols[i].len;
-            // }
-            if(!load_file_){
-                ih->insert_entry(index_key[i], rid_, context_->txn_);
+            ih->insert_entry(index_key[i].get(), rid_, context_->txn_);
+        }
+        return nullptr;
+    }
+
+    Rid &rid() override { return rid_; }
+
+   private:
+    static std::unique_ptr<char[]> make_key(const IndexMeta &index, const char *rec_data) {
+        std::unique_ptr<char[]> key(new char[index.col_tot_len]);
+        int offset = 0;
+        for(size_t i = 0; i < (size_t)index.col_num; ++i) {
+            memcpy(key.get() + offset, rec_data + index.cols[i].offset, index.cols[i].len);
+            offset += index.cols[i].len;
+        }
+        return key;
+    }
+
+    /**
+     * @description: load file, 解析线程把CSV文件转换成记录, 这里按文件中的顺序成批写入表和索引
+     * load不检查唯一性, 不加锁, 不写日志; 只在写一批索引项和旁路日志时持有元数据读锁
+     */
+    void load() {
+        CsvLoader::Batch batch;
+        std::vector<Rid> rids;
+        std::vector<char> key;
+        while(loader_->next(&batch)){
+            const char *records = batch.records.data();
+            int record_size = fh_->get_file_hdr().record_size;
+            rids.resize(batch.num_records);
+            if(fast_load_){
+                // 这里针对load file做了一个优化的insert load record
+                fh_->insert_load_records(records, batch.num_records, rids.data());
             }
             else{
-                ih->insert_entry_for_load(index_key[i], rid_, context_->txn_);
+                for(int j = 0; j < batch.num_records; ++j) {
+                    rids[j] = fh_->insert_record(const_cast<char *>(records + (size_t)j * record_size), context_);
+                }
+            }
+            std::shared_lock<MetaLatch> meta_guard(sm_manager_->meta_latch_);
+            for(int j = 0; j < batch.num_records; ++j) {
+                const char *rec = records + (size_t)j * record_size;
+                sm_manager_->log_index_write(tab_name_, true, rec, rids[j]);
+                // Insert into index
+                for(size_t i = 0; i < tab_.indexes.size(); ++i) {
+                    auto& index = tab_.indexes[i];
+                    key.resize(index.col_tot_len);
+                    int offset = 0;
+                    for(auto &col : index.cols) {
+                        memcpy(key.data() + offset, rec + col.offset, col.len);
+                        offset += col.len;
+                    }
+                    if(sorters_[i] != nullptr){
+                        sorters_[i]->add(key.data(), rids[j]);
+                    }
+                    else{
+                        load_ihs_[i]->insert_entry_for_load(key.data(), rids[j], context_->txn_);
+                    }
+                }
             }
-
-            delete[] index_key[i];
-        }
-        if(!load_file_) return nullptr; // 单条insert 一次退出
         }
-        // load file进行的insert executor算子结束, unpin 最后一个page
-        if(fh_->page_handle_.page != nullptr){
-            sm_manager_->get_bpm()->unpin_page(fh_->page_handle_.page->get_page_id(), true);
-            for (size_t i = 0; i < tab_.indexes.size(); ++i) {
-                auto ih = sm_manager_->ihs_.at(index_names_[i]).get();
-                ih->unpin_n_page();
+        // 文件读完后用排好序的key自底向上建立B+树
+        for(size_t i = 0; i < sorters_.size(); ++i) {
+            if(sorters_[i] != nullptr){
+                sorters_[i]->finish();
+                static_cast<IxIndexHandle *>(load_ihs_[i])->bulk_load(sorters_[i].get());
+                sorters_[i].reset();
             }
-            auto file_hdr = fh_->get_file_hdr();
-            sm_manager_->disk_manager_->write_page(fh_->GetFd(), RM_FILE_HDR_PAGE, (char *)&file_hdr, sizeof(file_hdr));
-            // test del wlach
-            // fh_->page_handle_.page->WUnlatch();
         }
-        return nullptr;
+        // LOAD期间没有其他语句访问这张表, 可以在这里扫描索引, 按导入后的key数量把布隆过滤器重建成一个
+        for (auto ih : load_ihs_) {
+            ih->unpin_n_page();
+            ih->grow_bloom_filter();
+        }
+        // load file进行的insert executor算子结束, unpin 最后一个page
+        fh_->finish_load();
     }
-    Rid &rid() override { return rid_; }
 };
\ No newline at end of file
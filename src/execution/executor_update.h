@@ -137,7 +137,7 @@ class UpdateExecutor : public AbstractExecutor {
                 
                 // 首先检查这个vector中是否有重复的key
                 for(size_t k = j + 1; k < rids_.size(); k++){
-                    if(memcmp(insert_index_key[i][j], insert_index_key[i][k], index.col_tot_len) == 0) {
+                    if(memcmp(insert_index_key[i][j], insert_index_key[i][k], index.key_tot_len()) == 0) {
                         is_index_conflict = true;
                         break;
                     }
@@ -145,9 +145,9 @@ class UpdateExecutor : public AbstractExecutor {
 
                 if(is_index_conflict) break;
 
-                // 之后检查与剩余的索引是否冲突
+                // 之后检查与剩余的索引是否冲突, 布隆过滤器说key不存在时不用查索引
                 std::vector<Rid> tmp_val;
-                if(ih->get_value(insert_index_key[i][j], &tmp_val, context_->txn_) == true){
+                if(ih->may_contain(insert_index_key[i][j]) && ih->get_value_by_prefix(insert_index_key[i][j], index.key_tot_len(), &tmp_val, context_->txn_) == true){
                     is_index_conflict = true;
                     break;
                 }
@@ -182,6 +182,8 @@ class UpdateExecutor : public AbstractExecutor {
                     sm_manager_->get_bpm()->unpin_page({fh_->GetFd(), rids_[k].page_no}, true);
                 }
                 fh_->update_record(rids_[k], new_tuple[k].get()->data, context_);
+                sm_manager_->log_index_write(tab_name_, false, Tuple->data, rids_[k]);
+                sm_manager_->log_index_write(tab_name_, true, new_tuple[k]->data, rids_[k]);
             }
         }
         else{
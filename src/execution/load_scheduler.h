@@ -0,0 +1,124 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* LOAD的准入控制
+ * LOAD在后台线程中执行, 不加锁地写入表和索引, 所以同一张表上不能同时有其他语句或另一个LOAD;
+ * 不同表上的LOAD互不影响, 可以并行. 等待中的LOAD优先于之后到来的语句, 避免一直有语句访问这张表时LOAD等不到 */
+class LoadScheduler {
+   private:
+    struct TableState {
+        int waiting_loads = 0;      // 等待开始的LOAD数量
+        bool loading = false;       // 是否有LOAD正在执行
+        int statements = 0;         // 正在执行的其他语句数量
+    };
+
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, TableState> tables_;
+    int waiting_statements_ = 0;    // 因LOAD而等待的语句数量
+
+    bool is_blocked(const std::vector<std::string> &tab_names) {
+        for (auto &tab_name : tab_names) {
+            auto iter = tables_.find(tab_name);
+            if (iter != tables_.end() && (iter->second.loading || iter->second.waiting_loads > 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release(const std::string &tab_name) {
+        auto &state = tables_[tab_name];
+        if (!state.loading && state.waiting_loads == 0 && state.statements == 0) {
+            tables_.erase(tab_name);
+        }
+    }
+
+   public:
+    /**
+     * @description: 等到表上正在执行的语句和LOAD都结束后开始LOAD
+     * @param {string&} tab_name 导入的表
+     */
+    void begin_load(const std::string &tab_name) {
+        std::unique_lock<std::mutex> lock(latch_);
+        auto &state = tables_[tab_name];
+        state.waiting_loads++;
+        cv_.wait(lock, [&]() { return !state.loading && state.statements == 0; });
+        state.waiting_loads--;
+        state.loading = true;
+    }
+
+    void end_load(const std::string &tab_name) {
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            tables_[tab_name].loading = false;
+            release(tab_name);
+        }
+        cv_.notify_all();
+    }
+
+    /**
+     * @description: 等到语句访问的表上都没有正在执行或等待的LOAD后开始执行语句
+     * @param {vector<string>&} tab_names 语句访问的表, 为空时不等待
+     */
+    void begin_statement(const std::vector<std::string> &tab_names) {
+        if (tab_names.empty()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(latch_);
+        if (is_blocked(tab_names)) {
+            waiting_statements_++;
+            cv_.wait(lock, [&]() { return !is_blocked(tab_names); });
+            waiting_statements_--;
+        }
+        for (auto &tab_name : tab_names) {
+            tables_[tab_name].statements++;
+        }
+    }
+
+    void end_statement(const std::vector<std::string> &tab_names) {
+        if (tab_names.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            for (auto &tab_name : tab_names) {
+                tables_[tab_name].statements--;
+                release(tab_name);
+            }
+        }
+        cv_.notify_all();
+    }
+
+    /**
+     * @description: 表上等待开始的LOAD数量, 测试用来确认LOAD已经在等待
+     */
+    int num_waiting_loads(const std::string &tab_name) {
+        std::lock_guard<std::mutex> guard(latch_);
+        auto iter = tables_.find(tab_name);
+        return iter == tables_.end() ? 0 : iter->second.waiting_loads;
+    }
+
+    /**
+     * @description: 因LOAD而等待的语句数量, 测试用来确认语句已经在等待
+     */
+    int num_waiting_statements() {
+        std::lock_guard<std::mutex> guard(latch_);
+        return waiting_statements_;
+    }
+};
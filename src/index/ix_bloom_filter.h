@@ -0,0 +1,155 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "ix_defs.h"
+
+/* 索引key的布隆过滤器, 插入唯一性检查时先查过滤器, 说key不存在就不用查索引
+ * 只对key字段(不含INCLUDE字段)的前key_len字节取哈希; 删除key时不清除对应的位, 只会多一些误判
+ * 多个线程可以同时add()和may_contain(), 位数组的每个字按原子操作置位 */
+class IxBloomFilter {
+   private:
+    struct FileHdr {
+        uint64_t magic;
+        int key_len;
+        int num_hashes;
+        uint64_t num_bits;
+        uint64_t num_added;
+    };
+    static constexpr uint64_t FILE_MAGIC = 0x524d4442424c4f4fULL;
+
+    int key_len_;
+    int num_hashes_;
+    uint64_t num_bits_;                                 // 2的幂
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    std::atomic<uint64_t> num_added_{0};                // add()的次数, 可能包含重复的key
+
+    IxBloomFilter(int key_len, int num_hashes, uint64_t num_bits)
+        : key_len_(key_len), num_hashes_(num_hashes), num_bits_(num_bits),
+          words_(new std::atomic<uint64_t>[num_bits / 64]) {
+        for (uint64_t i = 0; i < num_bits_ / 64; ++i) {
+            words_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static uint64_t num_bits_for(size_t expected_keys) {
+        uint64_t num_bits = IX_BLOOM_MIN_BITS;
+        while (num_bits < expected_keys * IX_BLOOM_BITS_PER_KEY) {
+            num_bits *= 2;
+        }
+        return num_bits;
+    }
+
+    // 双重哈希: 第i个位置为h1 + i * h2
+    template <typename F>
+    void for_each_bit(const char *key, F &&f) const {
+        uint64_t h = ix_hash_key(key, key_len_);
+        uint64_t h1 = h;
+        uint64_t h2 = (h >> 32) | (h << 32) | 1;
+        for (int i = 0; i < num_hashes_; ++i) {
+            uint64_t bit = (h1 + i * h2) & (num_bits_ - 1);
+            if (!f(words_[bit / 64], 1ULL << (bit % 64))) {
+                return;
+            }
+        }
+    }
+
+   public:
+    /**
+     * @param key_len 参与过滤的key前缀长度
+     * @param expected_keys 预计的key数量, 位数组按每个key IX_BLOOM_BITS_PER_KEY位分配
+     */
+    IxBloomFilter(int key_len, size_t expected_keys)
+        : IxBloomFilter(key_len, IX_BLOOM_NUM_HASHES, num_bits_for(expected_keys)) {}
+
+    int get_key_len() const { return key_len_; }
+
+    // 误判率还在设计范围内时最多能容纳的key数量
+    size_t capacity() const { return num_bits_ / IX_BLOOM_BITS_PER_KEY; }
+
+    size_t num_added() const { return num_added_.load(std::memory_order_relaxed); }
+
+    void add(const char *key) {
+        num_added_.fetch_add(1, std::memory_order_relaxed);
+        for_each_bit(key, [](std::atomic<uint64_t> &word, uint64_t mask) {
+            if (!(word.load(std::memory_order_relaxed) & mask)) {
+                word.fetch_or(mask, std::memory_order_relaxed);
+            }
+            return true;
+        });
+    }
+
+    /**
+     * @description: key是否可能存在, 返回false时key一定不在索引中
+     * 调用者持有表锁, 与插入这个key的线程之间已经同步, 所以可以用relaxed读
+     */
+    bool may_contain(const char *key) const {
+        bool found = true;
+        for_each_bit(key, [&](std::atomic<uint64_t> &word, uint64_t mask) {
+            found = word.load(std::memory_order_relaxed) & mask;
+            return found;
+        });
+        return found;
+    }
+
+    /**
+     * @description: 关闭索引时把过滤器写到文件中, 下次打开时不用扫描索引重建
+     */
+    void save(const std::string &file_name) const {
+        FILE *file = fopen(file_name.c_str(), "wb");
+        if (file == nullptr) {
+            return;
+        }
+        FileHdr hdr = {FILE_MAGIC, key_len_, num_hashes_, num_bits_, num_added()};
+        bool ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1;
+        for (uint64_t i = 0; ok && i < num_bits_ / 64; ++i) {
+            uint64_t word = words_[i].load(std::memory_order_relaxed);
+            ok = fwrite(&word, sizeof(word), 1, file) == 1;
+        }
+        fclose(file);
+        if (!ok) {
+            remove(file_name.c_str());
+        }
+    }
+
+    /**
+     * @description: 读入save()保存的过滤器
+     * @return {unique_ptr<IxBloomFilter>} 文件不存在、不完整或key长度不一致时为nullptr
+     */
+    static std::unique_ptr<IxBloomFilter> load(const std::string &file_name, int key_len) {
+        FILE *file = fopen(file_name.c_str(), "rb");
+        if (file == nullptr) {
+            return nullptr;
+        }
+        FileHdr hdr;
+        std::unique_ptr<IxBloomFilter> filter;
+        if (fread(&hdr, sizeof(hdr), 1, file) == 1 && hdr.magic == FILE_MAGIC && hdr.key_len == key_len &&
+            hdr.num_hashes > 0 && hdr.num_bits >= 64 && (hdr.num_bits & (hdr.num_bits - 1)) == 0) {
+            filter.reset(new IxBloomFilter(key_len, hdr.num_hashes, hdr.num_bits));
+            filter->num_added_ = hdr.num_added;
+            for (uint64_t i = 0; filter != nullptr && i < hdr.num_bits / 64; ++i) {
+                uint64_t word;
+                if (fread(&word, sizeof(word), 1, file) != 1) {
+                    filter.reset();
+                    break;
+                }
+                filter->words_[i].store(word, std::memory_order_relaxed);
+            }
+        }
+        fclose(file);
+        return filter;
+    }
+};
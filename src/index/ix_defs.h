@@ -22,10 +22,22 @@ constexpr int IX_INIT_ROOT_PAGE = 2;
 constexpr int IX_INIT_NUM_PAGES = 3;
 constexpr int IX_MAX_COL_LEN = 512;
 
+constexpr uint8_t IX_HAS_LOW_FENCE = 1;   // 结点有下界fence key, 否则下界为负无穷
+constexpr uint8_t IX_HAS_HIGH_FENCE = 2;  // 结点有上界fence key, 否则上界为正无穷
+
+/* 结点内查找时key的比较方式, 打开索引时根据字段类型确定一次 */
+enum class IxKeyKind {
+    INT,    // 单个INT字段
+    FLOAT,  // 单个FLOAT字段
+    BYTES,  // 只有STRING字段, 定长字段依次拼接, 整个key直接memcmp
+    INTS,   // 多个INT字段, 逐个比较int
+    MIXED   // 其他组合, 逐字段按类型比较
+};
+
 class IxFileHdr {
 public: 
-    page_id_t first_free_page_no_;      // 文件中第一个空闲的磁盘页面的页面号
-    int num_pages_;                     // 磁盘文件中页面的数量
+    page_id_t first_free_page_no_;      // 空闲页面链表的表头, 空闲页面通过IxPageHdr::next_free_page_no串起来
+    int num_pages_;                     // 磁盘文件中页面的数量, 包括空闲页面
     page_id_t root_page_;               // B+树根节点对应的页面号
     int col_num_;                       // 索引包含的字段数量
     std::vector<ColType> col_types_;    // 字段的类型
@@ -37,6 +49,8 @@ public:
     page_id_t first_leaf_;              // 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf_;               // 尾叶节点对应的页号
     int tot_len_;                       // 记录结构体的整体长度
+    bool compress_keys_ = false;        // 结点中的key是否做前缀压缩, 只用于BYTES类型的索引
+    IxKeyKind key_kind_ = IxKeyKind::MIXED;  // key的比较方式, 不写入磁盘, deserialize()时由col_types_得到
 
     IxFileHdr() {
         tot_len_ = col_num_ = 0;
@@ -51,7 +65,7 @@ public:
 
     void update_tot_len() {
         tot_len_ = 0;
-        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 6;
+        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 7;
         tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
     }
 
@@ -85,6 +99,9 @@ public:
         offset += sizeof(page_id_t);
         memcpy(dest + offset, &last_leaf_, sizeof(page_id_t));
         offset += sizeof(page_id_t);
+        int compress_keys = compress_keys_;
+        memcpy(dest + offset, &compress_keys, sizeof(int));
+        offset += sizeof(int);
         assert(offset == tot_len_);
     }
 
@@ -123,19 +140,49 @@ public:
         offset += sizeof(page_id_t);
         last_leaf_ = *reinterpret_cast<const page_id_t*>(src + offset);
         offset += sizeof(page_id_t);
-        assert(offset == tot_len_);
+        if (offset < tot_len_) {
+            compress_keys_ = *reinterpret_cast<const int*>(src + offset) != 0;
+            offset += sizeof(int);
+        } else {
+            // 旧版本的文件头没有compress_keys_, 按新格式补齐, 关闭索引时写回
+            update_tot_len();
+        }
+        assert(offset <= tot_len_);
+        init_key_kind();
+    }
+
+    void init_key_kind() {
+        bool all_int = true, all_string = true;
+        for (ColType type : col_types_) {
+            all_int = all_int && type == TYPE_INT;
+            all_string = all_string && type == TYPE_STRING;
+        }
+        if (col_num_ == 1 && col_types_[0] == TYPE_INT) {
+            key_kind_ = IxKeyKind::INT;
+        } else if (col_num_ == 1 && col_types_[0] == TYPE_FLOAT) {
+            key_kind_ = IxKeyKind::FLOAT;
+        } else if (all_string) {
+            key_kind_ = IxKeyKind::BYTES;
+        } else if (all_int) {
+            key_kind_ = IxKeyKind::INTS;
+        } else {
+            key_kind_ = IxKeyKind::MIXED;
+        }
     }
 };
 
 class IxPageHdr {
 public:
-    page_id_t next_free_page_no;    // unused
+    page_id_t next_free_page_no;    // 页面空闲时, 空闲页面链表中的下一个页面
     page_id_t parent;               // 父亲节点所在页面的叶号
     int num_key;                    // # current keys (always equals to #child - 1) 已插入的keys数量，key_idx∈[0,num_key)
     bool is_leaf;                   // 是否为叶节点
+    uint8_t fence_flags;            // IX_HAS_LOW_FENCE | IX_HAS_HIGH_FENCE, 只用于前缀压缩的索引, 清零的页面上下界都是无穷
+    uint16_t prefix_len;            // 结点中所有key共享的前缀长度, 前缀存放在下界fence key中, 只用于前缀压缩的索引
     page_id_t prev_leaf;            // previous leaf node's page_no, effective only when is_leaf is true
     page_id_t next_leaf;            // next leaf node's page_no, effective only when is_leaf is true
 };
+static_assert(sizeof(IxPageHdr) == 24, "fence_flags and prefix_len must fit in the padding after is_leaf");
 
 class Iid {
 public:
@@ -145,4 +192,94 @@ public:
     friend bool operator==(const Iid &x, const Iid &y) { return x.page_no == y.page_no && x.slot_no == y.slot_no; }
 
     friend bool operator!=(const Iid &x, const Iid &y) { return !(x == y); }
-};
\ No newline at end of file
+};
+constexpr int IX_HASH_DIR_PAGE = 1;                                          // 初始的目录页面
+constexpr int IX_HASH_INIT_BUCKET_PAGE = 2;                                  // 初始的唯一一个桶
+constexpr int IX_HASH_INIT_NUM_PAGES = 3;
+constexpr int IX_HASH_DIR_ENTRIES_PER_PAGE = PAGE_SIZE / sizeof(page_id_t);  // 每个目录页面存放的目录项数量
+
+/* 可扩展哈希索引的文件头, 存放在第0页 */
+class IxHashFileHdr {
+public:
+    int tot_len_ = 0;                   // 文件头序列化后的长度
+    int num_pages_ = 0;                 // 磁盘文件中页面的数量
+    int global_depth_ = 0;              // 全局深度, 目录共有2^global_depth_项
+    int col_num_ = 0;                   // 索引包含的字段数量
+    std::vector<ColType> col_types_;    // 字段的类型
+    std::vector<int> col_lens_;         // 字段的长度
+    int col_tot_len_ = 0;               // 索引包含的字段的总长度
+    int bucket_capacity_ = 0;           // 每个桶页面最多存放的键值对数量
+    std::vector<page_id_t> dir_pages_;  // 目录页面的页号, 第i项目录存放在dir_pages_[i / IX_HASH_DIR_ENTRIES_PER_PAGE]中
+
+    void update_tot_len() {
+        tot_len_ = sizeof(int) * 7;
+        tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
+        tot_len_ += sizeof(page_id_t) * dir_pages_.size();
+    }
+
+    void serialize(char* dest) {
+        int offset = 0;
+        int num_dir_pages = dir_pages_.size();
+        for (int val : {tot_len_, num_pages_, global_depth_, col_num_, col_tot_len_, bucket_capacity_, num_dir_pages}) {
+            memcpy(dest + offset, &val, sizeof(int));
+            offset += sizeof(int);
+        }
+        for(int i = 0; i < col_num_; ++i) {
+            memcpy(dest + offset, &col_types_[i], sizeof(ColType));
+            offset += sizeof(ColType);
+        }
+        for(int i = 0; i < col_num_; ++i) {
+            memcpy(dest + offset, &col_lens_[i], sizeof(int));
+            offset += sizeof(int);
+        }
+        for(page_id_t page_no : dir_pages_) {
+            memcpy(dest + offset, &page_no, sizeof(page_id_t));
+            offset += sizeof(page_id_t);
+        }
+        assert(offset == tot_len_);
+    }
+
+    void deserialize(const char* src) {
+        int offset = 0;
+        int num_dir_pages = 0;
+        for (int *val : {&tot_len_, &num_pages_, &global_depth_, &col_num_, &col_tot_len_, &bucket_capacity_, &num_dir_pages}) {
+            *val = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+        }
+        for(int i = 0; i < col_num_; ++i) {
+            col_types_.push_back(*reinterpret_cast<const ColType*>(src + offset));
+            offset += sizeof(ColType);
+        }
+        for(int i = 0; i < col_num_; ++i) {
+            col_lens_.push_back(*reinterpret_cast<const int*>(src + offset));
+            offset += sizeof(int);
+        }
+        for(int i = 0; i < num_dir_pages; ++i) {
+            dir_pages_.push_back(*reinterpret_cast<const page_id_t*>(src + offset));
+            offset += sizeof(page_id_t);
+        }
+        assert(offset == tot_len_);
+    }
+};
+
+/* 桶页面的页头, 之后依次是bucket_capacity_个key和同样数量的rid */
+class IxHashBucketHdr {
+public:
+    int local_depth;                // 局部深度, 桶中所有key哈希值的低local_depth位相同
+    int num_entries;                // 桶页面中已存放的键值对数量
+    page_id_t next_overflow;        // 溢出页面, 只有局部深度达到HASH_INDEX_MAX_GLOBAL_DEPTH的桶才会有
+    int reserved;
+};
+
+/* 哈希索引中key的哈希值, 对key的字节做FNV-1a后再打散, 目录按低位寻址 */
+inline uint64_t ix_hash_key(const char *key, int len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,173 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_external_sort.h"
+
+#include <algorithm>
+
+#include "ix_index_handle.h"
+
+IxExternalSorter::IxExternalSorter(const IxFileHdr *file_hdr, const std::string &run_prefix, size_t memory_limit)
+    : file_hdr_(file_hdr), run_prefix_(run_prefix) {
+    entry_len_ = file_hdr_->col_tot_len_ + sizeof(Rid);
+    // 至少能放下一个页面的键值对, 否则每个有序段都太短
+    memory_limit_ = std::max(memory_limit, (size_t)PAGE_SIZE);
+    cur_.resize(entry_len_);
+}
+
+IxExternalSorter::~IxExternalSorter() {
+    for (auto &run : runs_) {
+        fclose(run.file);
+        std::remove(run.file_name.c_str());
+    }
+}
+
+/**
+ * @description: 加入一个键值对, 内存中暂存的键值对超过上限时写成一个有序段
+ */
+void IxExternalSorter::add(const char *key, const Rid &rid) {
+    assert(!finished_);
+    if (entries_.size() + entry_len_ > memory_limit_) {
+        spill();
+    }
+    size_t offset = entries_.size();
+    entries_.resize(offset + entry_len_);
+    memcpy(entries_.data() + offset, key, file_hdr_->col_tot_len_);
+    memcpy(entries_.data() + offset + file_hdr_->col_tot_len_, &rid, sizeof(Rid));
+    num_entries_++;
+}
+
+/**
+ * @description: 对内存中的键值对排序, 只交换指针, 比较函数按索引的key类型分派一次
+ * 使用稳定排序, 相同的key按加入的先后顺序输出
+ */
+void IxExternalSorter::sort_entries() {
+    sorted_.clear();
+    for (size_t offset = 0; offset < entries_.size(); offset += entry_len_) {
+        sorted_.push_back(entries_.data() + offset);
+    }
+    ix_dispatch_compare(file_hdr_, [&](auto compare) {
+        std::stable_sort(sorted_.begin(), sorted_.end(),
+                         [&](const char *a, const char *b) { return compare(a, b) < 0; });
+    });
+    sorted_pos_ = 0;
+}
+
+/**
+ * @description: 把内存中的键值对排序后写到一个新的有序段文件
+ */
+void IxExternalSorter::spill() {
+    if (entries_.empty()) {
+        return;
+    }
+    sort_entries();
+    Run run;
+    run.file_name = run_prefix_ + "." + std::to_string(runs_.size());
+    run.file = fopen(run.file_name.c_str(), "w+b");
+    if (run.file == nullptr) {
+        throw UnixError();
+    }
+    runs_.push_back(std::move(run));
+    FILE *file = runs_.back().file;
+    // 按排好的顺序拼到连续的缓冲区后再写, 避免每个键值对一次fwrite
+    std::vector<char> out;
+    out.reserve(std::min(entries_.size(), (size_t)1 << 20));
+    for (const char *entry : sorted_) {
+        out.insert(out.end(), entry, entry + entry_len_);
+        if (out.size() >= (size_t)1 << 20) {
+            if (fwrite(out.data(), 1, out.size(), file) != out.size()) {
+                throw UnixError();
+            }
+            out.clear();
+        }
+    }
+    if (!out.empty() && fwrite(out.data(), 1, out.size(), file) != out.size()) {
+        throw UnixError();
+    }
+    entries_.clear();
+    sorted_.clear();
+}
+
+/**
+ * @description: 读入有序段的下一块数据
+ * @return {bool} 有序段是否还有数据
+ */
+bool IxExternalSorter::fill(Run &run) {
+    run.buf_len = fread(run.buf.data(), 1, run.buf.size(), run.file);
+    run.buf_pos = 0;
+    return run.buf_len > 0;
+}
+
+// 相同的key先输出先写出的有序段中的, 保持加入的先后顺序
+bool IxExternalSorter::run_greater(int a, int b) const {
+    int res = ix_compare(run_entry(a), run_entry(b), file_hdr_);
+    return res > 0 || (res == 0 && a > b);
+}
+
+/**
+ * @description: 不再加入键值对, 开始输出; 没有写过有序段时直接在内存中排序, 否则把剩余的键值对也写成有序段后多路归并
+ */
+void IxExternalSorter::finish() {
+    assert(!finished_);
+    finished_ = true;
+    if (runs_.empty()) {
+        sort_entries();
+        return;
+    }
+    spill();
+    entries_.shrink_to_fit();
+    // 归并时的内存上限平分给各段的读缓冲区, 缓冲区长度是键值对长度的整数倍
+    size_t buf_len = std::max(memory_limit_ / runs_.size(), (size_t)PAGE_SIZE) / entry_len_ * entry_len_;
+    for (size_t i = 0; i < runs_.size(); i++) {
+        auto &run = runs_[i];
+        run.buf.resize(buf_len);
+        rewind(run.file);
+        if (fill(run)) {
+            heap_.push_back(i);
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [&](int a, int b) { return run_greater(a, b); });
+}
+
+/**
+ * @description: 按key从小到大取出下一个键值对
+ * @param {char**} key 传出参数, 指向key, 下一次调用next()之前有效
+ * @param {Rid*} rid 传出参数
+ * @return {bool} 是否还有键值对
+ */
+bool IxExternalSorter::next(const char **key, Rid *rid) {
+    assert(finished_);
+    const char *entry;
+    if (runs_.empty()) {
+        if (sorted_pos_ == sorted_.size()) {
+            return false;
+        }
+        entry = sorted_[sorted_pos_++];
+    } else {
+        if (heap_.empty()) {
+            return false;
+        }
+        auto greater = [&](int a, int b) { return run_greater(a, b); };
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        int run_idx = heap_.back();
+        memcpy(cur_.data(), run_entry(run_idx), entry_len_);
+        auto &run = runs_[run_idx];
+        run.buf_pos += entry_len_;
+        if (run.buf_pos < run.buf_len || fill(run)) {
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        } else {
+            heap_.pop_back();
+        }
+        entry = cur_.data();
+    }
+    *key = entry;
+    memcpy(rid, entry + file_hdr_->col_tot_len_, sizeof(Rid));
+    return true;
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ix_defs.h"
+
+/* 批量建立B+树时对(key, rid)做外部排序
+ * 键值对先放在内存中, 超过内存上限后排序并写成一个有序段文件; finish()之后按key从小到大多路归并输出,
+ * key相同的键值对按加入的先后顺序输出 */
+class IxExternalSorter {
+   private:
+    /* 写到磁盘上的一个有序段, 归并时每段只在内存中保留一个读缓冲区 */
+    struct Run {
+        FILE *file;
+        std::string file_name;
+        std::vector<char> buf;
+        size_t buf_len = 0;     // buf中有效的字节数
+        size_t buf_pos = 0;     // 下一个键值对在buf中的位置
+    };
+
+    const IxFileHdr *file_hdr_;
+    std::string run_prefix_;            // 有序段文件名的前缀
+    size_t memory_limit_;               // 内存中最多暂存的字节数
+    int entry_len_;                     // 一个键值对的长度, key之后紧跟rid
+    size_t num_entries_ = 0;            // 已加入的键值对数量
+
+    std::vector<char> entries_;         // 还没有写成有序段的键值对
+    std::vector<const char *> sorted_;  // entries_排序后的顺序
+    size_t sorted_pos_ = 0;
+    std::vector<Run> runs_;
+    std::vector<int> heap_;             // 归并时以各段当前的键值对为元素的最小堆, 元素为runs_的下标
+    std::vector<char> cur_;             // next()返回的键值对
+    bool finished_ = false;
+
+   public:
+    IxExternalSorter(const IxFileHdr *file_hdr, const std::string &run_prefix,
+                     size_t memory_limit = IX_BULK_SORT_MEMORY);
+
+    ~IxExternalSorter();
+
+    void add(const char *key, const Rid &rid);
+
+    void finish();
+
+    bool next(const char **key, Rid *rid);
+
+    size_t size() const { return num_entries_; }
+
+    int num_runs() const { return runs_.size(); }
+
+   private:
+    void sort_entries();
+
+    void spill();
+
+    bool fill(Run &run);
+
+    const char *run_entry(int run_idx) const { return runs_[run_idx].buf.data() + runs_[run_idx].buf_pos; }
+
+    bool run_greater(int a, int b) const;
+};
@@ -0,0 +1,154 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+#include "ix_bloom_filter.h"
+#include "ix_defs.h"
+
+class Transaction;
+
+/* SHOW INDEX STATS输出的一个索引的统计信息 */
+struct IxIndexStats {
+    int height = 0;                 // 树高, 只有根结点时为1; 哈希索引为1
+    int num_internal_pages = 0;     // 内部结点数; 哈希索引为目录页面数
+    int num_leaf_pages = 0;         // 叶子结点数; 哈希索引为桶页面数, 包括溢出页面
+    size_t num_entries = 0;         // 叶子结点中的键值对数量
+    size_t prefix_bytes = 0;        // 所有结点的公共前缀长度之和, 除以结点数得到平均前缀长度
+    size_t key_bytes = 0;           // 所有结点中的key不压缩时占用的字节数
+    size_t stored_key_bytes = 0;    // 所有结点中的key实际占用的字节数, 包括fence key
+};
+
+/* 索引文件句柄, 表上的索引维护(插入删除记录时更新索引, 唯一性检查)只通过这些接口进行
+ * B+树(IxIndexHandle)和可扩展哈希(IxHashHandle)各自实现, 范围扫描只有B+树支持 */
+class IxHandle {
+   protected:
+    std::unique_ptr<IxBloomFilter> bloom_;                      // 可以为空; 插入key的各个接口都要通过add_to_bloom_filter()把key加进过滤器
+    std::vector<std::unique_ptr<IxBloomFilter>> full_blooms_;   // 插入时写满后被换下的过滤器, 不再加key, 只用来查询
+    mutable std::shared_mutex bloom_latch_;                     // add和may_contain持有读锁, 替换过滤器持有写锁
+
+    // 所有过滤器中add()的次数, 调用者持有bloom_latch_
+    size_t num_bloom_keys() const {
+        size_t num_keys = bloom_->num_added();
+        for (auto &bloom : full_blooms_) {
+            num_keys += bloom->num_added();
+        }
+        return num_keys;
+    }
+
+    /**
+     * @description: 把key加进过滤器; key的数量超过容量后换上一个按IX_BLOOM_GROWTH_FACTOR倍key数量分配的空过滤器,
+     * 写满的过滤器留下来继续查询. 插入时有并发的写操作, 不能扫描索引重建
+     */
+    void add_to_bloom_filter(const char *key) {
+        {
+            std::shared_lock<std::shared_mutex> guard(bloom_latch_);
+            if (bloom_ == nullptr) {
+                return;
+            }
+            bloom_->add(key);
+            if (bloom_->num_added() <= bloom_->capacity()) {
+                return;
+            }
+        }
+        std::unique_lock<std::shared_mutex> guard(bloom_latch_);
+        if (bloom_ != nullptr && bloom_->num_added() > bloom_->capacity()) {
+            auto bloom = std::make_unique<IxBloomFilter>(bloom_->get_key_len(), num_bloom_keys() * IX_BLOOM_GROWTH_FACTOR);
+            full_blooms_.push_back(std::move(bloom_));
+            bloom_ = std::move(bloom);
+        }
+    }
+
+   public:
+    virtual ~IxHandle() = default;
+
+    virtual int GetFd() = 0;
+
+    // for search
+    virtual bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) = 0;
+
+    virtual bool get_value_by_prefix(const char *key, int prefix_len, std::vector<Rid> *result,
+                                     Transaction *transaction) = 0;
+
+    // for insert, key已经存在时返回-1
+    virtual page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) = 0;
+
+    virtual page_id_t insert_entry_for_load(const char *key, const Rid &value, Transaction *transaction) = 0;
+
+    virtual bool unpin_n_page() = 0;
+
+    // for delete
+    virtual bool delete_entry(const char *key, Transaction *transaction) = 0;
+
+    // for space report
+    virtual int get_num_pages() const = 0;
+
+    virtual int get_num_free_pages() = 0;
+
+    // for index stats
+    virtual IxIndexStats get_stats() = 0;
+
+    // for bloom filter, 依次访问索引中所有的key, 调用时没有并发的写操作
+    virtual void scan_keys(const std::function<void(const char *)> &visit) = 0;
+
+    void set_bloom_filter(std::unique_ptr<IxBloomFilter> bloom) {
+        std::unique_lock<std::shared_mutex> guard(bloom_latch_);
+        bloom_ = std::move(bloom);
+        full_blooms_.clear();
+    }
+
+    // 当前接收新key的过滤器
+    const IxBloomFilter *get_bloom_filter() const { return bloom_.get(); }
+
+    // 返回false时key一定不在索引中, 不用再查索引
+    bool may_contain(const char *key) const {
+        std::shared_lock<std::shared_mutex> guard(bloom_latch_);
+        if (bloom_ == nullptr || bloom_->may_contain(key)) {
+            return true;
+        }
+        for (auto &bloom : full_blooms_) {
+            if (bloom->may_contain(key)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @description: 关闭索引时把过滤器写到文件中; 插入时换过过滤器的不保存, 下次打开时扫描索引重建
+     */
+    void save_bloom_filter(const std::string &file_name) const {
+        std::shared_lock<std::shared_mutex> guard(bloom_latch_);
+        if (bloom_ != nullptr && full_blooms_.empty()) {
+            bloom_->save(file_name);
+        }
+    }
+
+    /**
+     * @description: 按expected_keys重新分配过滤器, 把索引中现有的key加进去; 调用者保证期间没有其他线程访问这个索引
+     */
+    void rebuild_bloom_filter(int key_len, size_t expected_keys) {
+        auto bloom = std::make_unique<IxBloomFilter>(key_len, expected_keys);
+        scan_keys([&](const char *key) { bloom->add(key); });
+        set_bloom_filter(std::move(bloom));
+    }
+
+    // 批量插入结束时把插入过程中换下的多个过滤器合并成一个, 按两倍的key数量重建
+    void grow_bloom_filter() {
+        if (bloom_ != nullptr && (!full_blooms_.empty() || bloom_->num_added() > bloom_->capacity())) {
+            rebuild_bloom_filter(bloom_->get_key_len(), num_bloom_keys() * 2);
+        }
+    }
+};
@@ -0,0 +1,338 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_hash_handle.h"
+
+#include <unordered_set>
+
+IxHashHandle::IxHashHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
+    : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
+    char *buf = new char[PAGE_SIZE];
+    memset(buf, 0, PAGE_SIZE);
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
+    file_hdr_ = new IxHashFileHdr();
+    file_hdr_->deserialize(buf);
+    delete[] buf;
+
+    disk_manager_->set_fd2pageno(fd, file_hdr_->num_pages_);
+    load_directory();
+}
+
+IxHashHandle::~IxHashHandle() { delete file_hdr_; }
+
+/**
+ * @brief 从目录页面读入2^global_depth个目录项
+ */
+void IxHashHandle::load_directory() {
+    directory_.resize(1 << file_hdr_->global_depth_);
+    for (size_t i = 0; i < directory_.size(); i += IX_HASH_DIR_ENTRIES_PER_PAGE) {
+        Page *page = fetch_page(file_hdr_->dir_pages_[i / IX_HASH_DIR_ENTRIES_PER_PAGE]);
+        size_t n = std::min(directory_.size() - i, (size_t)IX_HASH_DIR_ENTRIES_PER_PAGE);
+        memcpy(directory_.data() + i, page->get_data(), n * sizeof(page_id_t));
+        unpin_page(page, false);
+    }
+}
+
+/**
+ * @brief 修改第idx项目录, 同时写到内存副本和目录页面, 调用者持有dir_latch_写锁
+ */
+void IxHashHandle::write_dir_entry(int idx, page_id_t bucket) {
+    directory_[idx] = bucket;
+    Page *page = fetch_page(file_hdr_->dir_pages_[idx / IX_HASH_DIR_ENTRIES_PER_PAGE]);
+    reinterpret_cast<page_id_t *>(page->get_data())[idx % IX_HASH_DIR_ENTRIES_PER_PAGE] = bucket;
+    unpin_page(page, true);
+}
+
+/**
+ * @brief 在文件末尾分配一个新页面
+ * @return Page* 清零并pin住的页面, 调用者负责unpin
+ */
+Page *IxHashHandle::create_page() {
+    std::lock_guard<std::mutex> guard(alloc_latch_);
+    file_hdr_->num_pages_++;
+    PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+    return buffer_pool_manager_->new_page(&new_page_id);
+}
+
+/**
+ * @brief 查找key对应的rid, 只读key所在的桶页面及其溢出页面
+ *
+ * @param key 要查找的key值
+ * @param result 用于存放结果的容器
+ * @return bool key是否存在
+ */
+bool IxHashHandle::get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    std::shared_lock<std::shared_mutex> dir_guard(dir_latch_);
+    page_id_t page_no = directory_[dir_index(key)];
+    while (page_no != IX_NO_PAGE) {
+        Page *page = fetch_page(page_no);
+        IxHashBucketHandle bucket(file_hdr_, page);
+        int pos = -1;
+        Rid rid;
+        page_id_t next = IX_NO_PAGE;
+        page->optimistic_read([&]() {
+            pos = bucket.find(key);
+            if (pos != -1) {
+                rid = bucket.rids[pos];
+            }
+            next = bucket.hdr->next_overflow;
+        });
+        unpin_page(page, false);
+        if (pos != -1) {
+            result->push_back(rid);
+            return true;
+        }
+        page_no = next;
+    }
+    return false;
+}
+
+/**
+ * @brief 哈希索引只能按完整的key查找, prefix_len必须等于key的长度
+ */
+bool IxHashHandle::get_value_by_prefix(const char *key, int prefix_len, std::vector<Rid> *result,
+                                       Transaction *transaction) {
+    assert(prefix_len == file_hdr_->col_tot_len_);
+    return get_value(key, result, transaction);
+}
+
+/**
+ * @brief 插入键值对
+ * 持有目录读锁并对桶的第一个页面加写锁, 同一个桶上的插入删除互斥; 桶已满时放开所有锁, 持有目录写锁分裂后重试
+ *
+ * @return page_id_t 插入到的桶页面的page_no, key已经存在时返回-1
+ */
+page_id_t IxHashHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    add_to_bloom_filter(key);
+    while (true) {
+        int idx;
+        {
+            std::shared_lock<std::shared_mutex> dir_guard(dir_latch_);
+            idx = dir_index(key);
+            Page *head = fetch_page(directory_[idx]);
+            head->Wlatch();
+            IxHashBucketHandle head_bucket(file_hdr_, head);
+
+            // 检查整条溢出链上是否已有该key, 同时找到第一个有空位的页面
+            Page *target = nullptr;
+            Page *tail = head;
+            bool exists = false;
+            std::vector<Page *> overflow;
+            for (Page *page = head;;) {
+                IxHashBucketHandle bucket(file_hdr_, page);
+                if (bucket.find(key) != -1) {
+                    exists = true;
+                    break;
+                }
+                if (target == nullptr && !bucket.is_full()) {
+                    target = page;
+                }
+                tail = page;
+                if (bucket.hdr->next_overflow == IX_NO_PAGE) {
+                    break;
+                }
+                page = fetch_page(bucket.hdr->next_overflow);
+                overflow.push_back(page);
+            }
+
+            page_id_t page_no = -1;
+            bool split = false;
+            if (!exists) {
+                if (target == nullptr && head_bucket.hdr->local_depth >= HASH_INDEX_MAX_GLOBAL_DEPTH) {
+                    // 桶不能再分裂, 在溢出链末尾链接一个新页面
+                    target = create_page();
+                    overflow.push_back(target);
+                    IxHashBucketHandle new_bucket(file_hdr_, target);
+                    *new_bucket.hdr = {.local_depth = head_bucket.hdr->local_depth,
+                                       .num_entries = 0,
+                                       .next_overflow = IX_NO_PAGE,
+                                       .reserved = 0};
+                    if (tail != head) {
+                        tail->Wlatch();
+                    }
+                    IxHashBucketHandle(file_hdr_, tail).hdr->next_overflow = target->get_page_id().page_no;
+                    if (tail != head) {
+                        tail->WUnlatch();
+                    }
+                }
+                if (target != nullptr) {
+                    if (target != head) {
+                        target->Wlatch();
+                    }
+                    IxHashBucketHandle(file_hdr_, target).append(key, value);
+                    if (target != head) {
+                        target->WUnlatch();
+                    }
+                    page_no = target->get_page_id().page_no;
+                } else {
+                    split = true;
+                }
+            }
+
+            for (Page *page : overflow) {
+                unpin_page(page, !exists);
+            }
+            head->WUnlatch();
+            unpin_page(head, !exists && !split);
+            if (!split) {
+                return page_no;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> dir_guard(dir_latch_);
+        split_bucket(dir_index(key));
+    }
+}
+
+/**
+ * @brief 分裂第idx项目录指向的桶, 局部深度等于全局深度时先把目录翻倍
+ * 调用者持有dir_latch_写锁, 没有其他线程在访问索引, 不需要对页面加锁; 桶在放锁期间可能已被其他线程分裂, 此时直接返回
+ */
+void IxHashHandle::split_bucket(int idx) {
+    page_id_t old_page_no = directory_[idx];
+    Page *old_page = fetch_page(old_page_no);
+    IxHashBucketHandle old_bucket(file_hdr_, old_page);
+    if (!old_bucket.is_full() || old_bucket.hdr->local_depth >= HASH_INDEX_MAX_GLOBAL_DEPTH) {
+        unpin_page(old_page, false);
+        return;
+    }
+
+    int local_depth = old_bucket.hdr->local_depth;
+    if (local_depth == file_hdr_->global_depth_) {
+        // 目录翻倍, 新的一半与旧的一半指向相同的桶
+        size_t old_size = directory_.size();
+        size_t new_size = old_size * 2;
+        while (file_hdr_->dir_pages_.size() * IX_HASH_DIR_ENTRIES_PER_PAGE < new_size) {
+            Page *dir_page = create_page();
+            file_hdr_->dir_pages_.push_back(dir_page->get_page_id().page_no);
+            unpin_page(dir_page, true);
+        }
+        file_hdr_->global_depth_++;
+        file_hdr_->update_tot_len();
+        directory_.resize(new_size);
+        for (size_t i = old_size; i < new_size; ++i) {
+            write_dir_entry(i, directory_[i - old_size]);
+        }
+    }
+
+    Page *new_page = create_page();
+    IxHashBucketHandle new_bucket(file_hdr_, new_page);
+    *new_bucket.hdr = {.local_depth = local_depth + 1, .num_entries = 0, .next_overflow = IX_NO_PAGE, .reserved = 0};
+    old_bucket.hdr->local_depth = local_depth + 1;
+
+    // 哈希值第local_depth位为1的键值对移到新桶
+    for (int i = 0; i < old_bucket.hdr->num_entries;) {
+        const char *key = old_bucket.get_key(i);
+        if ((ix_hash_key(key, file_hdr_->col_tot_len_) >> local_depth) & 1) {
+            new_bucket.append(key, old_bucket.rids[i]);
+            old_bucket.erase(i);
+        } else {
+            ++i;
+        }
+    }
+
+    uint64_t low_bits = idx & ((1ULL << local_depth) - 1);
+    for (size_t i = low_bits; i < directory_.size(); i += (1ULL << local_depth)) {
+        if ((i >> local_depth) & 1) {
+            write_dir_entry(i, new_page->get_page_id().page_no);
+        }
+    }
+
+    unpin_page(new_page, true);
+    unpin_page(old_page, true);
+}
+
+/**
+ * @brief 删除key对应的键值对, 桶变空后不合并
+ *
+ * @return bool key是否存在
+ */
+bool IxHashHandle::delete_entry(const char *key, Transaction *transaction) {
+    std::shared_lock<std::shared_mutex> dir_guard(dir_latch_);
+    Page *head = fetch_page(directory_[dir_index(key)]);
+    head->Wlatch();
+    bool deleted = false;
+    for (Page *page = head; page != nullptr;) {
+        IxHashBucketHandle bucket(file_hdr_, page);
+        int pos = bucket.find(key);
+        if (pos != -1) {
+            if (page != head) {
+                page->Wlatch();
+            }
+            bucket.erase(pos);
+            if (page != head) {
+                page->WUnlatch();
+            }
+            deleted = true;
+        }
+        page_id_t next = bucket.hdr->next_overflow;
+        if (page != head) {
+            unpin_page(page, deleted);
+        }
+        page = (deleted || next == IX_NO_PAGE) ? nullptr : fetch_page(next);
+    }
+    head->WUnlatch();
+    unpin_page(head, deleted);
+    return deleted;
+}
+
+/**
+ * @brief 统计目录页面和桶页面数量, 以及键值对数量
+ * 哈希索引没有层次和前缀压缩, 高度固定为1, key字节数按不压缩计算
+ */
+IxIndexStats IxHashHandle::get_stats() {
+    std::shared_lock<std::shared_mutex> dir_guard(dir_latch_);
+    IxIndexStats stats;
+    stats.height = 1;
+    stats.num_internal_pages = file_hdr_->dir_pages_.size();
+    std::unordered_set<page_id_t> visited;
+    for (page_id_t page_no : directory_) {
+        if (!visited.insert(page_no).second) {
+            continue;
+        }
+        while (page_no != IX_NO_PAGE) {
+            Page *page = fetch_page(page_no);
+            IxHashBucketHandle bucket(file_hdr_, page);
+            int num_entries = 0;
+            page->optimistic_read([&]() {
+                num_entries = bucket.hdr->num_entries;
+                page_no = bucket.hdr->next_overflow;
+            });
+            unpin_page(page, false);
+            stats.num_leaf_pages++;
+            stats.num_entries += num_entries;
+        }
+    }
+    stats.key_bytes = stats.num_entries * file_hdr_->col_tot_len_;
+    stats.stored_key_bytes = stats.key_bytes;
+    return stats;
+}
+
+/**
+ * @brief 把每个桶及其溢出页面中的key交给visit, 用于建立布隆过滤器
+ */
+void IxHashHandle::scan_keys(const std::function<void(const char *)> &visit) {
+    std::shared_lock<std::shared_mutex> dir_guard(dir_latch_);
+    std::unordered_set<page_id_t> visited;
+    for (page_id_t page_no : directory_) {
+        if (!visited.insert(page_no).second) {
+            continue;
+        }
+        while (page_no != IX_NO_PAGE) {
+            Page *page = fetch_page(page_no);
+            IxHashBucketHandle bucket(file_hdr_, page);
+            for (int i = 0; i < bucket.hdr->num_entries; ++i) {
+                visit(bucket.get_key(i));
+            }
+            page_no = bucket.hdr->next_overflow;
+            unpin_page(page, false);
+        }
+    }
+}
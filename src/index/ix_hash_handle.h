@@ -0,0 +1,134 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+
+#include "ix_defs.h"
+#include "ix_handle.h"
+
+/* 桶页面的句柄, 只解释页面内容, 不负责pin和加锁 */
+class IxHashBucketHandle {
+   public:
+    const IxHashFileHdr *file_hdr;
+    Page *page;
+    IxHashBucketHdr *hdr;
+    char *keys;
+    Rid *rids;
+
+    IxHashBucketHandle(const IxHashFileHdr *file_hdr_, Page *page_) : file_hdr(file_hdr_), page(page_) {
+        hdr = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        keys = page->get_data() + sizeof(IxHashBucketHdr);
+        size_t keys_size = (size_t)file_hdr->bucket_capacity_ * file_hdr->col_tot_len_;
+        keys_size = (keys_size + alignof(Rid) - 1) / alignof(Rid) * alignof(Rid);
+        rids = reinterpret_cast<Rid *>(keys + keys_size);
+    }
+
+    char *get_key(int idx) const { return keys + idx * file_hdr->col_tot_len_; }
+
+    bool is_full() const { return hdr->num_entries >= file_hdr->bucket_capacity_; }
+
+    // 返回key在桶中的位置, 不存在时返回-1
+    int find(const char *key) const {
+        for (int i = 0; i < hdr->num_entries; ++i) {
+            if (memcmp(get_key(i), key, file_hdr->col_tot_len_) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void append(const char *key, const Rid &rid) {
+        memcpy(get_key(hdr->num_entries), key, file_hdr->col_tot_len_);
+        rids[hdr->num_entries] = rid;
+        hdr->num_entries++;
+    }
+
+    // 桶中的键值对无序, 用最后一个键值对填补被删除的位置
+    void erase(int idx) {
+        int last = hdr->num_entries - 1;
+        if (idx != last) {
+            memcpy(get_key(idx), get_key(last), file_hdr->col_tot_len_);
+            rids[idx] = rids[last];
+        }
+        hdr->num_entries--;
+    }
+};
+
+/* 可扩展哈希索引, 只支持等值查找
+ * 目录在打开索引时读入内存, 查找只需读一个桶页面(加上可能的溢出页面); 目录页面只在桶分裂时写回 */
+class IxHashHandle : public IxHandle {
+    friend class IxManager;
+
+   private:
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    int fd_;
+    IxHashFileHdr *file_hdr_;
+    std::vector<page_id_t> directory_;  // 目录的内存副本, 受dir_latch_保护
+    // 查找和不需要分裂的插入删除持有读锁, 再对桶页面乐观读或加写锁; 桶分裂和目录翻倍持有写锁
+    std::shared_mutex dir_latch_;
+    std::mutex alloc_latch_;            // 保护file_hdr_->num_pages_和新页面的分配
+
+   public:
+    IxHashHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
+
+    ~IxHashHandle() override;
+
+    int GetFd() override { return fd_; }
+
+    // for search
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) override;
+
+    bool get_value_by_prefix(const char *key, int prefix_len, std::vector<Rid> *result, Transaction *transaction) override;
+
+    // for insert
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) override;
+
+    page_id_t insert_entry_for_load(const char *key, const Rid &value, Transaction *transaction) override {
+        return insert_entry(key, value, transaction);
+    }
+
+    bool unpin_n_page() override { return true; }
+
+    // for delete
+    bool delete_entry(const char *key, Transaction *transaction) override;
+
+    // for space report
+    int get_num_pages() const override { return file_hdr_->num_pages_; }
+
+    int get_num_free_pages() override { return 0; }
+
+    // for index stats
+    IxIndexStats get_stats() override;
+
+    void scan_keys(const std::function<void(const char *)> &visit) override;
+
+    int get_global_depth() const { return file_hdr_->global_depth_; }
+
+   private:
+    int dir_index(const char *key) const {
+        return static_cast<int>(ix_hash_key(key, file_hdr_->col_tot_len_) & ((1ULL << file_hdr_->global_depth_) - 1));
+    }
+
+    Page *fetch_page(page_id_t page_no) const { return buffer_pool_manager_->fetch_page(PageId{fd_, page_no}); }
+
+    void unpin_page(Page *page, bool is_dirty) const { buffer_pool_manager_->unpin_page(page->get_page_id(), is_dirty); }
+
+    Page *create_page();
+
+    void load_directory();
+
+    void write_dir_entry(int idx, page_id_t bucket);
+
+    void split_bucket(int idx);
+};
@@ -9,8 +9,11 @@ MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
 See the Mulan PSL v2 for more details. */
 
 #include "ix_index_handle.h"
+#include <algorithm>
 #include <vector>
+#include "ix_external_sort.h"
 #include "ix_scan.h"
+#include "ix_simd_search.h"
 
 /**
  * @brief 在当前node中查找第一个>=target的key_idx
@@ -23,20 +26,35 @@ int IxNodeHandle::lower_bound(const char *target) const {
     // 查找当前节点中第一个大于等于target的key，并返回key的位置给上层
     // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用ix_compare()函数进行比较
 
-    // 二分查找
-    int left = 0;
-    int right = page_hdr->num_key;  // 注意这里是 num_key 而不是 num_key - 1
-    while (left < right) {
-        int mid = left + (right - left) / 2;
-        int cmp = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-
-        if (cmp < 0) {
-            left = mid + 1;
-        } else {
-            right = mid;
+    if (file_hdr->key_kind_ == IxKeyKind::INT) {
+        return ix_int_lower_bound(reinterpret_cast<const int *>(keys), page_hdr->num_key, *(const int *)target);
+    }
+    // 前缀压缩的结点先比较一次公共前缀, 前缀不同时target在所有key的同一侧
+    int prefix_len = get_prefix_len();
+    if (prefix_len > 0) {
+        int cmp = memcmp(low_fence(), target, prefix_len);
+        if (cmp != 0) {
+            return cmp > 0 ? 0 : page_hdr->num_key;
         }
     }
-    return left;
+    const char *slots = key_slots();
+    int slot_len = file_hdr->col_tot_len_ - prefix_len;
+    // 二分查找, 比较函数在查找开始前按key类型选定一次
+    return ix_dispatch_compare(file_hdr, [&](auto compare) {
+        int left = 0;
+        int right = page_hdr->num_key;  // 注意这里是 num_key 而不是 num_key - 1
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            int cmp = compare(slots + mid * slot_len, target + prefix_len);
+
+            if (cmp < 0) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
+        }
+        return left;
+    }, prefix_len);
 }
 
 /**
@@ -51,20 +69,35 @@ int IxNodeHandle::upper_bound(const char *target) const {
     // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用ix_compare()函数进行比较
 
     if(page_hdr->num_key==0) return 0;
-    // 二分查找
-    int left = 1;
-    int right = page_hdr->num_key;  // 注意这里是 num_key 而不是 num_key - 1
-    while (left < right) {
-        int mid = left + (right - left) / 2;
-        int cmp = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-
-        if (cmp <= 0) {
-            left = mid + 1;
-        } else {
-            right = mid;
+    if (file_hdr->key_kind_ == IxKeyKind::INT) {
+        // 第0个key不参与比较, 与下面的二分查找从1开始一致
+        return 1 + ix_int_upper_bound(reinterpret_cast<const int *>(keys) + 1, page_hdr->num_key - 1, *(const int *)target);
+    }
+    int prefix_len = get_prefix_len();
+    if (prefix_len > 0) {
+        int cmp = memcmp(low_fence(), target, prefix_len);
+        if (cmp != 0) {
+            return cmp > 0 ? 1 : page_hdr->num_key;
         }
     }
-    return left;
+    const char *slots = key_slots();
+    int slot_len = file_hdr->col_tot_len_ - prefix_len;
+    // 二分查找, 比较函数在查找开始前按key类型选定一次
+    return ix_dispatch_compare(file_hdr, [&](auto compare) {
+        int left = 1;
+        int right = page_hdr->num_key;  // 注意这里是 num_key 而不是 num_key - 1
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            int cmp = compare(slots + mid * slot_len, target + prefix_len);
+
+            if (cmp <= 0) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
+        }
+        return left;
+    }, prefix_len);
 }
 
 /**
@@ -83,7 +116,7 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
     // 提示：可以调用lower_bound()和get_rid()函数。
 
     int key_idx = lower_bound(key);
-    if(key_idx >= page_hdr->num_key || ix_compare(get_key(key_idx), key, file_hdr->col_types_, file_hdr->col_lens_) != 0){
+    if(key_idx >= page_hdr->num_key || compare_key(key_idx, key) != 0){
         // target大于最后一个key || key 不存在
         return false;
     }
@@ -129,9 +162,11 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
 
     if(pos < 0 || page_hdr->num_key + n > get_max_size())
         return;
-    for(int i = page_hdr->num_key - pos; i>0; i--){ //移动i个元素
-        set_key(pos + i + n -1 , get_key(pos + i -1));
-        set_rid(pos + i + n -1, rids[pos + i -1]);
+    int move = page_hdr->num_key - pos; //移动move个元素
+    if(move > 0){
+        int slot_len = file_hdr->col_tot_len_ - get_prefix_len();
+        memmove(key_slot(pos + n), key_slot(pos), move * slot_len);
+        memmove(get_rid(pos + n), get_rid(pos), move * sizeof(Rid));
     }
     for(int i=0; i<n; i++){
         set_key(pos + i, key + i * file_hdr->col_tot_len_ ); 
@@ -156,7 +191,7 @@ int IxNodeHandle::insert(const char *key, const Rid &value) {
     // 4. 返回完成插入操作之后的键值对数量
 
     int key_idx = lower_bound(key); //找到大于等于key的key_index
-    if(key_idx < page_hdr->num_key && ix_compare(get_key(key_idx), key, file_hdr->col_types_, file_hdr->col_lens_) == 0){
+    if(key_idx < page_hdr->num_key && compare_key(key_idx, key) == 0){
         // 重复，不插入
         return page_hdr->num_key;
     }
@@ -175,9 +210,11 @@ void IxNodeHandle::erase_pair(int pos) {
     // 2. 删除该位置的rid
     // 3. 更新结点的键值对数量
 
-    for(int i=pos; i<page_hdr->num_key; i++){
-        set_key(i, get_key(i+1));
-        set_rid(i, *get_rid(i+1));
+    int move = page_hdr->num_key - pos - 1;
+    if(move > 0){
+        int slot_len = file_hdr->col_tot_len_ - get_prefix_len();
+        memmove(key_slot(pos), key_slot(pos + 1), move * slot_len);
+        memmove(get_rid(pos), get_rid(pos + 1), move * sizeof(Rid));
     }
     page_hdr->num_key--;
     return;
@@ -196,13 +233,86 @@ int IxNodeHandle::remove(const char *key) {
     // 3. 返回完成删除操作后的键值对数量
 
     int key_idx = lower_bound(key); //找到大于等于key的key_index
-    if(key_idx < page_hdr->num_key && ix_compare(get_key(key_idx), key, file_hdr->col_types_, file_hdr->col_lens_) == 0){
+    if(key_idx < page_hdr->num_key && compare_key(key_idx, key) == 0){
         // 找到，删除
         erase_pair(key_idx);
     }
     return page_hdr->num_key;
 }
 
+/**
+ * @brief 把第key_idx个key还原成完整的key, 拷贝到dest
+ *
+ * @param dest 长度至少为col_tot_len的缓冲区
+ */
+void IxNodeHandle::copy_key(int key_idx, char *dest) const {
+    int prefix_len = get_prefix_len();
+    memcpy(dest, low_fence(), prefix_len);
+    memcpy(dest + prefix_len, key_slot(key_idx), file_hdr->col_tot_len_ - prefix_len);
+}
+
+/**
+ * @brief 比较第key_idx个key和完整的key
+ *
+ * @return 小于、等于、大于key时分别返回负数、0、正数
+ */
+int IxNodeHandle::compare_key(int key_idx, const char *key) const {
+    int prefix_len = get_prefix_len();
+    if (prefix_len == 0) {
+        return ix_compare(key_slot(key_idx), key, file_hdr);
+    }
+    int cmp = memcmp(low_fence(), key, prefix_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return memcmp(key_slot(key_idx), key + prefix_len, file_hdr->col_tot_len_ - prefix_len);
+}
+
+/**
+ * @brief 设置结点的上下界, 并按两个fence key新的公共前缀重新编码结点中的key
+ * 分裂、合并和重分配改变结点负责的key范围之后调用; 范围变大时要在移入key之前调用, 变小时要在移出key之后调用
+ *
+ * @param low 新的下界, nullptr表示负无穷, 可以指向本结点的fence key
+ * @param high 新的上界, nullptr表示正无穷, 可以指向本结点的fence key
+ * @note 不压缩的索引不维护fence key, 直接返回
+ */
+void IxNodeHandle::set_fences(const char *low, const char *high) {
+    if (!file_hdr->compress_keys_) {
+        return;
+    }
+    int len = file_hdr->col_tot_len_;
+    int num_key = page_hdr->num_key;
+    // 前缀长度变化后key后缀的长度和rids的位置都会变化, 先按旧的前缀取出所有键值对
+    std::vector<char> old_keys(num_key * len);
+    std::vector<Rid> old_rids(get_rid(0), get_rid(num_key));
+    for (int i = 0; i < num_key; i++) {
+        copy_key(i, old_keys.data() + i * len);
+    }
+
+    uint8_t fence_flags = 0;
+    if (low != nullptr) {
+        memmove(low_fence(), low, len);
+        fence_flags |= IX_HAS_LOW_FENCE;
+    }
+    if (high != nullptr) {
+        memmove(high_fence(), high, len);
+        fence_flags |= IX_HAS_HIGH_FENCE;
+    }
+    int prefix_len = 0;
+    if (low != nullptr && high != nullptr) {
+        // 下界小于上界, 公共前缀最多为len - 1
+        while (prefix_len < len - 1 && low_fence()[prefix_len] == high_fence()[prefix_len]) {
+            prefix_len++;
+        }
+    }
+    page_hdr->fence_flags = fence_flags;
+    page_hdr->prefix_len = prefix_len;
+
+    assert(num_key <= get_max_size());
+    page_hdr->num_key = 0;
+    insert_pairs(0, old_keys.data(), old_rids.data(), num_key);
+}
+
 IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
     : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
     // init file_hdr_
@@ -216,8 +326,8 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     delete[] buf;
     
     // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
-    int now_page_no = disk_manager_->get_fd2pageno(fd);
-    disk_manager_->set_fd2pageno(fd, now_page_no + 1);
+    // 空闲页面仍计入num_pages, 因此新分配的page_no不会与空闲链表中的页面重叠
+    disk_manager_->set_fd2pageno(fd, file_hdr_->num_pages_);
 }
 
 
@@ -268,30 +378,17 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page_for_load(const cha
 }
 
 bool IxIndexHandle::unpin_n_page(){
-
-    std::unique_lock<std::mutex> l(buffer_pool_manager_->latch_);
+    // 通过unpin_page释放, 不再直接访问buffer pool的页表与帧latch
     for(auto page_id: batch_fetch_page){
-        int frame_id = buffer_pool_manager_->page_table_[ PageId{fd_, page_id.first} ];
-        Page* page = buffer_pool_manager_->pages_ + frame_id;
-        
-        (buffer_pool_manager_->pagelatch_+frame_id)->lock();
-
-        int pin_cnt = page->pin_count_;
-        if(pin_cnt == 0){
-            assert(0);
-        }
-
-        if(--page->pin_count_ == 0){
-            buffer_pool_manager_->replacer_->unpin(frame_id);
-        }
-        page->is_dirty_ = true;
-        (buffer_pool_manager_->pagelatch_+frame_id)->unlock();
+        bool unpinned = buffer_pool_manager_->unpin_page(PageId{fd_, page_id.first}, true);
+        assert(unpinned);
     }
     batch_fetch_page.clear();
     return true;
 }
 
 page_id_t IxIndexHandle::insert_entry_for_load(const char *key, const Rid &value, Transaction *transaction) {
+    add_to_bloom_filter(key);
     // Todo:
     // 1. 查找key值应该插入到哪个叶子节点
     // 2. 在该叶子节点中插入键值对
@@ -308,7 +405,9 @@ page_id_t IxIndexHandle::insert_entry_for_load(const char *key, const Rid &value
     }
     if( res.first->get_max_size() <= now_entry_cnt){
         auto new_right_node_handle = split(res.first);
-        insert_into_parent(res.first, new_right_node_handle->get_key(0), new_right_node_handle, transaction);
+        char split_key[IX_MAX_COL_LEN];
+        new_right_node_handle->copy_key(0, split_key);
+        insert_into_parent(res.first, split_key, new_right_node_handle, transaction);
         if(res.first->get_page_no() == file_hdr_->last_leaf_){
             file_hdr_->last_leaf_ = new_right_node_handle->get_page_no();
         }
@@ -341,6 +440,9 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
     if(root_latch) {
         root_latch_.lock();
         // std::cout << "find_ lock " << std::endl;
+        if(operation != Operation::FIND){
+            begin_write();
+        }
     }
     bool rootLocked = root_latch;
     // bool rootLocked = true;
@@ -396,6 +498,8 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
             }
             // test del wlach
             // transaction->append_index_latch_page_set(next_node_handle->page);
+            // 写者在latch_for_write()中另外pin住了路径上的结点, 直到end_write()才会释放
+            buffer_pool_manager_->unpin_page(interval_handle->get_page_id(), false);
         }
         delete interval_handle;
         interval_handle = next_node_handle;
@@ -404,6 +508,144 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
     return std::make_pair(interval_handle, rootLocked);
 }
 
+/**
+ * @brief 不加锁地从根结点下降到key所在的叶子结点
+ * 每一层先在当前结点中找到孩子结点的page_no, 校验当前结点的版本号之后才访问孩子结点,
+ * 读到孩子结点的版本号后再校验一次当前结点, 保证孩子结点在读到它的版本号时仍挂在当前结点下面
+ *
+ * @param key 要查找的目标key值
+ * @param version 传出参数, 叶子结点的版本号, 读完叶子结点后需要再次校验
+ * @param parent_key 传出参数, 不为nullptr时拷贝父结点中指向叶子结点的key, 叶子结点是根结点时不修改
+ * @return IxNodeHandle* 叶子结点, 遇到并发修改时返回nullptr, 由调用者重试
+ * @note 返回的叶子结点没有加锁, 只需要unpin
+ */
+IxNodeHandle *IxIndexHandle::optimistic_find_leaf(const char *key, uint64_t *version, char *parent_key) {
+    auto release = [&](IxNodeHandle *node) {
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
+    };
+
+    page_id_t page_no = file_hdr_->root_page_;
+    IxNodeHandle *node = fetch_node(page_no);
+    uint64_t node_version;
+    // 根结点分裂或被删除后版本号会变化, 读到版本号之后还要确认它仍然是根结点
+    if (!node->page->read_version(&node_version) || file_hdr_->root_page_ != page_no) {
+        release(node);
+        return nullptr;
+    }
+
+    while (!node->is_leaf_page()) {
+        int child_idx = node->upper_bound(key) - 1;  // 与internal_lookup()相同
+        page_id_t child_page_no = node->value_at(child_idx);
+        if (parent_key != nullptr) {
+            node->copy_key(child_idx, parent_key);
+        }
+        if (!node->page->validate_version(node_version)) {
+            release(node);
+            return nullptr;
+        }
+        IxNodeHandle *child = fetch_node(child_page_no);
+        uint64_t child_version;
+        bool child_valid = child->page->read_version(&child_version);
+        bool node_valid = node->page->validate_version(node_version);
+        release(node);
+        if (!child_valid || !node_valid) {
+            release(child);
+            return nullptr;
+        }
+        node = child;
+        node_version = child_version;
+    }
+
+    *version = node_version;
+    return node;
+}
+
+/**
+ * @brief 乐观下降到key所在的叶子结点并对它加写锁
+ * 加锁后版本号必须恰好比下降时读到的大一, 否则叶子结点在下降之后被修改过, 可能已经不再包含key, 需要重新下降
+ *
+ * @param key 要插入或删除的key值
+ * @param parent_key 传出参数, 见optimistic_find_leaf()
+ * @return IxNodeHandle* 加了写锁的叶子结点, 连续OPTIMISTIC_WRITE_RETRIES次失败后返回nullptr
+ * @note need to WUnlatch and unpin the leaf node outside!
+ */
+IxNodeHandle *IxIndexHandle::latch_leaf(const char *key, char *parent_key) {
+    for (int i = 0; i < OPTIMISTIC_WRITE_RETRIES; i++) {
+        uint64_t version;
+        IxNodeHandle *leaf = optimistic_find_leaf(key, &version, parent_key);
+        if (leaf == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        leaf->page->Wlatch();
+        if (leaf->page->validate_version(version + 1)) {
+            return leaf;
+        }
+        leaf->page->WUnlatch();
+        buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        delete leaf;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 插入后叶子结点不需要分裂时, 只对叶子结点加写锁完成插入, 不持有root_latch_
+ *
+ * @param (key, value) 要插入的键值对
+ * @param page_no 传出参数, 插入到的叶子结点的page_no, key重复时为-1
+ * @return bool 是否已经完成; 返回false时需要分裂, 由insert_entry()持有root_latch_重做
+ */
+bool IxIndexHandle::insert_into_leaf(const char *key, const Rid &value, page_id_t *page_no) {
+    IxNodeHandle *leaf = latch_leaf(key, nullptr);
+    if (leaf == nullptr) {
+        return false;
+    }
+    int before_entry_cnt = leaf->get_size();
+    bool done = before_entry_cnt + 1 < leaf->get_max_size();
+    bool inserted = false;
+    if (done) {
+        inserted = leaf->insert(key, value) != before_entry_cnt;
+        *page_no = inserted ? leaf->get_page_no() : -1;
+    }
+    leaf->page->WUnlatch();
+    buffer_pool_manager_->unpin_page(leaf->get_page_id(), inserted);
+    delete leaf;
+    return done;
+}
+
+/**
+ * @brief 删除后只需要修改叶子结点时, 只对叶子结点加写锁完成删除, 不持有root_latch_
+ * 删除叶子结点的第一个key需要更新父结点, 删除后不足半满需要合并或重分配, 这两种情况返回false;
+ * 父结点中的key与叶子结点的第一个key不一致时也返回false, 由maintain_parent()顺带修正;
+ * 前缀压缩的索引中父结点的key是孩子结点的下界, 不随叶子结点的第一个key变化, 只有不足半满时返回false
+ *
+ * @param key 要删除的key值
+ * @param deleted 传出参数, key是否存在并被删除
+ * @return bool 是否已经完成; 返回false时由delete_entry()持有root_latch_重做
+ */
+bool IxIndexHandle::delete_from_leaf(const char *key, bool *deleted) {
+    std::vector<char> parent_key(file_hdr_->col_tot_len_);
+    IxNodeHandle *leaf = latch_leaf(key, parent_key.data());
+    if (leaf == nullptr) {
+        return false;
+    }
+    int size = leaf->get_size();
+    int key_idx = leaf->lower_bound(key);
+    bool exists = key_idx < size && leaf->compare_key(key_idx, key) == 0;
+    bool parent_unchanged = file_hdr_->compress_keys_ ||
+                            (key_idx > 0 && memcmp(parent_key.data(), leaf->get_key(0), file_hdr_->col_tot_len_) == 0);
+    bool done = !exists || leaf->is_root_page() || (size - 1 >= leaf->get_min_size() && parent_unchanged);
+    if (exists && done) {
+        leaf->erase_pair(key_idx);
+    }
+    *deleted = exists;
+    leaf->page->WUnlatch();
+    buffer_pool_manager_->unpin_page(leaf->get_page_id(), exists && done);
+    delete leaf;
+    return done;
+}
+
 /**
  * @brief 用于查找指定键在叶子结点中的对应的值result
  *
@@ -419,20 +661,18 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
     // 3. 把rid存入result参数中
     // 提示：使用完buffer_pool提供的page之后，记得unpin page；记得处理并发的上锁
 
-    auto res = find_leaf_page(key, Operation::FIND, transaction);
-    Rid *value;
-    if(res.first->leaf_lookup(key, &value) == true){
-        result->push_back(*value);
-    }
-    if(res.second){
-        root_latch_.unlock();
-        // std::cout << "get_value unlock" << std::endl;
+    bool found = false;
+    Rid rid;
+    read_leaf(key, [&](IxNodeHandle *leaf) {
+        Rid *value;
+        found = leaf->leaf_lookup(key, &value);
+        if (found) {
+            rid = *value;
+        }
+    });
+    if(found){
+        result->push_back(rid);
     }
-    res.first->page->RUnlatch();
-
-    buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
-    delete res.first;
-    res.first = nullptr;
 
     if(result->size() == 0){
         return false;
@@ -440,6 +680,41 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
     return true;
 }
 
+/**
+ * @brief 查找前prefix_len个字节与key相同的键值对, 用于带INCLUDE字段的索引按key字段做唯一性检查
+ * INCLUDE字段在B+树中按字节比较, 后面补0得到这一前缀下最小的key, 从它的lower_bound开始至多读一项
+ *
+ * @param key 查找的目标key值, 只使用前prefix_len个字节
+ * @param prefix_len 参与比较的前缀长度, 等于整个key的长度时就是get_value()
+ * @param result 用于存放结果的容器
+ * @param transaction 事务指针
+ * @return bool 返回前缀相同的键值对是否存在
+ */
+bool IxIndexHandle::get_value_by_prefix(const char *key, int prefix_len, std::vector<Rid> *result, Transaction *transaction) {
+    if (prefix_len == file_hdr_->col_tot_len_) {
+        return get_value(key, result, transaction);
+    }
+    std::vector<char> target(file_hdr_->col_tot_len_, 0);
+    memcpy(target.data(), key, prefix_len);
+
+    std::vector<char> found_key(file_hdr_->col_tot_len_);
+    Iid iid{IX_NO_PAGE, 0};
+    read_leaf(target.data(), [&](IxNodeHandle *leaf) {
+        iid = {leaf->get_page_no(), leaf->lower_bound(target.data())};
+        if (iid.slot_no == leaf->get_size()) {
+            // 这一前缀下的key都比叶子结点中的key大, 可能在下一个叶子结点的开头
+            iid = {leaf->get_page_no() == file_hdr_->last_leaf_ ? IX_NO_PAGE : leaf->get_next_leaf(), 0};
+        }
+    });
+    Rid rid;
+    if (iid.page_no == IX_NO_PAGE || !read_entry(iid, found_key.data(), &rid) ||
+        memcmp(found_key.data(), key, prefix_len) != 0) {
+        return false;
+    }
+    result->push_back(rid);
+    return true;
+}
+
 /**
  * @brief  将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
  * @param node 需要拆分的结点
@@ -474,8 +749,17 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
         next_node_handle = nullptr;
     }
     
-    new_node_handle->insert_pairs(0, node->get_key(pos), node->get_rid(pos), node->get_size()-pos);
+    int len = file_hdr_->col_tot_len_;
+    int n = node->get_size() - pos;
+    std::vector<char> keys(n * len);
+    for(int i=0; i<n; i++){
+        node->copy_key(pos + i, keys.data() + i * len);
+    }
+    // 右半部分的第一个key成为两个结点的分界, 新结点为空, 先设置上下界再插入
+    new_node_handle->set_fences(keys.data(), node->get_high_fence());
+    new_node_handle->insert_pairs(0, keys.data(), node->get_rid(pos), n);
     node->set_size(pos);
+    node->set_fences(node->get_low_fence(), keys.data());
 
     if(!node->is_leaf_page()){
         for(int i=0; i<new_node_handle->get_size(); i++){
@@ -519,7 +803,10 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
                 .next_leaf = IX_LEAF_HEADER_PAGE,
             };
         file_hdr_->root_page_ = new_root_handle->get_page_no(); // 更新file hdr的root page
-        new_root_handle->insert_pair(0, old_node->get_key(0), {old_node->get_page_no(), 0});
+        // 新的根结点是清零的页面, 上下界都是无穷
+        char first_key[IX_MAX_COL_LEN];
+        old_node->copy_key(0, first_key);
+        new_root_handle->insert_pair(0, first_key, {old_node->get_page_no(), 0});
         new_root_handle->insert_pair(1, key, {new_node->get_page_no(), 0});
         old_node->set_parent_page_no(new_root_handle->get_page_no());
         new_node->set_parent_page_no(new_root_handle->get_page_no());
@@ -540,7 +827,10 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
         // test del wlach
         // new_right_handle->page->Wlatch();
         // transaction->append_index_latch_page_set(new_right_handle->page);
-        insert_into_parent(parent_node_handle, new_right_handle->get_key(0), new_right_handle, transaction);
+        char split_key[IX_MAX_COL_LEN];
+        new_right_handle->copy_key(0, split_key);
+        insert_into_parent(parent_node_handle, split_key, new_right_handle, transaction);
+        buffer_pool_manager_->unpin_page(new_right_handle->get_page_id(), true);
         delete new_right_handle;
         new_right_handle = nullptr;
     }    
@@ -557,18 +847,27 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
  * @return page_id_t 插入到的叶结点的page_no
  */
 page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    add_to_bloom_filter(key);
     // Todo:
     // 1. 查找key值应该插入到哪个叶子节点
     // 2. 在该叶子节点中插入键值对
     // 3. 如果结点已满，分裂结点，并把新结点的相关信息插入父节点
     // 提示：记得unpin page；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
 
+    // 插入后叶子结点不需要分裂时, 只对叶子结点加写锁, 不同叶子结点上的插入可以并行
+    page_id_t fast_page_no;
+    if(insert_into_leaf(key, value, &fast_page_no)){
+        return fast_page_no;
+    }
+
     auto res = find_leaf_page(key, Operation::INSERT, transaction);
     page_id_t page_no = res.first->get_page_no();
     int before_entry_cnt = res.first->get_size();
     int now_entry_cnt = res.first->insert(key, value);
     if( now_entry_cnt == before_entry_cnt){
         // 没插入
+        buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
+        end_write();
         if(res.second){
             root_latch_.unlock();
             // std::cout << "insert_entry unlock" << std::endl;
@@ -582,10 +881,13 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
         // test del wlach
         // new_right_node_handle->page->Wlatch();
         // transaction->append_index_latch_page_set(new_right_node_handle->page);
-        insert_into_parent(res.first, new_right_node_handle->get_key(0), new_right_node_handle, transaction);
+        char split_key[IX_MAX_COL_LEN];
+        new_right_node_handle->copy_key(0, split_key);
+        insert_into_parent(res.first, split_key, new_right_node_handle, transaction);
         if(res.first->get_page_no() == file_hdr_->last_leaf_){
             file_hdr_->last_leaf_ = new_right_node_handle->get_page_no();
         }
+        buffer_pool_manager_->unpin_page(new_right_node_handle->get_page_id(), true);
         delete new_right_node_handle;
         new_right_node_handle = nullptr;
     }
@@ -599,6 +901,8 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
         buffer_pool_manager_->unpin_page(page->get_page_id(), true);
     }
 
+    buffer_pool_manager_->unpin_page(res.first->get_page_id(), true);
+    end_write();
     if(res.second){
         root_latch_.unlock();
         // std::cout << "insert_entry unlock" << std::endl;
@@ -623,9 +927,17 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     // 4. 如果需要并发，并且需要删除叶子结点，则需要在事务的delete_page_set中添加删除结点的对应页面；记得处理并发的上锁
 
     
+    // 删除后叶子结点不需要合并或者更新父结点时, 只对叶子结点加写锁
+    bool fast_deleted;
+    if(delete_from_leaf(key, &fast_deleted)){
+        return fast_deleted;
+    }
+
     auto res = find_leaf_page(key, Operation::DELETE, transaction);
     int now_size = res.first->get_size();
     if(now_size -1 != res.first->remove(key)){
+        buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
+        end_write();
         if(res.second){
             root_latch_.unlock();
             // std::cout << "delete_entry unlock" << std::endl;
@@ -649,12 +961,12 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
         // page->WUnlatch();
         buffer_pool_manager_->unpin_page(page->get_page_id(), true);
     }
-    while (!deletedPageSet->empty()) {
-        Page *page = deletedPageSet->front();
-        deletedPageSet->pop_front();
-        buffer_pool_manager_->delete_page(page->get_page_id());
-    }
+    // 被删除的结点已经在release_node_handle中挂到空闲页面链表上, 等待create_node复用
+    // 不能再从缓冲池中丢弃这些页面, 否则页面中的链表指针写不回磁盘
+    deletedPageSet->clear();
 
+    buffer_pool_manager_->unpin_page(res.first->get_page_id(), true);
+    end_write();
     if(res.second){
         root_latch_.unlock();
         // std::cout << "delete_entry unlock" << std::endl;
@@ -689,6 +1001,7 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
 
     if(node->is_root_page()) {
         if(adjust_root(node)){
+            release_node_handle(*node);
             transaction->append_index_deleted_page(node->page);
             return true;
         }
@@ -712,19 +1025,22 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
     // neighbor_node->page->Wlatch();
     // transaction->append_index_latch_page_set(neighbor_node->page);
 
+    // coalesce()可能交换node和neighbor_node, 先记下本函数pin住的兄弟结点
+    IxNodeHandle *fetched_neighbor = neighbor_node;
+    bool coalesced = false;
     if(node->get_size() + neighbor_node->get_size() >= node->get_min_size() * 2){
         redistribute(neighbor_node, node, parent_node, key_index);
     }else{
         coalesce(&neighbor_node, &node, &parent_node, key_index, transaction, root_is_latched);
-        buffer_pool_manager_->unpin_page(parent_node->get_page_id(), true);
-        return true;
+        coalesced = true;
     }
+    buffer_pool_manager_->unpin_page(fetched_neighbor->get_page_id(), true);
     buffer_pool_manager_->unpin_page(parent_node->get_page_id(), true);
-    delete neighbor_node;
-    neighbor_node = nullptr;
+    delete fetched_neighbor;
+    fetched_neighbor = nullptr;
     delete parent_node;
     parent_node = nullptr;
-    return false;
+    return coalesced;
 }
 
 /**
@@ -777,36 +1093,49 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
     // 3. 更新父节点中的相关信息，并且修改移动键值对对应孩字结点的父结点信息（maintain_child函数）
     // 注意：neighbor_node的位置不同，需要移动的键值对不同，需要分类讨论
 
+    // 移动的键值对和重分配后两个结点的分界key, 先拷贝出来, 压缩时结点重新编码会覆盖原来的位置
+    // node的范围变大, 在移入之前设置上下界; neighbor的范围变小, 在移出之后设置上下界
+    char key[IX_MAX_COL_LEN];
+    char separator[IX_MAX_COL_LEN];
     if(index == 0){
         // node(left)      neighbor(right)
+        Rid rid = *neighbor_node->get_rid(0);
         if(node->is_leaf_page()){
-            node->insert_pair(node->get_size(), neighbor_node->get_key(0), *neighbor_node->get_rid(0));
-            neighbor_node->erase_pair(0);
+            neighbor_node->copy_key(0, key);
         }
         else{
-            node->insert_pair(node->get_size(), parent->get_key(1), *neighbor_node->get_rid(0));
-            neighbor_node->erase_pair(0);
+            parent->copy_key(1, key);
+        }
+        neighbor_node->copy_key(1, separator);
+        node->set_fences(node->get_low_fence(), separator);
+        node->insert_pair(node->get_size(), key, rid);
+        neighbor_node->erase_pair(0);
+        neighbor_node->set_fences(separator, neighbor_node->get_high_fence());
+        if(!node->is_leaf_page()){
             maintain_child(node, node->get_size()-1);
         }
-        parent->set_key(1, neighbor_node->get_key(0));
+        parent->set_key(1, separator);
     }else{
         // neighbor(left)  node(right)
-        if(node->is_leaf_page()){
-            node->insert_pair(0, neighbor_node->get_key(neighbor_node->get_size()-1), *neighbor_node->get_rid(neighbor_node->get_size()-1));
-            neighbor_node->erase_pair(neighbor_node->get_size()-1);
-        }
-        else{
+        int last = neighbor_node->get_size()-1;
+        Rid rid = *neighbor_node->get_rid(last);
+        neighbor_node->copy_key(last, separator);
+        node->set_fences(separator, node->get_high_fence());
+        if(!node->is_leaf_page()){
             // node->insert_pair(1, parent->get_key(index), *neighbor_node->get_rid(index));
             // node->set_key(0, neighbor_node->get_key(neighbor_node->get_size()-1));
             // node->set_rid(0, *neighbor_node->get_rid(neighbor_node->get_size()-1));
-            node->set_key(0, parent->get_key(index));
-            node->insert_pair(0, neighbor_node->get_key(neighbor_node->get_size()-1), *neighbor_node->get_rid(neighbor_node->get_size()-1));
-            neighbor_node->erase_pair(neighbor_node->get_size()-1);
+            parent->copy_key(index, key);
+            node->set_key(0, key);
+        }
+        node->insert_pair(0, separator, rid);
+        neighbor_node->erase_pair(last);
+        neighbor_node->set_fences(neighbor_node->get_low_fence(), separator);
+        if(!node->is_leaf_page()){
             maintain_child(node, 0);
         }
-        parent->set_key(index, node->get_key(0));
+        parent->set_key(index, separator);
     }
-    buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
 }
 
 /**
@@ -839,22 +1168,31 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
         index = 1;
     }
     int pos = (*neighbor_node)->get_size();
+    int len = file_hdr_->col_tot_len_;
+    int n = (*node)->get_size();
+    std::vector<char> keys(std::max(n, 1) * len);
+    for(int i=0; i<n; i++){
+        (*node)->copy_key(i, keys.data() + i * len);
+    }
+    // 合并后左结点的范围扩大到右结点的上界
+    (*neighbor_node)->set_fences((*neighbor_node)->get_low_fence(), (*node)->get_high_fence());
     if((*node)->is_leaf_page()){
         if((*node)->get_page_no() == file_hdr_->last_leaf_)
             file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
         erase_leaf(*node);
-        (*neighbor_node)->insert_pairs(pos, (*node)->keys, (*node)->rids, (*node)->get_size());
+        (*neighbor_node)->insert_pairs(pos, keys.data(), (*node)->get_rid(0), n);
         maintain_parent(*neighbor_node);
     }
     else{
-        (*node)->set_key(0, (*parent)->get_key(index));
-        (*neighbor_node)->insert_pairs(pos, (*node)->keys, (*node)->rids, (*node)->get_size());
+        (*parent)->copy_key(index, keys.data());
+        (*neighbor_node)->insert_pairs(pos, keys.data(), (*node)->get_rid(0), n);
     }
     
     for(int i=pos; i<(*neighbor_node)->get_size(); i++){
         maintain_child( (*neighbor_node), i);
     }
     
+    release_node_handle(**node);
     transaction->append_index_deleted_page((*node)->page);
     // delete (*node);
     (*parent)->erase_pair(index);
@@ -876,23 +1214,48 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const {
     IxNodeHandle *node = fetch_node(iid.page_no);
-    node->page->Rlatch();
-    if (iid.slot_no == node->get_size()){
-        node->page->RUnlatch();
+    int size;
+    Rid ret_rid;
+    node->page->optimistic_read([&]() {
+        size = node->get_size();
+        if (iid.slot_no < size) {
+            ret_rid = *node->get_rid(iid.slot_no);
+        }
+    });
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
+    delete node;
+    node = nullptr;
+
+    if (iid.slot_no == size){
         return {-1, -1}; // 间隙锁，约定最后一个iid返回的是{-1, -1}
     }
-    if (iid.slot_no >= node->get_size()) {
-        node->page->RUnlatch();
+    if (iid.slot_no > size) {
         throw IndexEntryNotFoundError();
     }
-    node->page->RUnlatch();
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
-    Rid ret_rid = *node->get_rid(iid.slot_no);
+    return ret_rid;
+}
 
+/**
+ * @brief 读取iid对应的key和rid, 索引覆盖查询时不用回表, 直接从key中取出字段
+ *
+ * @param iid
+ * @param key 存放key的缓冲区, 长度为col_tot_len_
+ * @param rid 存放rid
+ * @return bool iid是否对应一个键值对, 最后一个叶子结点的末尾返回false
+ */
+bool IxIndexHandle::read_entry(const Iid &iid, char *key, Rid *rid) const {
+    IxNodeHandle *node = fetch_node(iid.page_no);
+    bool found = false;
+    node->page->optimistic_read([&]() {
+        found = iid.slot_no < node->get_size();
+        if (found) {
+            node->copy_key(iid.slot_no, key);
+            *rid = *node->get_rid(iid.slot_no);
+        }
+    });
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     delete node;
-    node = nullptr;
-
-    return ret_rid;
+    return found;
 }
 
 /**
@@ -905,26 +1268,17 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const {
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
     
-    auto res = find_leaf_page(key, Operation::FIND, nullptr);
     Iid ret;
-    ret.page_no = res.first->get_page_no();
-    ret.slot_no = res.first->lower_bound(key);
-
-    if(ret.slot_no == res.first->get_size() && ret.page_no != file_hdr_->last_leaf_ ){
-        // 如果key大于这个page的最大的key
-        ret.page_no = res.first->get_next_leaf();
-        ret.slot_no = 0;
-    }
-
-    if(res.second){
-        root_latch_.unlock();
-        // std::cout << "lower_bound unlock" << std::endl;
-    }
-    res.first->page->RUnlatch();
-
-    buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
-    delete res.first;
-    res.first = nullptr;
+    read_leaf(key, [&](IxNodeHandle *leaf) {
+        ret.page_no = leaf->get_page_no();
+        ret.slot_no = leaf->lower_bound(key);
+
+        if(ret.slot_no == leaf->get_size() && ret.page_no != file_hdr_->last_leaf_ ){
+            // 如果key大于这个page的最大的key
+            ret.page_no = leaf->get_next_leaf();
+            ret.slot_no = 0;
+        }
+    });
 
     return ret;
 }
@@ -937,23 +1291,20 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
     
-    auto res = find_leaf_page(key, Operation::FIND, nullptr);
     Iid ret;
-    ret.page_no = res.first->get_page_no();
-    ret.slot_no = res.first->upper_bound(key);
-    if(ret.page_no != file_hdr_->last_leaf_ && ret.slot_no == res.first->get_size()){
-        ret.page_no = res.first->get_next_leaf();
-        ret.slot_no = 0;
-    }
-    if(res.second){
-        root_latch_.unlock();
-        // std::cout << "upper_bound unlock" << std::endl;
-    }
-    res.first->page->RUnlatch();
-
-    buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
-    delete res.first;
-    res.first = nullptr;
+    read_leaf(key, [&](IxNodeHandle *leaf) {
+        ret.page_no = leaf->get_page_no();
+        // 结点的upper_bound()跳过第0个key, 只适用于内部结点; 父结点中的key可能小于叶子结点的第一个key,
+        // 叶子结点中由lower_bound()得到, key唯一, 等于key时后移一位
+        ret.slot_no = leaf->lower_bound(key);
+        if(ret.slot_no < leaf->get_size() && leaf->compare_key(ret.slot_no, key) == 0){
+            ret.slot_no++;
+        }
+        if(ret.page_no != file_hdr_->last_leaf_ && ret.slot_no == leaf->get_size()){
+            ret.page_no = leaf->get_next_leaf();
+            ret.slot_no = 0;
+        }
+    });
 
     return ret;
 }
@@ -964,126 +1315,94 @@ void IxIndexHandle::gap_lock(const char *min_key, const char* max_key, std::vect
     // range_latch_.lock();
     
     bool equal = !strncmp(min_key, max_key, file_hdr_->col_tot_len_);
-    // *lower_bound = this->lower_bound(min_key);
-    // *upper_bound = this->upper_bound(max_key);
-    
-    root_latch_.lock();
-    // std::cout << "gap_lock lock" << std::endl;
-    auto min_res = find_leaf_page(min_key, Operation::FIND, nullptr, true, false);
-    Iid lower_bound;
-    lower_bound.page_no = min_res.first->get_page_no();
-    lower_bound.slot_no = min_res.first->lower_bound(min_key);
-
-    if(lower_bound.slot_no == min_res.first->get_size() && lower_bound.page_no != file_hdr_->last_leaf_ ){
-        // 如果key大于这个page的最大的key
-        lower_bound.page_no = min_res.first->get_next_leaf();
-        lower_bound.slot_no = 0;
-    }
+    Iid lower_bound = this->lower_bound(min_key);
+    Iid upper_bound = this->upper_bound(max_key);
 
-    auto max_res = find_leaf_page(max_key, Operation::FIND, nullptr, true, false);
-    Iid upper_bound;
-    upper_bound.page_no = max_res.first->get_page_no();
-    upper_bound.slot_no = max_res.first->upper_bound(max_key);
-
-    if(upper_bound.slot_no == max_res.first->get_size() && upper_bound.page_no != file_hdr_->last_leaf_ ){
-        // 如果key大于这个page的最大的key
-        upper_bound.page_no = max_res.first->get_next_leaf();
-        upper_bound.slot_no = 0;
-    }
-    root_latch_.unlock();
-    // std::cout << "gap_lock unlock" << std::endl;
-
-    IxNodeHandle *node;
-    try{
+    // 先把叶子结点的内容拷贝出来再上行锁和间隙锁, 等待事务锁时不持有页面的读锁, 否则会挡住要修改该页面的写者
     if(equal){
         // 等值查询
-        node = fetch_node(lower_bound.page_no);
-        node->page->Rlatch();
+        IxNodeHandle *node = fetch_node(lower_bound.page_no);
+        int size;
+        bool key_equal = false;
+        Rid rid = {-1, -1};
+        node->page->optimistic_read([&]() {
+            size = node->get_size();
+            key_equal = false;
+            if(lower_bound.slot_no < size){
+                key_equal = node->compare_key(lower_bound.slot_no, min_key) == 0;
+                rid = *node->get_rid(lower_bound.slot_no);
+            }
+        });
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
+        node = nullptr;
 
-        if(lower_bound.page_no == file_hdr_->last_leaf_  && lower_bound.slot_no == node->get_size()){
+        if(lower_bound.page_no == file_hdr_->last_leaf_  && lower_bound.slot_no == size){
             // 最后一个节点, 对最后一个间隙上间隙锁, {-1， -1}标识为最后一个间隙
             context_->lock_mgr_->lock_gap_on_index(context_->txn_, {-1, -1}, this->fd_);
         }
-        else if(ix_compare(node->get_key(lower_bound.slot_no), min_key, node->file_hdr->col_types_, node->file_hdr->col_lens_) == 0){
+        else if(key_equal){
             // 只上一个行锁
-            context_->lock_mgr_->lock_shared_on_record(context_->txn_, *node->get_rid(lower_bound.slot_no), tab_fd);
-            ret_rids.push_back(this->get_rid(lower_bound));
+            context_->lock_mgr_->lock_shared_on_record(context_->txn_, rid, tab_fd);
+            ret_rids.push_back(rid);
         }
         else{
             // 值不存在
-            context_->lock_mgr_->lock_shared_on_record(context_->txn_, *node->get_rid(lower_bound.slot_no), tab_fd);
-            context_->lock_mgr_->lock_gap_on_index(context_->txn_, *node->get_rid(lower_bound.slot_no), this->fd_);
-            ret_rids.push_back(this->get_rid(lower_bound));
+            context_->lock_mgr_->lock_shared_on_record(context_->txn_, rid, tab_fd);
+            context_->lock_mgr_->lock_gap_on_index(context_->txn_, rid, this->fd_);
+            ret_rids.push_back(rid);
         }
         
     }
     else{
         Iid last;
         Iid cur = lower_bound;
+        int size;
+        page_id_t next_leaf;
+        std::vector<Rid> rids;
+        auto read_leaf_rids = [&](page_id_t page_no) {
+            IxNodeHandle *node = fetch_node(page_no);
+            node->page->optimistic_read([&]() {
+                size = node->get_size();
+                next_leaf = node->get_next_leaf();
+                rids.assign(node->get_rid(0), node->get_rid(size));
+            });
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            delete node;
+        };
         // 范围查询
-        node = fetch_node(cur.page_no);
-        node->page->Rlatch();
+        read_leaf_rids(cur.page_no);
         do
         {
-            if(cur.page_no == file_hdr_->last_leaf_  && cur.slot_no == node->get_size()){
+            if(cur.page_no == file_hdr_->last_leaf_  && cur.slot_no == size){
                 // 最后一个节点, 对最后一个间隙上间隙锁, {-1， -1}标识为最后一个间隙
                 context_->lock_mgr_->lock_gap_on_index(context_->txn_, {-1, -1}, this->fd_);
             }
             else{
-                context_->lock_mgr_->lock_shared_on_record(context_->txn_, *node->get_rid(cur.slot_no), tab_fd);
-                context_->lock_mgr_->lock_gap_on_index(context_->txn_, *node->get_rid(cur.slot_no), this->fd_);
-                ret_rids.push_back(this->get_rid(cur));
+                if (cur.slot_no >= size) {
+                    throw IndexEntryNotFoundError();
+                }
+                context_->lock_mgr_->lock_shared_on_record(context_->txn_, rids[cur.slot_no], tab_fd);
+                context_->lock_mgr_->lock_gap_on_index(context_->txn_, rids[cur.slot_no], this->fd_);
+                ret_rids.push_back(rids[cur.slot_no]);
             }
 
             last = cur;
 
             // increment slot no
             cur.slot_no++;
-            if (cur.page_no != file_hdr_->last_leaf_ && cur.slot_no == node->get_size()) {
+            if (cur.page_no != file_hdr_->last_leaf_ && cur.slot_no == size) {
                 
                 // go to next leaf
                 cur.slot_no = 0;
-                cur.page_no = node->get_next_leaf();
-
-                node->page->RUnlatch();
-                buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-
-                node = fetch_node(cur.page_no);
-                node->page->Rlatch();
+                cur.page_no = next_leaf;
+                read_leaf_rids(cur.page_no);
             }
             
         } while (last != upper_bound);
     }
-    }
-    catch (TransactionAbortException &e) {
-        node->page->RUnlatch();
-        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-        min_res.first->page->RUnlatch();
-        buffer_pool_manager_->unpin_page(min_res.first->get_page_id(), false);
-        max_res.first->page->RUnlatch();
-        buffer_pool_manager_->unpin_page(max_res.first->get_page_id(), false);
-        // range_latch_.unlock();
-        delete node;
-        node = nullptr;
-        throw TransactionAbortException (context_->txn_->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION); 
-    } 
-    
-    node->page->RUnlatch();
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-
-    min_res.first->page->RUnlatch();
-    buffer_pool_manager_->unpin_page(min_res.first->get_page_id(), false);
-    max_res.first->page->RUnlatch();
-    buffer_pool_manager_->unpin_page(max_res.first->get_page_id(), false);
 
     // range_latch_.unlock();
-
-    delete min_res.first;
-    min_res.first = nullptr;
-    delete max_res.first;
-    max_res.first = nullptr;
-    delete node;
-    node = nullptr;
     return;
 }
 
@@ -1095,7 +1414,8 @@ void IxIndexHandle::gap_lock(const char *min_key, const char* max_key, std::vect
  */
 Iid IxIndexHandle::leaf_end() const {
     IxNodeHandle *node = fetch_node(file_hdr_->last_leaf_);
-    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node->get_size()};
+    Iid iid = {.page_no = node->get_page_no(), .slot_no = 0};
+    node->page->optimistic_read([&]() { iid.slot_no = node->get_size(); });
     buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
     delete node;
     node = nullptr;
@@ -1122,6 +1442,7 @@ Iid IxIndexHandle::leaf_begin() const {
  */
 IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
     Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+    latch_for_write(page);
     IxNodeHandle *node = new IxNodeHandle(file_hdr_, page);
     
     return node;
@@ -1136,24 +1457,80 @@ IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
  * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
  * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
  * 与Record的处理不同，Record将未插入满的记录页认为是free_page
+ * 空闲链表不为空时优先复用链表头的页面，否则才在文件末尾分配新页面
  */
 IxNodeHandle *IxIndexHandle::create_node() {
     IxNodeHandle *node;
-    file_hdr_->num_pages_++;
+    {
+        std::lock_guard<std::mutex> guard(free_latch_);
+        if (file_hdr_->first_free_page_no_ != IX_NO_PAGE) {
+            node = fetch_node(file_hdr_->first_free_page_no_);
+            file_hdr_->first_free_page_no_ = node->page_hdr->next_free_page_no;
+            // 与new_page返回的页面一样清零, 调用者只需初始化自己关心的字段
+            memset(node->page->get_data(), 0, PAGE_SIZE);
+            node->page_hdr->next_free_page_no = IX_NO_PAGE;
+            return node;
+        }
+        file_hdr_->num_pages_++;
+    }
 
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
     // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
     Page *page = buffer_pool_manager_->new_page(&new_page_id);
+    latch_for_write(page);
     node = new IxNodeHandle(file_hdr_, page);
     return node;
 }
 
+/**
+ * @brief 插入或删除开始, 调用者已经持有root_latch_
+ * 此后当前线程通过fetch_node()/create_node()访问的页面都会加写锁, 直到end_write()
+ */
+void IxIndexHandle::begin_write() {
+    writer_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief 如果当前线程是写者, 对page加写锁并额外pin住, 同一个页面只加一次
+ * 读者不加锁, 直接返回
+ *
+ * @param page 刚刚fetch或者new出来的页面
+ */
+void IxIndexHandle::latch_for_write(Page *page) const {
+    if (writer_.load(std::memory_order_relaxed) != std::this_thread::get_id()) {
+        return;
+    }
+    if (std::find(write_latched_pages_.begin(), write_latched_pages_.end(), page) != write_latched_pages_.end()) {
+        return;
+    }
+    // 写者自己的代码可能提前unpin, 额外pin住保证解锁之前页面不会被换出
+    buffer_pool_manager_->fetch_page(page->get_page_id());
+    page->Wlatch();
+    write_latched_pages_.push_back(page);
+}
+
+/**
+ * @brief 插入或删除结束, 在释放root_latch_之前调用, 释放begin_write()之后加的所有写锁
+ */
+void IxIndexHandle::end_write() {
+    writer_.store(std::thread::id(), std::memory_order_relaxed);
+    for (Page *page : write_latched_pages_) {
+        page->WUnlatch();
+        buffer_pool_manager_->unpin_page(page->get_page_id(), true);
+    }
+    write_latched_pages_.clear();
+}
+
 /**
  * @brief 从node开始更新其父节点的第一个key，一直向上更新直到根节点
  *
  * @param node
+ * @note 前缀压缩的索引中父结点的key是孩子结点的下界fence key, 修改会改变两个孩子结点的范围, 不做更新
  */
 void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
+    if (file_hdr_->compress_keys_) {
+        return;
+    }
     IxNodeHandle *curr = node;
     std::vector<IxNodeHandle *> need_del;
     while (curr->get_parent_page_no() != IX_NO_PAGE) {
@@ -1163,7 +1540,7 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
         char *parent_key = parent->get_key(rank);
         char *child_first_key = curr->get_key(0);
         if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) {
-            assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
+            buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
             delete parent;
             parent = nullptr;
             break;
@@ -1172,7 +1549,7 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
         memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
         curr = parent;
 
-        assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
+        buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
     }
     for(auto x: need_del){
         delete x;
@@ -1201,12 +1578,110 @@ void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 删除node时，把node所在的页面挂到空闲页面链表的表头，供create_node复用
  *
- * @param node
+ * @param node 要删除的结点，调用时必须处于pin状态
+ * @note num_pages不减少，空闲页面仍然占据文件中的位置
  */
 void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
-    file_hdr_->num_pages_--;
+    // 额外pin一次并以脏页unpin, 保证链表指针一定会写回磁盘, 不依赖调用者unpin时的is_dirty
+    Page *page = buffer_pool_manager_->fetch_page(node.get_page_id());
+    assert(page == node.page);
+    {
+        std::lock_guard<std::mutex> guard(free_latch_);
+        node.set_size(0);
+        node.page_hdr->next_free_page_no = file_hdr_->first_free_page_no_;
+        file_hdr_->first_free_page_no_ = node.get_page_no();
+    }
+    buffer_pool_manager_->unpin_page(page->get_page_id(), true);
+}
+
+/**
+ * @brief 沿空闲页面链表统计可以回收复用的页面个数
+ *
+ * @return int 空闲页面个数
+ */
+int IxIndexHandle::get_num_free_pages() {
+    std::lock_guard<std::mutex> guard(free_latch_);
+    int num_free_pages = 0;
+    page_id_t page_no = file_hdr_->first_free_page_no_;
+    while (page_no != IX_NO_PAGE && num_free_pages < file_hdr_->num_pages_) {
+        IxNodeHandle *node = fetch_node(page_no);
+        page_no = node->page_hdr->next_free_page_no;
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
+        num_free_pages++;
+    }
+    return num_free_pages;
+}
+
+/**
+ * @brief 逐层遍历B+树, 统计树高、结点数和key占用的空间
+ * 持有root_latch_使树的结构不变, 只修改叶子结点的写者仍可能并发执行, 读每个结点时加读锁
+ *
+ * @return IxIndexStats
+ */
+IxIndexStats IxIndexHandle::get_stats() {
+    std::lock_guard<std::mutex> guard(root_latch_);
+    IxIndexStats stats;
+    int len = file_hdr_->col_tot_len_;
+    std::vector<page_id_t> level = {file_hdr_->root_page_};
+    while (!level.empty()) {
+        stats.height++;
+        std::vector<page_id_t> next_level;
+        for (page_id_t page_no : level) {
+            IxNodeHandle *node = fetch_node(page_no);
+            node->page->Rlatch();
+            int size = node->get_size();
+            int prefix_len = node->get_prefix_len();
+            if (node->is_leaf_page()) {
+                stats.num_leaf_pages++;
+                stats.num_entries += size;
+            } else {
+                stats.num_internal_pages++;
+                for (int i = 0; i < size; i++) {
+                    next_level.push_back(node->value_at(i));
+                }
+            }
+            stats.prefix_bytes += prefix_len;
+            stats.key_bytes += static_cast<size_t>(size) * len;
+            stats.stored_key_bytes += static_cast<size_t>(size) * (len - prefix_len);
+            if (file_hdr_->compress_keys_) {
+                stats.stored_key_bytes += 2 * len;
+            }
+            node->page->RUnlatch();
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            delete node;
+        }
+        level.swap(next_level);
+    }
+    return stats;
+}
+
+/**
+ * @brief 从根结点逐层向下, 把叶子结点中的每个完整key交给visit, 用于建立布隆过滤器
+ */
+void IxIndexHandle::scan_keys(const std::function<void(const char *)> &visit) {
+    std::lock_guard<std::mutex> guard(root_latch_);
+    std::vector<char> key(file_hdr_->col_tot_len_);
+    std::vector<page_id_t> level = {file_hdr_->root_page_};
+    while (!level.empty()) {
+        std::vector<page_id_t> next_level;
+        for (page_id_t page_no : level) {
+            IxNodeHandle *node = fetch_node(page_no);
+            for (int i = 0; i < node->get_size(); i++) {
+                if (node->is_leaf_page()) {
+                    node->copy_key(i, key.data());
+                    visit(key.data());
+                } else {
+                    next_level.push_back(node->value_at(i));
+                }
+            }
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            delete node;
+        }
+        level.swap(next_level);
+    }
 }
 
 /**
@@ -1222,4 +1697,177 @@ void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
         delete child;
         child = nullptr;
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 树中是否还没有任何键值对, 只有空树可以批量建立
+ */
+bool IxIndexHandle::can_bulk_load() {
+    IxNodeHandle *root = fetch_node(file_hdr_->root_page_);
+    bool empty = root->is_leaf_page() && root->get_size() == 0;
+    buffer_pool_manager_->unpin_page(root->get_page_id(), false);
+    delete root;
+    return empty;
+}
+
+/**
+ * @brief 用排好序的键值对自底向上批量建立B+树: 先依次填满叶子结点, 再用每个结点的第一个key逐层建立内部结点,
+ * 每个页面只写一次, 不需要逐条插入时的查找和分裂
+ * 调用者保证树为空(can_bulk_load())且没有其他线程访问这个索引
+ *
+ * @param sorter 已经finish()的外部排序, 重复的key只保留第一个, 与逐条插入时一致
+ * @param fill_factor 每个结点的填充率
+ * @return size_t 插入的键值对数量
+ */
+size_t IxIndexHandle::bulk_load(IxExternalSorter *sorter, double fill_factor) {
+    std::lock_guard<std::mutex> guard(root_latch_);
+    int len = file_hdr_->col_tot_len_;
+
+    // 空的根结点没有fence key, 前缀长度为0, 它的容量就是前缀压缩时最保守的容量
+    IxNodeHandle *root = fetch_node(file_hdr_->root_page_);
+    assert(root->is_leaf_page() && root->get_size() == 0);
+    int capacity = root->get_max_size() - 1;
+    int min_size = root->get_min_size();
+    page_id_t first_leaf = root->get_page_no();
+    buffer_pool_manager_->unpin_page(root->get_page_id(), false);
+    delete root;
+    int target = std::max(min_size, std::min(capacity, static_cast<int>(capacity * fill_factor)));
+
+    std::vector<char> last_key(len);
+    size_t num_keys = 0;
+    auto next_leaf_entry = [&](const char **key, Rid *rid) {
+        while (sorter->next(key, rid)) {
+            if (num_keys > 0 && ix_compare(*key, last_key.data(), file_hdr_) == 0) {
+                continue;
+            }
+            memcpy(last_key.data(), *key, len);
+            num_keys++;
+            add_to_bloom_filter(*key);
+            return true;
+        }
+        return false;
+    };
+    std::vector<char> first_keys;
+    std::vector<page_id_t> page_nos;
+    // 第一个叶子结点复用原来的空根结点
+    bulk_build_level(true, first_leaf, target, min_size, next_leaf_entry, &first_keys, &page_nos);
+    if (page_nos.empty()) {
+        return 0;
+    }
+    file_hdr_->first_leaf_ = page_nos.front();
+    file_hdr_->last_leaf_ = page_nos.back();
+    IxNodeHandle *leaf_header = fetch_node(IX_LEAF_HEADER_PAGE);
+    leaf_header->set_next_leaf(page_nos.front());
+    leaf_header->set_prev_leaf(page_nos.back());
+    buffer_pool_manager_->unpin_page(leaf_header->get_page_id(), true);
+    delete leaf_header;
+
+    // 内部结点中第i个key是第i个孩子的第一个key, 一层只剩一个结点时它就是根结点
+    while (page_nos.size() > 1) {
+        std::vector<char> child_keys;
+        std::vector<page_id_t> child_page_nos;
+        child_keys.swap(first_keys);
+        child_page_nos.swap(page_nos);
+        size_t child_idx = 0;
+        auto next_child = [&](const char **key, Rid *rid) {
+            if (child_idx == child_page_nos.size()) {
+                return false;
+            }
+            *key = child_keys.data() + child_idx * len;
+            *rid = {.page_no = child_page_nos[child_idx], .slot_no = 0};
+            child_idx++;
+            return true;
+        };
+        bulk_build_level(false, IX_NO_PAGE, target, min_size, next_child, &first_keys, &page_nos);
+    }
+    update_root_page_no(page_nos[0]);
+    return num_keys;
+}
+
+/**
+ * @brief 批量建立B+树的一层: 每个结点放target个键值对后开始下一个结点, 最后一个结点不足min_size时与前一个结点平分
+ * 因此前一个结点的键值对等到下一个结点写满或者这一层结束才写入页面, 此时它的上界fence key也已经确定
+ *
+ * @param is_leaf 是否是叶子层
+ * @param first_page_no 这一层的第一个结点使用的页面, IX_NO_PAGE表示新分配
+ * @param next 按key从小到大取出这一层的下一个键值对, 内部结点的rid是孩子结点的页号
+ * @param first_keys 传出参数, 这一层每个结点的第一个key
+ * @param page_nos 传出参数, 这一层每个结点的页号
+ */
+void IxIndexHandle::bulk_build_level(bool is_leaf, page_id_t first_page_no, int target, int min_size,
+                                     const std::function<bool(const char **, Rid *)> &next,
+                                     std::vector<char> *first_keys, std::vector<page_id_t> *page_nos) {
+    int len = file_hdr_->col_tot_len_;
+    std::vector<char> pending_keys, cur_keys;
+    std::vector<Rid> pending_rids, cur_rids;
+    IxNodeHandle *prev_leaf = nullptr;  // 上一个叶子结点, 下一个叶子结点分配页面后才能设置它的next_leaf
+
+    auto write_node = [&](std::vector<char> &keys, std::vector<Rid> &rids, const char *high) {
+        bool first = page_nos->empty();
+        IxNodeHandle *node = first && first_page_no != IX_NO_PAGE ? fetch_node(first_page_no) : create_node();
+        *node->page_hdr = {
+            .next_free_page_no = IX_NO_PAGE,
+            .parent = IX_NO_PAGE,
+            .num_key = 0,
+            .is_leaf = is_leaf,
+            .fence_flags = 0,
+            .prefix_len = 0,
+            .prev_leaf = IX_LEAF_HEADER_PAGE,
+            .next_leaf = IX_LEAF_HEADER_PAGE,
+        };
+        // 每层最左边的结点没有下界, 与分裂得到的树一致
+        node->set_fences(first ? nullptr : keys.data(), high);
+        node->insert_pairs(0, keys.data(), rids.data(), rids.size());
+        assert(node->get_size() == (int)rids.size());
+        first_keys->insert(first_keys->end(), keys.begin(), keys.begin() + len);
+        page_nos->push_back(node->get_page_no());
+        if (is_leaf) {
+            if (prev_leaf != nullptr) {
+                node->set_prev_leaf(prev_leaf->get_page_no());
+                prev_leaf->set_next_leaf(node->get_page_no());
+                buffer_pool_manager_->unpin_page(prev_leaf->get_page_id(), true);
+                delete prev_leaf;
+            }
+            prev_leaf = node;
+        } else {
+            for (int i = 0; i < node->get_size(); i++) {
+                maintain_child(node, i);
+            }
+            buffer_pool_manager_->unpin_page(node->get_page_id(), true);
+            delete node;
+        }
+        keys.clear();
+        rids.clear();
+    };
+
+    const char *key;
+    Rid rid;
+    while (next(&key, &rid)) {
+        if ((int)cur_rids.size() == target) {
+            if (!pending_rids.empty()) {
+                write_node(pending_keys, pending_rids, cur_keys.data());
+            }
+            pending_keys.swap(cur_keys);
+            pending_rids.swap(cur_rids);
+        }
+        cur_keys.insert(cur_keys.end(), key, key + len);
+        cur_rids.push_back(rid);
+    }
+    if (!pending_rids.empty() && (int)cur_rids.size() < min_size) {
+        int total = pending_rids.size() + cur_rids.size();
+        int move = pending_rids.size() - (total - total / 2);
+        cur_keys.insert(cur_keys.begin(), pending_keys.end() - move * len, pending_keys.end());
+        cur_rids.insert(cur_rids.begin(), pending_rids.end() - move, pending_rids.end());
+        pending_keys.resize(pending_keys.size() - move * len);
+        pending_rids.resize(pending_rids.size() - move);
+    }
+    if (!pending_rids.empty()) {
+        write_node(pending_keys, pending_rids, cur_keys.data());
+    }
+    if (!cur_rids.empty()) {
+        write_node(cur_keys, cur_rids, nullptr);
+    }
+    if (prev_leaf != nullptr) {
+        buffer_pool_manager_->unpin_page(prev_leaf->get_page_id(), true);
+        delete prev_leaf;
+    }
+}
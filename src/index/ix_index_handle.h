@@ -11,11 +11,16 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include "ix_defs.h"
+#include "ix_handle.h"
 #include "transaction/transaction.h"
 #include "transaction/concurrency/lock_manager.h"
 #include <cmath>
+#include <functional>
+#include <thread>
 #include "common/context.h"
 
+class IxExternalSorter;
+
 enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
 
 static const bool binary_search = false;
@@ -49,7 +54,78 @@ inline int ix_compare(const char* a, const char* b, const std::vector<ColType>&
     return 0;
 }
 
-/* 管理B+树中的每个节点 */
+/* 各种IxKeyKind对应的比较函数, 作为模板参数传给结点内的查找, 使比较可以内联 */
+struct IxIntCompare {
+    int operator()(const char *a, const char *b) const {
+        int ia = *(const int *)a;
+        int ib = *(const int *)b;
+        return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
+    }
+};
+
+struct IxFloatCompare {
+    int operator()(const char *a, const char *b) const {
+        float fa = *(const float *)a;
+        float fb = *(const float *)b;
+        return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+    }
+};
+
+struct IxBytesCompare {
+    int len;
+    int operator()(const char *a, const char *b) const { return memcmp(a, b, len); }
+};
+
+struct IxIntsCompare {
+    int num;
+    int operator()(const char *a, const char *b) const {
+        for (int i = 0; i < num; i++) {
+            int res = IxIntCompare()(a + i * sizeof(int), b + i * sizeof(int));
+            if (res != 0) return res;
+        }
+        return 0;
+    }
+};
+
+struct IxMixedCompare {
+    const IxFileHdr *file_hdr;
+    int operator()(const char *a, const char *b) const {
+        return ix_compare(a, b, file_hdr->col_types_, file_hdr->col_lens_);
+    }
+};
+
+/**
+ * @description: 按file_hdr->key_kind_选出比较函数并调用fn(compare), 每次查找只分派一次
+ * @param {IxFileHdr*} file_hdr 索引文件头
+ * @param {Fn} fn 以比较函数为参数的泛型lambda
+ * @param {int} prefix_len 比较前已经跳过的公共前缀长度, 只有前缀压缩的BYTES索引不为0
+ * @return fn的返回值
+ */
+template <typename Fn>
+inline auto ix_dispatch_compare(const IxFileHdr *file_hdr, Fn &&fn, int prefix_len = 0) {
+    switch (file_hdr->key_kind_) {
+        case IxKeyKind::INT:
+            return fn(IxIntCompare());
+        case IxKeyKind::FLOAT:
+            return fn(IxFloatCompare());
+        case IxKeyKind::BYTES:
+            return fn(IxBytesCompare{file_hdr->col_tot_len_ - prefix_len});
+        case IxKeyKind::INTS:
+            return fn(IxIntsCompare{file_hdr->col_num_});
+        default:
+            return fn(IxMixedCompare{file_hdr});
+    }
+}
+
+/* 单次比较两个完整的key, 比逐字段的ix_compare()少了按字段类型的判断 */
+inline int ix_compare(const char *a, const char *b, const IxFileHdr *file_hdr) {
+    return ix_dispatch_compare(file_hdr, [&](auto compare) { return compare(a, b); });
+}
+
+/* 管理B+树中的每个节点
+ * 前缀压缩的索引中结点的布局为 [IxPageHdr][下界fence key][上界fence key][key后缀][rids],
+ * 结点中的key都落在[下界, 上界)内, 因此共享两个fence key的最长公共前缀, 每个key只存储去掉前缀后的后缀;
+ * 前缀长度随fence key变化, rids的位置也随之变化, 通过key_slots()和rid_slots()访问 */
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
@@ -74,9 +150,23 @@ class IxNodeHandle {
 
     void set_size(int size) { page_hdr->num_key = size; }
 
-    int get_max_size() { return file_hdr->btree_order_ + 1; }
+    int get_max_size() const {
+        return file_hdr->compress_keys_ ? max_size_for(get_prefix_len()) : file_hdr->btree_order_ + 1;
+    }
+
+    // 前缀压缩的结点按没有公共前缀时的容量计算, 保证合并和重分配后的结点在任何前缀长度下都放得下
+    int get_min_size() const { return (file_hdr->compress_keys_ ? max_size_for(0) : get_max_size()) / 2; }
 
-    int get_min_size() { return get_max_size() / 2; }
+    // 前缀长度为prefix_len时结点能容纳的键值对数量, 与btree_order_一样多留了一个空位
+    int max_size_for(int prefix_len) const {
+        int len = file_hdr->col_tot_len_;
+        return (PAGE_SIZE - sizeof(IxPageHdr) - 2 * len - (alignof(Rid) - 1)) / (len - prefix_len + sizeof(Rid));
+    }
+
+    // 乐观读的读者可能读到正在修改的页面, 前缀长度截断到合法范围内, 保证访问不越过页面
+    int get_prefix_len() const {
+        return file_hdr->compress_keys_ ? std::min<int>(page_hdr->prefix_len, file_hdr->col_tot_len_ - 1) : 0;
+    }
 
     int key_at(int i) { return *(int *)get_key(i); }
 
@@ -103,13 +193,32 @@ class IxNodeHandle {
 
     void set_parent_page_no(page_id_t parent) { page_hdr->parent = parent; }
 
-    char *get_key(int key_idx) const { return keys + key_idx * file_hdr->col_tot_len_; }
+    // 只能用于不压缩的索引, 前缀压缩时用copy_key()和compare_key()
+    char *get_key(int key_idx) const {
+        assert(!file_hdr->compress_keys_);
+        return keys + key_idx * file_hdr->col_tot_len_;
+    }
+
+    Rid *get_rid(int rid_idx) const { return &rid_slots()[rid_idx]; }
+
+    void set_key(int key_idx, const char *key) {
+        int prefix_len = get_prefix_len();
+        assert(memcmp(key, low_fence(), prefix_len) == 0);
+        memcpy(key_slot(key_idx), key + prefix_len, file_hdr->col_tot_len_ - prefix_len);
+    }
+
+    void set_rid(int rid_idx, const Rid &rid) { rid_slots()[rid_idx] = rid; }
+
+    void copy_key(int key_idx, char *dest) const;
+
+    int compare_key(int key_idx, const char *key) const;
 
-    Rid *get_rid(int rid_idx) const { return &rids[rid_idx]; }
+    // 结点的下界和上界, nullptr表示无穷, 不压缩的索引不维护fence key
+    const char *get_low_fence() const { return page_hdr->fence_flags & IX_HAS_LOW_FENCE ? low_fence() : nullptr; }
 
-    void set_key(int key_idx, const char *key) { memcpy(keys + key_idx * file_hdr->col_tot_len_, key, file_hdr->col_tot_len_); }
+    const char *get_high_fence() const { return page_hdr->fence_flags & IX_HAS_HIGH_FENCE ? high_fence() : nullptr; }
 
-    void set_rid(int rid_idx, const Rid &rid) { rids[rid_idx] = rid; }
+    void set_fences(const char *low, const char *high);
 
     int lower_bound(const char *target) const;
 
@@ -158,10 +267,29 @@ class IxNodeHandle {
         assert(rid_idx < page_hdr->num_key);
         return rid_idx;
     }
+
+   private:
+    char *low_fence() const { return page->get_data() + sizeof(IxPageHdr); }
+
+    char *high_fence() const { return low_fence() + file_hdr->col_tot_len_; }
+
+    char *key_slots() const { return file_hdr->compress_keys_ ? high_fence() + file_hdr->col_tot_len_ : keys; }
+
+    char *key_slot(int key_idx) const { return key_slots() + key_idx * (file_hdr->col_tot_len_ - get_prefix_len()); }
+
+    Rid *rid_slots() const {
+        if (!file_hdr->compress_keys_) {
+            return rids;
+        }
+        int prefix_len = get_prefix_len();
+        size_t slots_size = max_size_for(prefix_len) * (file_hdr->col_tot_len_ - prefix_len);
+        slots_size = (slots_size + alignof(Rid) - 1) / alignof(Rid) * alignof(Rid);
+        return reinterpret_cast<Rid *>(key_slots() + slots_size);
+    }
 };
 
 /* B+树 */
-class IxIndexHandle {
+class IxIndexHandle : public IxHandle {
     friend class IxScan;
     friend class IxManager;
 
@@ -170,18 +298,28 @@ class IxIndexHandle {
     BufferPoolManager *buffer_pool_manager_;
     int fd_;                                    // 存储B+树的文件
     IxFileHdr* file_hdr_;                       // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;
+    std::mutex root_latch_;  // 分裂、合并等会修改多个结点的插入删除互斥执行; 只修改一个叶子结点的插入删除和查找都不持有
     std::mutex range_latch_; //做范围查找的latch
+    std::mutex free_latch_;  // 保护file_hdr_中的空闲页面链表
+
+    // 需要分裂或合并的插入删除持有root_latch_串行执行, 写者对访问到的每个页面加写锁使其版本号变化,
+    // 乐观读的读者和只修改叶子结点的写者据此发现冲突
+    std::atomic<std::thread::id> writer_;                // 当前正在执行插入或删除的线程
+    mutable std::vector<Page *> write_latched_pages_;    // 写者已加写锁的页面, 写操作结束时统一解锁, 只由writer_访问
 
     // use for load , storage fetch page and unpin batch
     std::unordered_map<page_id_t, IxNodeHandle*> batch_fetch_page;
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
-    int GetFd() { return fd_; }
+    int GetFd() override { return fd_; }
+
+    const IxFileHdr *get_file_hdr() const { return file_hdr_; }
 
     // for search
-    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) override;
+
+    bool get_value_by_prefix(const char *key, int prefix_len, std::vector<Rid> *result, Transaction *transaction) override;
 
     std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
                                                  bool find_first = false, bool root_latch = true);
@@ -189,19 +327,19 @@ class IxIndexHandle {
     std::pair<IxNodeHandle *, bool> find_leaf_page_for_load(const char *key, Operation operation, Transaction *transaction,
                                                  bool find_first = false, bool root_latch = true);
 
-    page_id_t insert_entry_for_load(const char *key, const Rid &value, Transaction *transaction);
+    page_id_t insert_entry_for_load(const char *key, const Rid &value, Transaction *transaction) override;
     
-    bool unpin_n_page(); 
+    bool unpin_n_page() override;
 
     // for insert
-    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction) override;
 
     IxNodeHandle *split(IxNodeHandle *node);
 
     void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
 
     // for delete
-    bool delete_entry(const char *key, Transaction *transaction);
+    bool delete_entry(const char *key, Transaction *transaction) override;
 
     bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
                                 bool *root_is_latched = nullptr);
@@ -222,6 +360,21 @@ class IxIndexHandle {
 
     Iid leaf_begin() const;
 
+    // for space report
+    int get_num_pages() const override { return file_hdr_->num_pages_; }
+
+    int get_num_free_pages() override;
+
+    // for index stats
+    IxIndexStats get_stats() override;
+
+    void scan_keys(const std::function<void(const char *)> &visit) override;
+
+    // for bulk load
+    bool can_bulk_load();
+
+    size_t bulk_load(IxExternalSorter *sorter, double fill_factor = IX_BULK_LOAD_FILL_FACTOR);
+
    private:
     // 辅助函数
     void update_root_page_no(page_id_t root) { file_hdr_->root_page_ = root; }
@@ -242,7 +395,68 @@ class IxIndexHandle {
 
     void maintain_child(IxNodeHandle *node, int child_idx);
 
+    void bulk_build_level(bool is_leaf, page_id_t first_page_no, int target, int min_size,
+                          const std::function<bool(const char **, Rid *)> &next, std::vector<char> *first_keys,
+                          std::vector<page_id_t> *page_nos);
+
+    // for optimistic read
+    IxNodeHandle *optimistic_find_leaf(const char *key, uint64_t *version, char *parent_key = nullptr);
+
+    IxNodeHandle *latch_leaf(const char *key, char *parent_key);
+
+    bool insert_into_leaf(const char *key, const Rid &value, page_id_t *page_no);
+
+    bool delete_from_leaf(const char *key, bool *deleted);
+
+    template <typename Fn>
+    void read_leaf(const char *key, Fn &&read);
+
+    // for write latch
+    void begin_write();
+
+    void latch_for_write(Page *page) const;
+
+    void end_write();
+
     public:
     // for index test
     Rid get_rid(const Iid &iid) const;
-};
\ No newline at end of file
+
+    // for index only scan
+    bool read_entry(const Iid &iid, char *key, Rid *rid) const;
+};
+
+/**
+ * @brief 在key所在的叶子结点上执行只读操作read
+ * 先不加锁地从根结点乐观下降, 读完后校验叶子结点的版本号; 连续失败OPTIMISTIC_READ_RETRIES次后
+ * 退化为find_leaf_page()加锁下降
+ *
+ * @param key 要查找的key值
+ * @param read 只读操作, 参数为叶子结点, 可能被执行多次, 只能把结果写到局部变量中
+ */
+template <typename Fn>
+void IxIndexHandle::read_leaf(const char *key, Fn &&read) {
+    for (int i = 0; i < OPTIMISTIC_READ_RETRIES; i++) {
+        uint64_t version;
+        IxNodeHandle *leaf = optimistic_find_leaf(key, &version);
+        if (leaf == nullptr) {
+            continue;
+        }
+        read(leaf);
+        bool valid = leaf->page->validate_version(version);
+        buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        delete leaf;
+        if (valid) {
+            return;
+        }
+    }
+
+    auto res = find_leaf_page(key, Operation::FIND, nullptr);
+    read(res.first);
+    if (res.second) {
+        root_latch_.unlock();
+    }
+    res.first->page->RUnlatch();
+    buffer_pool_manager_->unpin_page(res.first->get_page_id(), false);
+    delete res.first;
+}
\ No newline at end of file
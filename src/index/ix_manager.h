@@ -10,11 +10,13 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
 #include "system/sm_meta.h"
 #include "ix_defs.h"
+#include "ix_hash_handle.h"
 #include "ix_index_handle.h"
 
 class IxManager {
@@ -86,6 +88,12 @@ class IxManager {
             fhdr->col_types_.push_back(index_cols[i].type);
             fhdr->col_lens_.push_back(index_cols[i].len);
         }
+        // 只含CHAR字段的key按memcmp比较, 同一结点中的key共享上下界的公共前缀, 可以只存后缀
+        // 每个结点要多存两个fence key, key太长时结点放不下足够多的键值对, 不做压缩
+        fhdr->compress_keys_ = IX_KEY_PREFIX_COMPRESSION &&
+                               std::all_of(index_cols.begin(), index_cols.end(),
+                                           [](const ColMeta &col) { return col.type == TYPE_STRING; }) &&
+                               (PAGE_SIZE - sizeof(IxPageHdr) - 2 * col_tot_len - (alignof(Rid) - 1)) / (col_tot_len + sizeof(Rid)) > 4;
         fhdr->update_tot_len();
         
         char* data = new char[fhdr->tot_len_];
@@ -133,6 +141,54 @@ class IxManager {
         disk_manager_->close_file(fd);
     }
 
+    /**
+     * @description: 创建可扩展哈希索引文件, 初始时全局深度为0, 目录只有一项, 指向唯一的空桶
+     * 桶的容量由页面大小决定, 而不是固定的BUCKET_SIZE
+     */
+    void create_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        disk_manager_->create_file(ix_name);
+        int fd = disk_manager_->open_file(ix_name);
+
+        IxHashFileHdr fhdr;
+        fhdr.num_pages_ = IX_HASH_INIT_NUM_PAGES;
+        fhdr.global_depth_ = 0;
+        fhdr.col_num_ = index_cols.size();
+        for(auto& col: index_cols) {
+            fhdr.col_types_.push_back(col.type);
+            fhdr.col_lens_.push_back(col.len);
+            fhdr.col_tot_len_ += col.len;
+        }
+        if (fhdr.col_tot_len_ > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(fhdr.col_tot_len_);
+        }
+        fhdr.bucket_capacity_ = static_cast<int>((PAGE_SIZE - sizeof(IxHashBucketHdr) - (alignof(Rid) - 1)) /
+                                                 (fhdr.col_tot_len_ + sizeof(Rid)));
+        assert(fhdr.bucket_capacity_ > 2);
+        fhdr.dir_pages_.push_back(IX_HASH_DIR_PAGE);
+        fhdr.update_tot_len();
+
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        fhdr.serialize(page_buf);
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<page_id_t *>(page_buf) = IX_HASH_INIT_BUCKET_PAGE;
+        disk_manager_->write_page(fd, IX_HASH_DIR_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<IxHashBucketHdr *>(page_buf) = {
+            .local_depth = 0,
+            .num_entries = 0,
+            .next_overflow = IX_NO_PAGE,
+            .reserved = 0,
+        };
+        disk_manager_->write_page(fd, IX_HASH_INIT_BUCKET_PAGE, page_buf, PAGE_SIZE);
+
+        disk_manager_->close_file(fd);
+    }
+
     void destroy_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         disk_manager_->destroy_file(ix_name);
@@ -156,6 +212,29 @@ class IxManager {
         return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
     }
 
+    std::unique_ptr<IxHashHandle> open_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        int fd = disk_manager_->open_file(ix_name);
+        return std::make_unique<IxHashHandle>(disk_manager_, buffer_pool_manager_, fd);
+    }
+
+    void close_index(const IxHandle *ih) {
+        if (auto hash = dynamic_cast<const IxHashHandle *>(ih)) {
+            close_index(hash);
+        } else {
+            close_index(static_cast<const IxIndexHandle *>(ih));
+        }
+    }
+
+    void close_index(const IxHashHandle *ih) {
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        ih->file_hdr_->serialize(page_buf);
+        disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        buffer_pool_manager_->flush_all_pages(ih->fd_);
+        disk_manager_->close_file(ih->fd_);
+    }
+
     void close_index(const IxIndexHandle *ih) {
         char* data = new char[ih->file_hdr_->tot_len_];
         ih->file_hdr_->serialize(data);
@@ -165,7 +244,7 @@ class IxManager {
         disk_manager_->close_file(ih->fd_);
     }
 
-    void del_index_from_buf(const IxIndexHandle *ih) {
-        buffer_pool_manager_->del_all_pages(ih->fd_);
+    void del_index_from_buf(IxHandle *ih) {
+        buffer_pool_manager_->del_all_pages(ih->GetFd());
     }
 };
\ No newline at end of file
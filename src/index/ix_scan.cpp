@@ -11,32 +11,36 @@ See the Mulan PSL v2 for more details. */
 #include "ix_scan.h"
 
 /**
- * @brief 
- * @todo 加上读锁（需要使用缓冲池得到page）
+ * @brief 移动到下一个iid, 当前叶子结点读完后转到下一个叶子结点
  */
 void IxScan::next() {
     assert(!is_end());
     assert(node->is_leaf_page());
-    assert(iid_.slot_no < node->get_size());
+
+    int size;
+    page_id_t next_leaf;
+    node->page->optimistic_read([&]() {
+        size = node->get_size();
+        next_leaf = node->get_next_leaf();
+    });
+    assert(iid_.slot_no < size);
 
     // increment slot no
     iid_.slot_no++;
-    if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == node->get_size()) {
+    if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == size) {
         
-        node->page->RUnlatch();
         bpm_->unpin_page(node->get_page_id(), false);
+        delete node;
         
         // go to next leaf
         iid_.slot_no = 0;
-        iid_.page_no = node->get_next_leaf();
+        iid_.page_no = next_leaf;
 
         node = ih_->fetch_node(iid_.page_no);
-        node->page->Rlatch();
 
     }
     if(is_end()){
         // 到达最后一个iid
-        node->page->RUnlatch();
         bpm_->unpin_page(node->get_page_id(), false);
     }
     
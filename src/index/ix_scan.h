@@ -17,7 +17,7 @@ See the Mulan PSL v2 for more details. */
 
 // 用于遍历叶子结点
 // 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
-// TODO：对page遍历时，要加上读锁
+// 当前叶子结点只pin住不加锁, 每次读取时按版本号乐观读; 两次next()之间上层可能在等待事务锁, 不能一直持有页面读锁
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
     Iid iid_;  // 初始为lower（用于遍历的指针）
@@ -32,7 +32,6 @@ class IxScan : public RecScan {
             if(!is_end()){
                 //如果至少有个iid
                 node = ih_->fetch_node(iid_.page_no);
-                node->page->Rlatch();
             }
             
         }
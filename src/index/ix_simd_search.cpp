@@ -0,0 +1,111 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_simd_search.h"
+
+#include <cstring>
+
+#include "common/config.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define IX_SIMD_X86 1
+#endif
+
+namespace {
+
+// 统计keys[0, n)中<target(upper为false)或<=target(upper为true)的key的个数
+using CountFn = int (*)(const int *keys, int n, int target, bool upper);
+
+int count_less_scalar(const int *keys, int n, int target, bool upper) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        int key;
+        memcpy(&key, keys + i, sizeof(int));
+        count += upper ? key <= target : key < target;
+    }
+    return count;
+}
+
+#ifdef IX_SIMD_X86
+// key <= target 等价于 key < target + 1, target为INT_MAX时所有key都满足
+int count_less_sse2(const int *keys, int n, int target, bool upper) {
+    if (upper && target == INT32_MAX) {
+        return n;
+    }
+    __m128i bound = _mm_set1_epi32(upper ? target + 1 : target);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(bound, v))));
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+
+__attribute__((target("avx2"))) int count_less_avx2(const int *keys, int n, int target, bool upper) {
+    if (upper && target == INT32_MAX) {
+        return n;
+    }
+    __m256i bound = _mm256_set1_epi32(upper ? target + 1 : target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(bound, v))));
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+#endif
+
+struct SearchImpl {
+    CountFn count;
+    const char *name;
+};
+
+SearchImpl choose_impl() {
+#ifdef IX_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return {count_less_avx2, "avx2"};
+    }
+    return {count_less_sse2, "sse2"};
+#else
+    return {count_less_scalar, "scalar"};
+#endif
+}
+
+const SearchImpl &search_impl() {
+    static const SearchImpl impl = choose_impl();
+    return impl;
+}
+
+int search(const int *keys, int n, int target, bool upper) {
+    int left = 0;
+    int right = n;
+    while (right - left > IX_SIMD_SCAN_KEYS) {
+        int mid = left + (right - left) / 2;
+        int key;
+        memcpy(&key, keys + mid, sizeof(int));
+        if (upper ? key <= target : key < target) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    return left + search_impl().count(keys + left, right - left, target, upper);
+}
+
+}  // namespace
+
+int ix_int_lower_bound(const int *keys, int n, int target) { return search(keys, n, target, false); }
+
+int ix_int_upper_bound(const int *keys, int n, int target) { return search(keys, n, target, true); }
+
+const char *ix_int_search_impl() { return search_impl().name; }
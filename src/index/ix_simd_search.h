@@ -0,0 +1,41 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+/**
+ * @description: 单个INT字段索引的结点内查找
+ *              先二分查找把范围缩小到IX_SIMD_SCAN_KEYS个key以内, 再用SIMD统计范围内比target小的key的个数,
+ *              有序数组中这个个数就是查找结果, 扫描时没有依赖比较结果的分支
+ *              运行时检测CPU, 支持AVX2时每次比较8个key, 否则用x86-64都支持的SSE2每次比较4个, 其他平台逐个比较
+ */
+
+/**
+ * @description: 在有序数组keys[0, n)中查找第一个>=target的位置
+ * @return {int} 位置, 范围为[0, n]
+ * @param {int*} keys 有序的key数组, 不要求对齐
+ * @param {int} n key的个数
+ * @param {int} target 要查找的key
+ */
+int ix_int_lower_bound(const int *keys, int n, int target);
+
+/**
+ * @description: 在有序数组keys[0, n)中查找第一个>target的位置
+ * @return {int} 位置, 范围为[0, n]
+ * @param {int*} keys 有序的key数组, 不要求对齐
+ * @param {int} n key的个数
+ * @param {int} target 要查找的key
+ */
+int ix_int_upper_bound(const int *keys, int n, int target);
+
+/**
+ * @description: 当前使用的扫描实现, "avx2"、"sse2"或"scalar"
+ */
+const char *ix_int_search_impl();
@@ -45,6 +45,12 @@ class Optimizer {
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowIndex>(query->parse)) {
             // show index;
             return std::make_shared<OtherPlan>(T_ShowIndex, x->tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowSpace>(query->parse)) {
+            // show space;
+            return std::make_shared<OtherPlan>(T_ShowSpace, std::string());
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowIndexStats>(query->parse)) {
+            // show index stats;
+            return std::make_shared<OtherPlan>(T_ShowIndexStats, std::string());
         } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(query->parse)) {
             // desc table;
             return std::make_shared<OtherPlan>(T_DescTable, x->tab_name);
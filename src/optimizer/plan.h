@@ -29,6 +29,8 @@ typedef enum PlanTag{
     T_CreateIndex,
     T_DropIndex,
     T_ShowIndex,
+    T_ShowSpace,
+    T_ShowIndexStats,
     T_Insert,
     T_Set,
     T_Update,
@@ -77,6 +79,8 @@ class ScanPlan : public Plan
         size_t len_;                               
         std::vector<Condition> fed_conds_;
         std::vector<std::string> index_col_names_;
+        bool index_only_ = false;                   // 索引覆盖了查询用到的全部字段, 不需要回表
+        bool bitmap_heap_scan_ = false;             // 索引范围扫描可以先取出rid, 按页面排序后回表
     
 };
 
@@ -169,6 +173,8 @@ class DDLPlan : public Plan
         std::string tab_name_;
         std::vector<std::string> tab_col_names_;
         std::vector<ColDef> cols_;
+        std::vector<std::string> include_col_names_;    // create index的INCLUDE字段
+        bool using_hash_ = false;                       // create index ... using hash, 创建可扩展哈希索引
 };
 
 // help; show tables; desc tables; begin; abort; commit; rollback; set语句对应的plan
@@ -35,10 +35,25 @@ bool Planner::get_index_cols(std::string tab_name, std::vector<Condition> &curr_
     // 索引的匹配规则在这里重写
     TabMeta& tab = sm_manager_->db_.get_table(tab_name);
     std::vector<int> match_res(tab.indexes.size(), 0);
-    for(size_t i=0; i<tab.indexes.size(); i++){
+    auto is_eq_cond = [&](const std::string &col_name) {
+        return std::any_of(curr_conds.begin(), curr_conds.end(), [&](const Condition &con) {
+            return con.lhs_col.col_name == col_name && con.is_rhs_val && con.op == OP_EQ && con.lhs_col.tab_name.compare(tab_name) == 0;
+        });
+    };
+    // 哈希索引只能用于所有key字段上都是等值条件的查询, 此时只需读一个桶页面, 优先于B+树
+    auto hash_index = std::find_if(tab.indexes.begin(), tab.indexes.end(), [&](const IndexMeta &index) {
+        return index.is_hash && std::all_of(index.cols.begin(), index.cols.end(),
+                                            [&](const ColMeta &col) { return is_eq_cond(col.name); });
+    });
+    if(hash_index != tab.indexes.end()){
+        match_res[std::distance(tab.indexes.begin(), hash_index)] = hash_index->key_num();
+    }
+    for(size_t i=0; i<tab.indexes.size() && hash_index == tab.indexes.end(); i++){
         auto &index = tab.indexes[i];
+        if(index.is_hash) continue;
         bool end = false;
-        for(int j=0; j<index.col_num; j++){
+        // INCLUDE字段在B+树中按字节比较, 不能用来确定扫描范围
+        for(int j=0; j<index.key_num(); j++){
             bool found = false;
             for(auto &con: curr_conds){
                 if(index.cols[j].name == con.lhs_col.col_name && con.is_rhs_val && con.op == OP_EQ && con.lhs_col.tab_name.compare(tab_name) == 0){
@@ -78,6 +93,54 @@ bool Planner::get_index_cols(std::string tab_name, std::vector<Condition> &curr_
     return true;
 }
 
+/**
+ * @brief 单表查询用到的字段(选取的列、扫描条件和order by的列)都在索引中时, 索引扫描直接从key中读取记录, 不再回表
+ *
+ * @param query 查询
+ * @param scan 单表查询的扫描算子
+ */
+void Planner::set_index_only(std::shared_ptr<Query> query, std::shared_ptr<ScanPlan> scan) {
+    if(scan == nullptr || scan->tag != T_IndexScan) return;
+    TabMeta& tab = sm_manager_->db_.get_table(scan->tab_name_);
+    auto& index = *tab.get_index_meta(scan->index_col_names_);
+    // 哈希索引的桶中只有key和rid, 查找只命中一条记录, 直接回表
+    if(index.is_hash) return;
+    for(auto& sel_col: query->cols){
+        if(!index.has_col(sel_col.col_name)) return;
+    }
+    for(auto& cond: scan->conds_){
+        if(!cond.is_rhs_val || !index.has_col(cond.lhs_col.col_name)) return;
+    }
+    auto x = std::dynamic_pointer_cast<ast::SelectStmt>(query->parse);
+    if(x != nullptr && x->has_sort){
+        for(auto& order_col: x->order->cols){
+            if(!index.has_col(order_col->col_name)) return;
+        }
+    }
+    scan->index_only_ = true;
+    scan->bitmap_heap_scan_ = false;
+}
+
+/**
+ * @brief 索引扫描没有用等值条件确定全部key字段时, 范围内的记录可能很多, 允许按页面排序后回表
+ * 没有统计信息可以估计范围的大小, 执行时从叶子结点取出rid后得到, 不足BITMAP_HEAP_SCAN_MIN_RIDS个时仍按key的顺序回表
+ *
+ * @param scan 索引扫描算子
+ */
+void Planner::set_bitmap_heap_scan(std::shared_ptr<ScanPlan> scan) {
+    TabMeta& tab = sm_manager_->db_.get_table(scan->tab_name_);
+    auto& index = *tab.get_index_meta(scan->index_col_names_);
+    for(int i = 0; i < index.key_num(); i++){
+        bool equal = std::any_of(scan->conds_.begin(), scan->conds_.end(), [&](const Condition &cond) {
+            return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.col_name == index.cols[i].name;
+        });
+        if(!equal){
+            scan->bitmap_heap_scan_ = true;
+            return;
+        }
+    }
+}
+
 /**
  * @brief 表算子条件谓词生成
  *
@@ -249,12 +312,15 @@ std::shared_ptr<Plan> Planner::make_one_rel(std::shared_ptr<Query> query)
             index_col_names.clear();
             table_scan_executors[i] = std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, tables[i], curr_conds, index_col_names);
         } else {  // 存在索引
-            table_scan_executors[i] = std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, tables[i], curr_conds, index_col_names);
+            auto scan = std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, tables[i], curr_conds, index_col_names);
+            set_bitmap_heap_scan(scan);
+            table_scan_executors[i] = scan;
         }
     }
     // 只有一个表，不需要join。
     if(tables.size() == 1)
     {
+        set_index_only(query, std::dynamic_pointer_cast<ScanPlan>(table_scan_executors[0]));
         return table_scan_executors[0];
     }
     // 获取where条件
@@ -471,7 +537,10 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         plannerRoot = std::make_shared<DDLPlan>(T_DropTable, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
     } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(query->parse)) {
         // create index;
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        auto ddl = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        ddl->include_col_names_ = x->include_col_names;
+        ddl->using_hash_ = x->using_hash;
+        plannerRoot = ddl;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(query->parse)) {
         // drop index
         plannerRoot = std::make_shared<DDLPlan>(T_DropIndex, x->tab_name, x->col_names, std::vector<ColDef>());
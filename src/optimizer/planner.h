@@ -50,6 +50,10 @@ class Planner {
     // int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
     bool get_index_cols(std::string tab_name, std::vector<Condition> &curr_conds, std::vector<std::string>& index_col_names);
 
+    void set_index_only(std::shared_ptr<Query> query, std::shared_ptr<ScanPlan> scan);
+
+    void set_bitmap_heap_scan(std::shared_ptr<ScanPlan> scan);
+
     ColType interp_sv_type(ast::SvType sv_type) {
         std::map<ast::SvType, ColType> m = {
             {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_BIGINT, TYPE_BIGINT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}, {ast::SV_TYPE_DATETIME, TYPE_DATETIME}};
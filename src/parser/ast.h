@@ -47,6 +47,12 @@ struct Help : public TreeNode {
 struct ShowTables : public TreeNode {
 };
 
+struct ShowSpace : public TreeNode {
+};
+
+struct ShowIndexStats : public TreeNode {
+};
+
 struct TxnBegin : public TreeNode {
 };
 
@@ -100,9 +106,13 @@ struct DescTable : public TreeNode {
 struct CreateIndex : public TreeNode {
     std::string tab_name;
     std::vector<std::string> col_names;
+    std::vector<std::string> include_col_names;
+    bool using_hash;
 
-    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_) :
-            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)) {}
+    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_,
+                std::vector<std::string> include_col_names_ = std::vector<std::string>(), bool using_hash_ = false) :
+            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)),
+            include_col_names(std::move(include_col_names_)), using_hash(using_hash_) {}
 };
 
 struct DropIndex : public TreeNode {
@@ -81,6 +81,10 @@ private:
             std::cout << "HELP\n";
         } else if (auto x = std::dynamic_pointer_cast<ShowTables>(node)) {
             std::cout << "SHOW_TABLES\n";
+        } else if (auto x = std::dynamic_pointer_cast<ShowSpace>(node)) {
+            std::cout << "SHOW_SPACE\n";
+        } else if (auto x = std::dynamic_pointer_cast<ShowIndexStats>(node)) {
+            std::cout << "SHOW_INDEX_STATS\n";
         } else if (auto x = std::dynamic_pointer_cast<CreateTable>(node)) {
             std::cout << "CREATE_TABLE\n";
             print_val(x->tab_name, offset);
@@ -97,6 +101,10 @@ private:
             // print_val(x->col_name, offset);
             for(auto col_name: x->col_names)
                 print_val(col_name, offset);
+            for(auto col_name: x->include_col_names)
+                print_val(col_name, offset);
+            if(x->using_hash)
+                print_val(std::string("HASH"), offset);
         } else if (auto x = std::dynamic_pointer_cast<DropIndex>(node)) {
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
@@ -23,7 +23,7 @@ using namespace ast;
 // keywords
 %token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM ASC
 WHERE UPDATE SET SELECT INT BIGINT CHAR DATETIME FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY
-SUM COUNT MAX MIN AS LIMIT ON OFF LOAD
+SUM COUNT MAX MIN AS LIMIT ON OFF LOAD SPACE STATS INCLUDE USING HASH
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -118,6 +118,14 @@ dbStmt:
     {
         $$ = std::make_shared<ShowIndex>($4);
     }
+    |   SHOW SPACE
+    {
+        $$ = std::make_shared<ShowSpace>();
+    }
+    |   SHOW INDEX STATS
+    {
+        $$ = std::make_shared<ShowIndexStats>();
+    }
     ;
 
 ddl:
@@ -137,6 +145,14 @@ ddl:
     {
         $$ = std::make_shared<CreateIndex>($3, $5);
     }
+    |   CREATE INDEX tbName '(' colNameList ')' INCLUDE '(' colNameList ')'
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, $9);
+    }
+    |   CREATE INDEX tbName '(' colNameList ')' USING HASH
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, std::vector<std::string>(), true);
+    }
     |   DROP INDEX tbName '(' colNameList ')'
     {
         $$ = std::make_shared<DropIndex>($3, $5);
@@ -258,6 +274,10 @@ setValue:
     {
         $$ = "0";
     }
+    |   '=' VALUE_INT
+    {
+        $$ = std::to_string($2);
+    }
     ;
 
 colNameList:
@@ -22,13 +22,61 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* cont
     // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
 
     RmPageHandle page_handle =  fetch_page_handle(rid.page_no);
-    page_handle.page->Rlatch();
-    std::unique_ptr<RmRecord> record_ptr = std::make_unique<RmRecord>(page_handle.file_hdr->record_size, page_handle.get_slot(rid.slot_no));
+    std::unique_ptr<RmRecord> record_ptr = std::make_unique<RmRecord>(page_handle.file_hdr->record_size);
+    // 只读不加锁, 写者修改页面时会改变版本号, 读到不一致的数据时重新拷贝
+    page_handle.page->optimistic_read([&]() {
+        memcpy(record_ptr->data, page_handle.get_slot(rid.slot_no), page_handle.file_hdr->record_size);
+    });
     buffer_pool_manager_->unpin_page({fd_, rid.page_no}, false);
-    page_handle.page->RUnlatch();
     return record_ptr;
 }
 
+/**
+ * @description: 读取同一个页面上的多条记录, 页面只fetch一次, 用于索引范围扫描按页面回表
+ * @param {Rid*} rids 要读取的记录, 都位于rids[0].page_no页面上
+ * @param {int} num_rids 记录的数量
+ * @param {vector<unique_ptr<RmRecord>>*} records 按rids的顺序追加读出的记录
+ */
+void RmFileHandle::get_page_records(const Rid *rids, int num_rids, std::vector<std::unique_ptr<RmRecord>> *records) const {
+    int page_no = rids[0].page_no;
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    size_t first = records->size();
+    for (int i = 0; i < num_rids; i++) {
+        assert(rids[i].page_no == page_no);
+        records->push_back(std::make_unique<RmRecord>(file_hdr_.record_size));
+    }
+    // 与get_record()相同, 版本号变化时整页的记录重新拷贝
+    page_handle.page->optimistic_read([&]() {
+        for (int i = 0; i < num_rids; i++) {
+            memcpy((*records)[first + i]->data, page_handle.get_slot(rids[i].slot_no), file_hdr_.record_size);
+        }
+    });
+    buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+}
+
+/**
+ * @description: 读取一个页面上的所有记录, 用于在线建立索引时不加锁地扫描表
+ * @param {int} page_no 页面号
+ * @param {vector<Rid>*} rids 传出参数, 页面上所有记录的位置
+ * @param {vector<char>*} records 传出参数, 按rids的顺序存放的记录数据, 每条记录record_size字节
+ */
+void RmFileHandle::get_page_all_records(int page_no, std::vector<Rid> *rids, std::vector<char> *records) const {
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    // 与get_record()相同, 版本号变化时整页重新读取
+    page_handle.page->optimistic_read([&]() {
+        rids->clear();
+        records->clear();
+        int max_n = file_hdr_.num_records_per_page;
+        for (int slot_no = Bitmap::first_bit(true, page_handle.bitmap, max_n); slot_no < max_n;
+             slot_no = Bitmap::next_bit(true, page_handle.bitmap, max_n, slot_no)) {
+            rids->push_back(Rid{page_no, slot_no});
+            char *slot = page_handle.get_slot(slot_no);
+            records->insert(records->end(), slot, slot + file_hdr_.record_size);
+        }
+    });
+    buffer_pool_manager_->unpin_page({fd_, page_no}, false);
+}
+
 Rid RmFileHandle::insert_load_record(char* buf, Context* context){
 
     if(file_hdr_.first_free_page_no < 0){
@@ -70,6 +118,63 @@ Rid RmFileHandle::insert_load_record(char* buf, Context* context){
     return ret;
 }
 
+/**
+ * @description: load file时把一批连续存放的记录依次写入当前页面的空闲位置, 写满后换新页面, 与逐条调用insert_load_record()的结果相同
+ * @param {char*} buf 连续存放的记录, 每条file_hdr_.record_size字节
+ * @param {int} num_records 记录数量
+ * @param {Rid*} rids 传出参数, 每条记录插入的位置
+ */
+void RmFileHandle::insert_load_records(const char *buf, int num_records, Rid *rids) {
+    int i = 0;
+    while (i < num_records) {
+        if (page_handle_.page != nullptr && page_handle_.page_hdr->num_records == file_hdr_.num_records_per_page) {
+            // 当前页面已写满, 已经从空闲链表中摘下, 释放后从链表中的下一个页面或新页面继续写
+            buffer_pool_manager_->unpin_page(page_handle_.page->get_page_id(), true);
+            page_handle_ = RmPageHandle(&file_hdr_, nullptr);
+        }
+        if (page_handle_.page == nullptr && file_hdr_.first_free_page_no >= 0) {
+            // 上一次load结束时已释放当前页面, 或者当前页面已写满, 从第一个未满的页面继续写
+            page_handle_ = fetch_page_handle(file_hdr_.first_free_page_no);
+        }
+        if (page_handle_.page == nullptr) {
+            PageId page_id_temp = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+            Page* page = buffer_pool_manager_->new_page(&page_id_temp);
+            RmPageHandle page_handle(&file_hdr_, page);
+            page_handle.page_hdr->next_free_page_no = -1;
+
+            file_hdr_.num_pages++;
+            file_hdr_.first_free_page_no = page->get_page_id().page_no;
+            page_handle_ = page_handle;
+        }
+        int page_no = page_handle_.page->get_page_id().page_no;
+        int pos = Bitmap::first_bit(0, page_handle_.bitmap, file_hdr_.num_records_per_page);
+        // 一次填满当前页面的空闲位置, 不必每条记录都从头扫描bitmap
+        while (i < num_records && pos < file_hdr_.num_records_per_page) {
+            memcpy(page_handle_.get_slot(pos), buf + (size_t)i * file_hdr_.record_size, file_hdr_.record_size);
+            Bitmap::set(page_handle_.bitmap, pos);
+            page_handle_.page_hdr->num_records++;
+            rids[i++] = Rid{page_no, pos};
+            pos = Bitmap::next_bit(0, page_handle_.bitmap, file_hdr_.num_records_per_page, pos);
+        }
+        if (page_handle_.page_hdr->num_records == file_hdr_.num_records_per_page) {
+            file_hdr_.first_free_page_no = page_handle_.page_hdr->next_free_page_no;
+            page_handle_.page_hdr->next_free_page_no = -1;
+        }
+    }
+}
+
+/**
+ * @description: load file结束时unpin当前写入的页面, 并把文件头写回磁盘
+ */
+void RmFileHandle::finish_load() {
+    if (page_handle_.page == nullptr) {
+        return;
+    }
+    buffer_pool_manager_->unpin_page(page_handle_.page->get_page_id(), true);
+    page_handle_ = RmPageHandle(&file_hdr_, nullptr);
+    disk_manager_->write_page(fd_, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+}
+
 /**
  * @description: 在当前表中插入一条记录，不指定插入位置
  * @param {char*} buf 要插入的记录的数据
@@ -85,8 +190,7 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
     // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
 
     RmPageHandle page_handle = create_page_handle();
-    // test del wlach
-    // page_handle.page->Wlatch();
+    page_handle.page->Wlatch();
     int pos = Bitmap::first_bit(0, page_handle.bitmap, file_hdr_.num_records_per_page);
     assert(pos != file_hdr_.num_records_per_page);
     memcpy(page_handle.get_slot(pos), buf, file_hdr_.record_size);
@@ -99,9 +203,8 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
         disk_manager_->write_page(fd_, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
     }
     Rid ret{page_handle.page->get_page_id().page_no, pos};
+    page_handle.page->WUnlatch();
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
-    // test del wlach
-    // page_handle.page->WUnlatch();
     return ret;
 }
 
@@ -114,8 +217,7 @@ void RmFileHandle::insert_record(const Rid& rid, char* buf) {
     int page_no = rid.page_no;
     RmPageHandle page_handle = fetch_page_handle(page_no);
     int slot_no = rid.slot_no;
-    // test del wlach
-    // page_handle.page->Wlatch();
+    page_handle.page->Wlatch();
     memcpy(page_handle.get_slot(slot_no), buf, file_hdr_.record_size);
     Bitmap::set(page_handle.bitmap, slot_no);
     if(++page_handle.page_hdr->num_records == file_hdr_.num_records_per_page){
@@ -125,9 +227,8 @@ void RmFileHandle::insert_record(const Rid& rid, char* buf) {
         // 立即更新头文件
         disk_manager_->write_page(fd_, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
     }
+    page_handle.page->WUnlatch();
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
-    // test del wlach
-    // page_handle.page->WUnlatch();
 }
 
 /**
@@ -143,16 +244,14 @@ void RmFileHandle::delete_record(const Rid& rid, Context* context) {
     int page_no = rid.page_no;
     RmPageHandle page_handle = fetch_page_handle(page_no);
     int slot_no = rid.slot_no;
-    // test del wlach
-    // page_handle.page->Wlatch();
+    page_handle.page->Wlatch();
     memset(page_handle.get_slot(slot_no), 0, file_hdr_.record_size);
     Bitmap::reset(page_handle.bitmap, slot_no);
     if(page_handle.page_hdr->num_records-- == file_hdr_.num_records_per_page){
         release_page_handle(page_handle);
     }
+    page_handle.page->WUnlatch();
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
-    // test del wlach
-    // page_handle.page->WUnlatch();
 }
 
 
@@ -169,12 +268,10 @@ void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context) {
     int page_no = rid.page_no;
     RmPageHandle page_handle = fetch_page_handle(page_no);
     int slot_no = rid.slot_no;
-    // test del wlach
-    // page_handle.page->Wlatch();
+    page_handle.page->Wlatch();
     memcpy(page_handle.get_slot(slot_no), buf, file_hdr_.record_size);
+    page_handle.page->WUnlatch();
     buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
-    // test del wlach
-    // page_handle.page->WUnlatch();
 }
 
 /**
@@ -199,6 +296,30 @@ RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
     return RmPageHandle(&file_hdr_, page);
 }
 
+/**
+ * @description: 沿空闲页面链表统计表文件中可以回收复用的空间
+ *               删除记录后未满的页面(包括被删空的页面)都挂在这个链表上, 插入时优先从链表中取页面
+ * @param {int*} num_empty_pages 传出参数, 链表中已经没有任何记录的页面个数
+ * @return {int} 链表中所有页面的空闲slot总数
+ */
+int RmFileHandle::get_num_free_slots(int *num_empty_pages) const {
+    int num_free_slots = 0;
+    int num_visited = 0;
+    *num_empty_pages = 0;
+    int page_no = file_hdr_.first_free_page_no;
+    while (page_no != RM_NO_PAGE && num_visited < file_hdr_.num_pages) {
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        num_free_slots += file_hdr_.num_records_per_page - page_handle.page_hdr->num_records;
+        if (page_handle.page_hdr->num_records == 0) {
+            (*num_empty_pages)++;
+        }
+        page_no = page_handle.page_hdr->next_free_page_no;
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        num_visited++;
+    }
+    return num_free_slots;
+}
+
 /**
  * @description: 创建一个新的page handle
  * @return {RmPageHandle} 新的PageHandle
@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include <assert.h>
 
 #include <memory>
+#include <vector>
 
 #include "bitmap.h"
 #include "common/context.h"
@@ -31,6 +32,12 @@ struct RmPageHandle {
     RmPageHandle(){}
     
     RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : file_hdr(fhdr_), page(page_) {
+        // 空句柄(load尚未写入页面时)没有页面数据可指向
+        if (page == nullptr) {
+            page_hdr = nullptr;
+            bitmap = slots = nullptr;
+            return;
+        }
         page_hdr = reinterpret_cast<RmPageHdr *>(page->get_data() + page->OFFSET_PAGE_HDR);
         bitmap = page->get_data() + sizeof(RmPageHdr) + page->OFFSET_PAGE_HDR;
         slots = bitmap + file_hdr->bitmap_size;
@@ -81,9 +88,17 @@ class RmFileHandle {
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
+    void get_page_records(const Rid *rids, int num_rids, std::vector<std::unique_ptr<RmRecord>> *records) const;
+
+    void get_page_all_records(int page_no, std::vector<Rid> *rids, std::vector<char> *records) const;
+
     Rid insert_record(char *buf, Context *context);
 
     Rid insert_load_record(char* buf, Context* context);
+
+    void insert_load_records(const char *buf, int num_records, Rid *rids);
+
+    void finish_load();
     
     void insert_record(const Rid &rid, char *buf);
 
@@ -95,6 +110,8 @@ class RmFileHandle {
 
     RmPageHandle fetch_page_handle(int page_no) const;
 
+    int get_num_free_slots(int *num_empty_pages) const;
+
    private:
     RmPageHandle create_page_handle();
 
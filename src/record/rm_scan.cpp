@@ -14,7 +14,7 @@ See the Mulan PSL v2 for more details. */
  * @brief 初始化file_handle和rid
  * @param file_handle
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
+RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle), read_ahead_until_(1) {
     // Todo:
     // 初始化file_handle和rid（指向第一个存放了记录的位置）
     if(file_handle_->file_hdr_.num_pages <= 1) {
@@ -28,6 +28,7 @@ RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
     RmPageHandle page_handle;
     do
     {
+        read_ahead(page_no);
         page_handle = file_handle_->fetch_page_handle(page_no);
         slot_no = Bitmap::first_bit(1, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page);
         if(slot_no != file_handle_->file_hdr_.num_records_per_page){
@@ -80,6 +81,7 @@ void RmScan::next() {
     RmPageHandle page_handle;
     page_no++;
     while (page_no < file_handle_->file_hdr_.num_pages){
+        read_ahead(page_no);
         page_handle = file_handle_->fetch_page_handle(page_no);
         slot_no = Bitmap::first_bit(1, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page);
         if(slot_no != file_handle_->file_hdr_.num_records_per_page){
@@ -102,6 +104,23 @@ void RmScan::next() {
     return;
 }
 
+/**
+ * @brief 扫描即将读取page_no时, 若已提交预读的页面不足READ_AHEAD_PAGES / 2个, 则异步预读接下来的READ_AHEAD_PAGES个页面
+ * @param page_no 即将读取的页面
+ */
+void RmScan::read_ahead(int page_no) {
+    int num_pages = file_handle_->file_hdr_.num_pages;
+    if (read_ahead_until_ >= num_pages || page_no + READ_AHEAD_PAGES / 2 < read_ahead_until_) {
+        return;
+    }
+    int start = std::max(read_ahead_until_, page_no + 1);
+    int count = std::min(READ_AHEAD_PAGES, num_pages - start);
+    if (count > 0) {
+        file_handle_->buffer_pool_manager_->prefetch_pages(file_handle_->fd_, start, count);
+    }
+    read_ahead_until_ = start + count;
+}
+
 /**
  * @brief ​ 判断是否到达文件末尾
  */
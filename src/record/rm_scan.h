@@ -19,6 +19,9 @@ class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
     Rid rid_;
     RmPageHandle cur_page_hanle_;
+    int read_ahead_until_;      // [1, read_ahead_until_)范围内的页面已经提交过预读请求
+
+    void read_ahead(int page_no);
 
 public:
     RmScan(const RmFileHandle *file_handle);
@@ -10,6 +10,7 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include <iostream>
@@ -430,13 +431,14 @@ public:
     LogBuffer* get_log_buffer() { return log_buffer_; }
     LogBuffer* get_flush_buffer() { return flush_buffer_; }
     void set_persist_lsn(lsn_t persist_lsn) { persist_lsn_ = persist_lsn; }
+    lsn_t get_persist_lsn() { return persist_lsn_; }
     void set_global_lsn(lsn_t global_lsn) { global_lsn_ = global_lsn; }
 private:    
     std::atomic<lsn_t> global_lsn_{0};  // 全局lsn，递增，用于为每条记录分发lsn
     std::mutex latch_;                  // 用于对log_buffer_的互斥访问
     LogBuffer *log_buffer_;              // 日志写入缓冲区
     LogBuffer *flush_buffer_;              // 日志写入缓冲区
-    lsn_t persist_lsn_;                 // 记录已经持久化到磁盘中的最后一条日志的日志号
+    std::atomic<lsn_t> persist_lsn_;    // 记录已经持久化到磁盘中的最后一条日志的日志号, 刷盘线程写, 缓冲池的后台写线程读
     DiskManager* disk_manager_;
 
     std::thread *flush_thread_; // 日志刷新线程
@@ -0,0 +1,112 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "clock_replacer.h"
+
+#include <algorithm>
+
+ClockReplacer::ClockReplacer(size_t num_pages, size_t max_pages)
+    : capacity_(std::max(num_pages, max_pages)), num_frames_(num_pages), hand_(0), size_(0) {
+    evictable_ = new std::atomic<bool>[capacity_];
+    ref_ = new std::atomic<bool>[capacity_];
+    for (size_t i = 0; i < capacity_; ++i) {
+        evictable_[i].store(false, std::memory_order_relaxed);
+        ref_[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+ClockReplacer::~ClockReplacer() {
+    delete[] evictable_;
+    delete[] ref_;
+}
+
+/**
+ * @description: 使用CLOCK策略选择一个victim frame，并返回该frame的id
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ClockReplacer::victim(frame_id_t* frame_id) {
+    // 每个帧最多被清一次访问位再被检查一次, 扫描两圈仍未找到说明其余线程在并发pin, 再多给一圈余量
+    size_t num_frames = num_frames_.load(std::memory_order_acquire);
+    size_t max_steps = 3 * num_frames;
+    for (size_t step = 0; step < max_steps && size_.load(std::memory_order_acquire) > 0; ++step) {
+        size_t idx = hand_.fetch_add(1, std::memory_order_relaxed) % num_frames;
+        if (!evictable_[idx].load(std::memory_order_acquire)) {
+            continue;
+        }
+        if (ref_[idx].exchange(false, std::memory_order_acq_rel)) {
+            // 最近被访问过, 给第二次机会
+            continue;
+        }
+        bool expected = true;
+        if (evictable_[idx].compare_exchange_strong(expected, false, std::memory_order_acq_rel)) {
+            size_.fetch_sub(1, std::memory_order_acq_rel);
+            *frame_id = static_cast<frame_id_t>(idx);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ClockReplacer::pin(frame_id_t frame_id) {
+    bool expected = true;
+    if (evictable_[frame_id].compare_exchange_strong(expected, false, std::memory_order_acq_rel)) {
+        size_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    ref_[frame_id].store(true, std::memory_order_release);
+    bool expected = false;
+    if (evictable_[frame_id].compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        size_.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+/**
+ * @description: 从时钟指针处开始扫描一圈, 收集即将被淘汰的frame, 不修改访问位
+ *              访问位为0的帧先于访问位为1的帧被淘汰, 因此先收集前者
+ * @param {size_t} max_frames 最多收集的frame数量
+ * @param {vector<frame_id_t>*} frame_ids 按淘汰顺序存放收集到的frame id
+ */
+void ClockReplacer::peek_victims(size_t max_frames, std::vector<frame_id_t>* frame_ids) {
+    size_t start = hand_.load(std::memory_order_relaxed);
+    size_t num_frames = num_frames_.load(std::memory_order_acquire);
+    for (bool referenced : {false, true}) {
+        for (size_t step = 0; step < num_frames && frame_ids->size() < max_frames; ++step) {
+            size_t idx = (start + step) % num_frames;
+            if (evictable_[idx].load(std::memory_order_acquire) &&
+                ref_[idx].load(std::memory_order_acquire) == referenced) {
+                frame_ids->push_back(static_cast<frame_id_t>(idx));
+            }
+        }
+    }
+}
+
+/**
+ * @description: 缓冲池帧数改变时调整时钟指针扫过的范围, 不超过构造时的max_pages
+ * @param {size_t} num_frames 新的帧数
+ */
+void ClockReplacer::resize(size_t num_frames) {
+    num_frames_.store(std::min(num_frames, capacity_), std::memory_order_release);
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ClockReplacer::Size() { return size_.load(std::memory_order_acquire); }
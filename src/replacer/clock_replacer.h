@@ -0,0 +1,53 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <atomic>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+ClockReplacer实现了CLOCK-sweep替换策略
+每个帧只维护两个原子标志: evictable_表示该帧当前可被淘汰, ref_为访问位
+pin/unpin只做原子操作, 不需要加锁; victim沿固定数组移动时钟指针, 访问位为1的帧给一次"第二次机会"
+*/
+class ClockReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的ClockReplacer
+     * @param {size_t} num_pages ClockReplacer当前管理的帧数量
+     * @param {size_t} max_pages 缓冲池扩容后最多可能管理的帧数量, 不大于num_pages时等于num_pages
+     */
+    explicit ClockReplacer(size_t num_pages, size_t max_pages = 0);
+
+    ~ClockReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    void peek_victims(size_t max_frames, std::vector<frame_id_t> *frame_ids);
+
+    void resize(size_t num_frames);
+
+    size_t Size();
+
+   private:
+    size_t capacity_;                   // 标志数组的长度
+    std::atomic<size_t> num_frames_;    // 时钟指针扫过的帧的数量（与缓冲池的容量相同）
+    std::atomic<bool> *evictable_;      // evictable_[i]为true表示帧i未被固定, 可以被淘汰
+    std::atomic<bool> *ref_;            // 访问位, unpin时置1, 时钟指针经过时清0
+    std::atomic<size_t> hand_;          // 时钟指针
+    std::atomic<size_t> size_;          // 当前可以被淘汰的帧数量
+};
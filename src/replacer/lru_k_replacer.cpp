@@ -0,0 +1,154 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "lru_k_replacer.h"
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, size_t correlated_period)
+    : k_(k), correlated_period_(correlated_period), frames_(num_pages) {
+    for (auto &frame : frames_) {
+        frame.history_.resize(k_, 0);
+    }
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+/**
+ * @description: 帧在队列中的排序键, 不足K次时为最近一次访问时间, 否则为倒数第K次访问时间
+ */
+size_t LRUKReplacer::kth_access(const FrameHistory &h) const {
+    return h.count_ >= k_ ? h.history_[h.count_ % k_] : h.last_access_;
+}
+
+/**
+ * @description: 记录一次访问, 调用者需持有latch_且该帧不在任何队列中
+ */
+void LRUKReplacer::record_access(frame_id_t frame_id) {
+    FrameHistory &h = frames_[frame_id];
+    size_t ts = ++current_ts_;
+    if (h.count_ > 0 && ts - h.last_access_ <= correlated_period_) {
+        // 相关访问, 只刷新最近访问时间
+        h.last_access_ = ts;
+        return;
+    }
+    h.history_[h.count_ % k_] = ts;
+    h.count_++;
+    h.last_access_ = ts;
+}
+
+/**
+ * @description: 将可淘汰的帧从其所在队列中移除, 调用者需持有latch_
+ */
+void LRUKReplacer::erase_from_queue(frame_id_t frame_id) {
+    FrameHistory &h = frames_[frame_id];
+    if (!h.evictable_) {
+        return;
+    }
+    auto &queue = h.count_ >= k_ ? cache_queue_ : history_queue_;
+    queue.erase({kth_access(h), frame_id});
+    h.evictable_ = false;
+}
+
+/**
+ * @description: 使用LRU-K策略删除一个victim frame，并返回该frame的id
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool LRUKReplacer::victim(frame_id_t* frame_id) {
+    std::scoped_lock lock{latch_};
+    // 优先淘汰历史队列(访问不足K次)中最久未访问的帧, 历史队列为空时才淘汰缓存队列中K距离最大的帧
+    if (!history_queue_.empty()) {
+        *frame_id = history_queue_.begin()->second;
+    } else if (!cache_queue_.empty()) {
+        *frame_id = cache_queue_.begin()->second;
+    } else {
+        return false;
+    }
+    // 帧即将装入新的页面, 清空其访问历史
+    erase_from_queue(*frame_id);
+    frames_[*frame_id].count_ = 0;
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰, 同时记录一次访问
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void LRUKReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    erase_from_queue(frame_id);
+    record_access(frame_id);
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void LRUKReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameHistory &h = frames_[frame_id];
+    if (h.evictable_) {
+        return;
+    }
+    if (h.count_ == 0) {
+        // 没有经过pin直接加入replacer的帧, 补记一次访问
+        record_access(frame_id);
+    }
+    auto &queue = h.count_ >= k_ ? cache_queue_ : history_queue_;
+    queue.insert({kth_access(h), frame_id});
+    h.evictable_ = true;
+}
+
+/**
+ * @description: 帧被释放回free_list, 从replacer中移除并清空其访问历史
+ * @param {frame_id_t} frame_id 被释放的frame的id
+ */
+void LRUKReplacer::remove(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    erase_from_queue(frame_id);
+    frames_[frame_id].count_ = 0;
+}
+
+/**
+ * @description: 按淘汰顺序(先历史队列, 后缓存队列)收集即将被淘汰的frame, 不将其移出replacer
+ * @param {size_t} max_frames 最多收集的frame数量
+ * @param {vector<frame_id_t>*} frame_ids 按淘汰顺序存放收集到的frame id
+ */
+void LRUKReplacer::peek_victims(size_t max_frames, std::vector<frame_id_t>* frame_ids) {
+    std::scoped_lock lock{latch_};
+    for (auto *queue : {&history_queue_, &cache_queue_}) {
+        for (auto it = queue->begin(); it != queue->end() && frame_ids->size() < max_frames; ++it) {
+            frame_ids->push_back(it->second);
+        }
+    }
+}
+
+/**
+ * @description: 缓冲池扩容时为新增的帧分配访问历史; 缩容时被移除的帧已经没有历史, 无需处理
+ * @param {size_t} num_frames 新的帧数
+ */
+void LRUKReplacer::resize(size_t num_frames) {
+    std::scoped_lock lock{latch_};
+    size_t old_size = frames_.size();
+    if (num_frames <= old_size) {
+        return;
+    }
+    frames_.resize(num_frames);
+    for (size_t i = old_size; i < num_frames; ++i) {
+        frames_[i].history_.resize(k_, 0);
+    }
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t LRUKReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return history_queue_.size() + cache_queue_.size();
+}
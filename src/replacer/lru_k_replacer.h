@@ -0,0 +1,74 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+LRUKReplacer实现了LRU-K替换策略(带相关访问窗口)
+- 访问不足K次的帧位于历史队列(试用区), 按最近访问时间LRU淘汰, 且优先于缓存队列被淘汰
+- 访问满K次的帧位于缓存队列, 按倒数第K次访问时间淘汰
+- 与上一次访问间隔不超过correlated_period_的访问视为相关访问(如扫描时同一页的多次fetch), 只算一次
+这样顺序扫描只访问一次的页停留在历史队列中, 不会把B+树内部结点等热点页挤出缓冲池
+*/
+class LRUKReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的LRUKReplacer
+     * @param {size_t} num_pages LRUKReplacer最多需要存储的page数量
+     * @param {size_t} k 进入缓存队列需要的访问次数
+     * @param {size_t} correlated_period 相关访问窗口
+     */
+    explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_K, size_t correlated_period = LRUK_CORRELATED_PERIOD);
+
+    ~LRUKReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    void peek_victims(size_t max_frames, std::vector<frame_id_t> *frame_ids);
+
+    void remove(frame_id_t frame_id);
+
+    void resize(size_t num_frames);
+
+    size_t Size();
+
+   private:
+    struct FrameHistory {
+        std::vector<size_t> history_;   // 最近K次非相关访问的时间戳, 循环存放
+        size_t count_ = 0;              // 非相关访问次数
+        size_t last_access_ = 0;        // 最近一次访问(含相关访问)的时间戳
+        bool evictable_ = false;
+    };
+
+    size_t kth_access(const FrameHistory &h) const;
+
+    void record_access(frame_id_t frame_id);
+
+    void erase_from_queue(frame_id_t frame_id);
+
+    std::mutex latch_;                                  // 互斥锁
+    size_t k_;
+    size_t correlated_period_;
+    size_t current_ts_ = 0;                             // 逻辑时钟, 每次访问加一
+    std::vector<FrameHistory> frames_;
+    std::set<std::pair<size_t, frame_id_t>> history_queue_;  // 访问不足K次且可淘汰的帧, 按最近访问时间排序
+    std::set<std::pair<size_t, frame_id_t>> cache_queue_;    // 访问满K次且可淘汰的帧, 按倒数第K次访问时间排序
+};
@@ -80,6 +80,27 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
     return;
 }
 
+/**
+ * @description: 从LRU链表尾部开始收集即将被淘汰的frame, 不将其移出replacer
+ * @param {size_t} max_frames 最多收集的frame数量
+ * @param {vector<frame_id_t>*} frame_ids 按淘汰顺序存放收集到的frame id
+ */
+void LRUReplacer::peek_victims(size_t max_frames, std::vector<frame_id_t>* frame_ids) {
+    std::scoped_lock lock{latch_};
+    for (auto it = LRUlist_.rbegin(); it != LRUlist_.rend() && frame_ids->size() < max_frames; ++it) {
+        frame_ids->push_back(*it);
+    }
+}
+
+/**
+ * @description: 缓冲池帧数改变时更新最大容量
+ * @param {size_t} num_frames 新的帧数
+ */
+void LRUReplacer::resize(size_t num_frames) {
+    std::scoped_lock lock{latch_};
+    max_size_ = num_frames;
+}
+
 /**
  * @description: 获取当前replacer中可以被淘汰的页面数量
  */
@@ -41,6 +41,10 @@ class LRUReplacer : public Replacer {
 
     void unpin(frame_id_t frame_id);
 
+    void peek_victims(size_t max_frames, std::vector<frame_id_t> *frame_ids);
+
+    void resize(size_t num_frames);
+
     size_t Size();
 
    private:
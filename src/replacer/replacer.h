@@ -10,6 +10,8 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 /**
@@ -39,6 +41,28 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * The frame is being returned to the free list, forget everything known about it.
+     * Policies that keep access history should override this; by default it behaves like pin.
+     * @param frame_id the id of the frame to remove
+     */
+    virtual void remove(frame_id_t frame_id) { pin(frame_id); }
+
+    /**
+     * Collect the frames that would be victimized next, in eviction order, without removing them.
+     * Used by the background page cleaner; policies that cannot tell leave frame_ids empty.
+     * @param max_frames the maximum number of frames to collect
+     * @param[out] frame_ids the collected frame ids
+     */
+    virtual void peek_victims(size_t max_frames, std::vector<frame_id_t> *frame_ids) {}
+
+    /**
+     * The buffer pool now has num_frames frames. Frames at or above num_frames have already been removed and
+     * are not unpinned again until the pool grows back; policies with per-frame state must cover the new range.
+     * @param num_frames the new number of frames
+     */
+    virtual void resize(size_t num_frames) {}
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
 };
@@ -14,9 +14,12 @@ See the Mulan PSL v2 for more details. */
 #include <setjmp.h>
 #include <signal.h>
 #include <unistd.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <random>
+#include <set>
+#include <shared_mutex>
 
 #include "errors.h"
 #include "optimizer/optimizer.h"
@@ -25,28 +28,97 @@ See the Mulan PSL v2 for more details. */
 #include "optimizer/planner.h"
 #include "portal.h"
 #include "analyze/analyze.h"
+#include "execution/load_scheduler.h"
 
 #define SOCK_PORT 8765
 #define MAX_CONN_LIMIT 8
 
 static bool should_exit = false;
 
-// 构建全局所需的管理器对象
+// 构建全局所需的管理器对象, 依赖缓冲池的管理器在main中解析启动参数后由init_managers构建
 auto disk_manager = std::make_unique<DiskManager>();
 auto log_manager = std::make_unique<LogManager>(disk_manager.get());
-auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get(), log_manager.get());
-auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
-auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
-auto sm_manager = std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+std::unique_ptr<BufferPoolManager> buffer_pool_manager;
+std::unique_ptr<RmManager> rm_manager;
+std::unique_ptr<IxManager> ix_manager;
+std::unique_ptr<SmManager> sm_manager;
 auto lock_manager = std::make_unique<LockManager>();
-auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
-auto ql_manager = std::make_unique<QlManager>(sm_manager.get(), txn_manager.get());
-auto recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get(), log_manager.get());
-auto planner = std::make_unique<Planner>(sm_manager.get());
-auto optimizer = std::make_unique<Optimizer>(sm_manager.get(), planner.get());
-auto portal = std::make_unique<Portal>(sm_manager.get());
-auto analyze = std::make_unique<Analyze>(sm_manager.get());
-std::atomic<int> load_threads(0);
+std::unique_ptr<TransactionManager> txn_manager;
+std::unique_ptr<QlManager> ql_manager;
+std::unique_ptr<RecoveryManager> recovery;
+std::unique_ptr<Planner> planner;
+std::unique_ptr<Optimizer> optimizer;
+std::unique_ptr<Portal> portal;
+std::unique_ptr<Analyze> analyze;
+
+/**
+ * @description: 按启动参数构建缓冲池及其上层的管理器对象
+ * @param {string&} replacer_type 缓冲池置换策略, "LRU"、"LRUK"或"CLOCK"
+ * @param {size_t} pool_size 缓冲池的帧数
+ * @param {size_t} max_pool_size SET buffer_pool_size可以扩容到的最大帧数
+ */
+void init_managers(const std::string &replacer_type, size_t pool_size, size_t max_pool_size) {
+    buffer_pool_manager = std::make_unique<BufferPoolManager>(pool_size, disk_manager.get(), log_manager.get(), replacer_type, max_pool_size);
+    rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    sm_manager = std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
+    ql_manager = std::make_unique<QlManager>(sm_manager.get(), txn_manager.get());
+    recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get(), log_manager.get());
+    planner = std::make_unique<Planner>(sm_manager.get());
+    optimizer = std::make_unique<Optimizer>(sm_manager.get(), planner.get());
+    portal = std::make_unique<Portal>(sm_manager.get());
+    analyze = std::make_unique<Analyze>(sm_manager.get());
+}
+
+LoadScheduler load_scheduler;
+
+/**
+ * @description: 事务写过的表, 提交和回滚时访问这些表
+ */
+static std::vector<std::string> get_write_set_tables(Transaction *txn) {
+    std::set<std::string> tab_names;
+    if (txn != nullptr) {
+        for (auto write_record : *txn->get_write_set()) {
+            tab_names.insert(write_record->GetTableName());
+        }
+    }
+    return {tab_names.begin(), tab_names.end()};
+}
+
+/**
+ * @description: 语句访问的表, LOAD进行期间访问同一张表的语句需要等待
+ * @param {Transaction*} txn 语句所在的事务, COMMIT和ABORT访问它写过的表
+ */
+static std::vector<std::string> get_statement_tables(const std::shared_ptr<Query> &query, Transaction *txn) {
+    auto &parse = query->parse;
+    if (std::dynamic_pointer_cast<ast::SelectStmt>(parse)) {
+        return query->tables;
+    } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::DeleteStmt>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::UpdateStmt>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::DropTable>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(parse)) {
+        return {x->tab_name};
+    } else if (auto x = std::dynamic_pointer_cast<ast::ShowIndex>(parse)) {
+        return {x->tab_name};
+    } else if (std::dynamic_pointer_cast<ast::TxnCommit>(parse) || std::dynamic_pointer_cast<ast::TxnAbort>(parse) ||
+               std::dynamic_pointer_cast<ast::TxnRollback>(parse)) {
+        return get_write_set_tables(txn);
+    } else if (std::dynamic_pointer_cast<ast::ShowSpace>(parse) || std::dynamic_pointer_cast<ast::ShowIndexStats>(parse)) {
+        // 遍历所有的表和索引
+        return sm_manager->get_table_names();
+    }
+    return {};
+}
 pthread_mutex_t *buffer_mutex;
 pthread_mutex_t *sockfd_mutex;
 std::atomic<bool> enable_logging = true;
@@ -153,17 +225,29 @@ void *client_handler(void *sock_fd) {
                                 context_tmp->txn_ = txn_manager->get_transaction(txn_id);
                             }
                             // std::cout<<"txn_id["<<txn_id<<"]: "<<sql<<std::endl;
+                            // 读写表中记录的语句执行期间持有元数据读锁, 在线建立索引登记和发布时会等待这些语句结束
+                            // LOAD执行时间长, 只在生成计划和建立算子时持有, 之后由算子按批短暂持有, 不阻塞其他表上的CREATE INDEX
+                            std::shared_lock<MetaLatch> meta_guard(sm_manager->meta_latch_, std::defer_lock);
+                            auto &parse = query->parse;
+                            bool is_load = std::dynamic_pointer_cast<ast::LoadStmt>(parse) != nullptr;
+                            if (std::dynamic_pointer_cast<ast::SelectStmt>(parse) || std::dynamic_pointer_cast<ast::InsertStmt>(parse) ||
+                                std::dynamic_pointer_cast<ast::DeleteStmt>(parse) || std::dynamic_pointer_cast<ast::UpdateStmt>(parse) ||
+                                is_load) {
+                                meta_guard.lock();
+                            }
                             // 优化器
                             std::shared_ptr<Plan> plan = optimizer->plan_query(query, context_tmp);
                             // portal
                             std::shared_ptr<PortalStmt> portalStmt = portal->start(plan, context_tmp);
+                            if (is_load) {
+                                meta_guard.unlock();
+                            }
                             if(!query->values.empty())
                                 portalStmt->root->limit_num = query->values[0].bigint_val; // 传递值
                             
                             portal->run(portalStmt, ql_manager.get(), &txn_id, context_tmp);
                             portal->drop();
                             if (is_detached) {
-                                --load_threads;
                                 if(context_tmp->txn_->get_txn_mode() == false && context_tmp->txn_->get_state() != TransactionState::ABORTED) {
                                     txn_manager->commit(context_tmp->txn_, context_tmp->log_mgr_);
                                 }
@@ -173,14 +257,28 @@ void *client_handler(void *sock_fd) {
 
                         if (auto x = std::dynamic_pointer_cast<ast::LoadStmt>(query->parse)){
                             is_this_cmd_load = true;
-                            ++load_threads;
-                            std::thread t(execute, txn_id, std::string(data_recv), true);
+                            // 在返回结果之前登记, 这个客户端之后访问同一张表的语句一定在LOAD结束后执行
+                            load_scheduler.begin_load(x->tab_name);
+                            std::thread t([execute, txn_id, sql = std::string(data_recv), tab_name = x->tab_name]() {
+                                try {
+                                    execute(txn_id, sql, true);
+                                } catch (RMDBError &e) {
+                                    std::cerr << e.what() << std::endl;
+                                }
+                                load_scheduler.end_load(tab_name);
+                            });
                             txn_id = INVALID_TXN_ID;
                             t.detach();
                         } else {
-                            while (load_threads > 0)
-                                std::this_thread::sleep_for(std::chrono::milliseconds(3000));
-                            execute(txn_id, std::string(data_recv), false);
+                            auto tab_names = get_statement_tables(query, context->txn_);
+                            load_scheduler.begin_statement(tab_names);
+                            try {
+                                execute(txn_id, std::string(data_recv), false);
+                            } catch (...) {
+                                load_scheduler.end_statement(tab_names);
+                                throw;
+                            }
+                            load_scheduler.end_statement(tab_names);
                         }
 
                         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
@@ -192,8 +290,16 @@ void *client_handler(void *sock_fd) {
                         data_send[str.length()] = '\0';
                         offset = str.length();
 
-                        // 回滚事务
-                        txn_manager->abort(context->txn_, log_manager.get());
+                        // 回滚事务, 回滚会写事务访问过的表, 同样要等这些表上的LOAD结束
+                        auto tab_names = get_write_set_tables(context->txn_);
+                        load_scheduler.begin_statement(tab_names);
+                        try {
+                            txn_manager->abort(context->txn_, log_manager.get());
+                        } catch (...) {
+                            load_scheduler.end_statement(tab_names);
+                            throw;
+                        }
+                        load_scheduler.end_statement(tab_names);
                         std::cout << e.GetInfo() << std::endl;
 
                         AppendToOutputFile(str);
@@ -316,9 +422,34 @@ void start_server() {
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
+    // rmdb [-r LRU|LRUK|CLOCK] [-b pool_size] [-m max_pool_size] [-d] <database>
+    std::string replacer_type = REPLACER_TYPE;
+    size_t pool_size = BUFFER_POOL_SIZE;
+    size_t max_pool_size = BUFFER_POOL_MAX_SIZE;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:b:m:d")) > 0) {
+        switch (opt) {
+            case 'r':
+                replacer_type = optarg;
+                std::transform(replacer_type.begin(), replacer_type.end(), replacer_type.begin(), ::toupper);
+                break;
+            case 'b':
+                pool_size = strtoul(optarg, nullptr, 10);
+                break;
+            case 'm':
+                max_pool_size = strtoul(optarg, nullptr, 10);
+                break;
+            case 'd':
+                // 表和索引文件使用O_DIRECT, 页面只缓存在缓冲池中
+                disk_manager->set_direct_io(true);
+                break;
+            default:
+                break;
+        }
+    }
+    if (optind != argc - 1 || pool_size == 0) {
         // 需要指定数据库名称
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [-r LRU|LRUK|CLOCK] [-b pool_size] [-m max_pool_size] [-d] <database>" << std::endl;
         exit(1);
     }
 
@@ -335,8 +466,9 @@ int main(int argc, char **argv) {
                      "Welcome to RMDB!\n"
                      "Type 'help;' for help.\n"
                      "\n";
+        init_managers(replacer_type, pool_size, max_pool_size);
         // Database name is passed by args
-        std::string db_name = argv[1];
+        std::string db_name = argv[optind];
         if (!sm_manager->is_dir(db_name)) {
             // Database not found, create a new one
             sm_manager->create_db(db_name);
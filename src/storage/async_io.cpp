@@ -0,0 +1,378 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/async_io.h"
+
+#include <linux/io_uring.h>
+#include <string.h>    // for memset
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "errors.h"
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+/**
+ * @description: 记录一个请求完成, 最后一个请求完成时唤醒等待者
+ * @param {IORequest&} request 完成的请求
+ * @param {ssize_t} result 实际读写的字节数, 出错时为负数
+ */
+void IOBatch::complete(const IORequest &request, ssize_t result) {
+    if (result < 0 || static_cast<size_t>(result) != request.num_bytes) {
+        failed_ = true;
+    }
+    // 在latch_内减计数并通知, 避免等待者返回并析构批次后才通知
+    std::lock_guard<std::mutex> guard(latch_);
+    if (--pending_ == 0) {
+        cv_.notify_all();
+    }
+}
+
+/**
+ * @description: 阻塞直到批次内所有请求完成
+ *              有请求读写的字节数与请求大小不一致时, throw InternalError("IOBatch::wait Error")
+ */
+void IOBatch::wait() {
+    drain();
+    if (failed_) {
+        throw InternalError("IOBatch::wait Error");
+    }
+}
+
+/**
+ * @description: 阻塞直到批次内所有请求完成, 不检查结果
+ *              提交出错时用它等待已经交给内核的请求, 之后才能释放缓冲区和批次
+ */
+void IOBatch::drain() {
+    std::unique_lock<std::mutex> l(latch_);
+    cv_.wait(l, [&] { return pending_.load() == 0; });
+}
+
+/**
+ * @description: 创建异步IO引擎, 优先使用io_uring
+ * @param {size_t} queue_depth io_uring提交队列的深度
+ * @param {size_t} num_workers 退化为线程池时的工作线程数量
+ */
+std::unique_ptr<AsyncIO> AsyncIO::create(size_t queue_depth, size_t num_workers) {
+    auto uring = std::make_unique<UringIO>(queue_depth);
+    if (uring->is_valid()) {
+        return uring;
+    }
+    return std::make_unique<ThreadPoolIO>(num_workers);
+}
+
+void AsyncIO::submit(IOBatch *batch) {
+    batch->failed_ = false;
+    batch->pending_ = batch->requests_.size();
+    if (batch->requests_.empty()) {
+        return;
+    }
+    submit_requests(batch);
+}
+
+/**
+ * @description: 用preadv/pwritev同步执行一个请求, 直到读写完全部字节、遇到文件末尾或出错
+ * @return {ssize_t} 实际读写的字节数, 出错时返回-1
+ */
+ssize_t AsyncIO::do_sync_io(const IORequest &request) {
+    std::vector<struct iovec> iovs = request.iovs;
+    off_t offset = static_cast<off_t>(request.page_no) * PAGE_SIZE;
+    size_t done = 0;
+    size_t first = 0;   // 第一个尚未读写完的缓冲区
+    while (done < request.num_bytes) {
+        ssize_t result = request.is_write ? pwritev(request.fd, &iovs[first], iovs.size() - first, offset + done)
+                                          : preadv(request.fd, &iovs[first], iovs.size() - first, offset + done);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return result == 0 ? static_cast<ssize_t>(done) : -1;
+        }
+        done += result;
+        // 部分完成时跳过已读写完的缓冲区, 并调整第一个未完成缓冲区的起点
+        size_t advance = result;
+        while (advance > 0 && advance >= iovs[first].iov_len) {
+            advance -= iovs[first].iov_len;
+            first++;
+        }
+        if (advance > 0) {
+            iovs[first].iov_base = static_cast<char *>(iovs[first].iov_base) + advance;
+            iovs[first].iov_len -= advance;
+        }
+    }
+    return static_cast<ssize_t>(done);
+}
+
+/**
+ * @description: 建立io_uring并映射提交队列和完成队列, 内核不支持时is_valid()返回false
+ * @param {size_t} queue_depth 提交队列的深度
+ */
+UringIO::UringIO(size_t queue_depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = io_uring_setup(queue_depth, &params);
+    if (ring_fd_ < 0) {
+        ring_fd_ = -1;
+        return;
+    }
+    sq_entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                   IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+        sq_ptr_ = nullptr;
+        release();
+        return;
+    }
+    if (single_mmap) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        cq_ptr_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                       IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            cq_ptr_ = nullptr;
+            release();
+            return;
+        }
+    }
+    void *sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        release();
+        return;
+    }
+    sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sq_ptr_);
+    char *cq = static_cast<char *>(cq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    reaper_thread_ = new std::thread(&UringIO::reap, this);
+}
+
+UringIO::~UringIO() {
+    if (reaper_thread_ != nullptr) {
+        // 提交一个user_data为0的NOP, 收割线程看到它的完成事件后退出; 收割线程出错时已经自行退出
+        std::unique_lock<std::mutex> l(submit_latch_);
+        space_cv_.wait(l, [&] { return inflight_ < sq_entries_ || reap_error_ != 0; });
+        if (reap_error_ == 0) {
+            unsigned tail = *sq_tail_;
+            unsigned idx = tail & *sq_mask_;
+            memset(&sqes_[idx], 0, sizeof(struct io_uring_sqe));
+            sqes_[idx].opcode = IORING_OP_NOP;
+            sq_array_[idx] = idx;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+            inflight_++;
+            while (io_uring_enter(ring_fd_, 1, 0, 0) < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            }
+        }
+        l.unlock();
+        reaper_thread_->join();
+        delete reaper_thread_;
+    }
+    release();
+}
+
+/**
+ * @description: 解除映射并关闭io_uring
+ */
+void UringIO::release() {
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sq_entries_ * sizeof(struct io_uring_sqe));
+        sqes_ = nullptr;
+    }
+    if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) {
+        munmap(cq_ptr_, cq_ring_size_);
+    }
+    cq_ptr_ = nullptr;
+    if (sq_ptr_ != nullptr) {
+        munmap(sq_ptr_, sq_ring_size_);
+        sq_ptr_ = nullptr;
+    }
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+}
+
+/**
+ * @description: 将批次内的请求填入提交队列, 每填满一轮调用一次io_uring_enter
+ *              在途请求数达到队列深度时等待收割线程腾出空间
+ *              io_uring_enter出错或收割线程已经退出时throw UnixError, 此时未提交的请求已按失败完成
+ */
+void UringIO::submit_requests(IOBatch *batch) {
+    std::unique_lock<std::mutex> l(submit_latch_);
+    size_t next = 0;
+    while (next < batch->requests_.size()) {
+        space_cv_.wait(l, [&] { return inflight_ < sq_entries_ || reap_error_ != 0; });
+        if (reap_error_ != 0) {
+            for (size_t i = next; i < batch->requests_.size(); i++) {
+                complete(&batch->requests_[i], -1);
+            }
+            errno = reap_error_;
+            throw UnixError();
+        }
+        // 只有持有submit_latch_的线程会修改sq_tail_
+        unsigned tail = *sq_tail_;
+        unsigned to_submit = 0;
+        while (next < batch->requests_.size() && inflight_ < sq_entries_) {
+            IORequest &request = batch->requests_[next++];
+            unsigned idx = tail & *sq_mask_;
+            struct io_uring_sqe *sqe = &sqes_[idx];
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = request.is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request.fd;
+            sqe->addr = reinterpret_cast<uint64_t>(request.iovs.data());
+            sqe->len = request.iovs.size();
+            sqe->off = static_cast<uint64_t>(request.page_no) * PAGE_SIZE;
+            sqe->user_data = reinterpret_cast<uint64_t>(&request);
+            sq_array_[idx] = idx;
+            tail++;
+            inflight_++;
+            inflight_requests_.insert(&request);
+            to_submit++;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        while (to_submit > 0) {
+            int submitted = io_uring_enter(ring_fd_, to_submit, 0, 0);
+            if (submitted < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                UnixError error;
+                // 撤回内核还没取走的SQE, 连同尚未填入队列的请求一起按失败完成;
+                // 已取走的请求仍由收割线程完成, 调用者wait()返回后才能释放缓冲区和批次
+                tail -= to_submit;
+                __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+                inflight_ -= to_submit;
+                space_cv_.notify_all();
+                for (size_t i = next - to_submit; i < batch->requests_.size(); i++) {
+                    inflight_requests_.erase(&batch->requests_[i]);
+                    complete(&batch->requests_[i], -1);
+                }
+                throw error;
+            }
+            to_submit -= submitted;
+        }
+    }
+}
+
+/**
+ * @description: 收割线程, 阻塞等待完成事件并通知对应的批次
+ *              io_uring_enter出错时也先收割完成队列再重试, EBUSY(完成队列溢出)只有收割后才会消除;
+ *              其他无法重试的错误下不再有完成事件, 在途请求按失败完成后退出
+ */
+void UringIO::reap() {
+    bool stop = false;
+    std::vector<std::pair<IORequest *, ssize_t>> completions;
+    while (!stop) {
+        int error = 0;
+        if (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            error = errno;
+        }
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        size_t reaped = 0;
+        completions.clear();
+        for (; head != tail; head++, reaped++) {
+            struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+            auto *request = reinterpret_cast<IORequest *>(cqe->user_data);
+            if (request == nullptr) {
+                stop = true;
+                continue;
+            }
+            completions.emplace_back(request, cqe->res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        bool broken = error != 0 && error != EINTR && error != EAGAIN && error != EBUSY;
+        if (reaped > 0 || broken) {
+            // 先从在途请求中删除再完成, 完成后批次可能被释放, 同一地址上的新请求不能被误删
+            std::lock_guard<std::mutex> guard(submit_latch_);
+            for (auto &completion : completions) {
+                inflight_requests_.erase(completion.first);
+            }
+            inflight_ -= reaped;
+            if (broken) {
+                reap_error_ = error;
+                for (IORequest *request : inflight_requests_) {
+                    completions.emplace_back(request, -1);
+                }
+                inflight_requests_.clear();
+                inflight_ = 0;
+                stop = true;
+            }
+            space_cv_.notify_all();
+        }
+        for (auto &completion : completions) {
+            complete(completion.first, completion.second);
+        }
+    }
+}
+
+ThreadPoolIO::ThreadPoolIO(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++) {
+        workers_.emplace_back([this] {
+            while (true) {
+                std::unique_lock<std::mutex> l(latch_);
+                cv_.wait(l, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    // stop_且队列已清空
+                    return;
+                }
+                IORequest *request = queue_.front();
+                queue_.pop_front();
+                l.unlock();
+                complete(request, do_sync_io(*request));
+            }
+        });
+    }
+}
+
+ThreadPoolIO::~ThreadPoolIO() {
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPoolIO::submit_requests(IOBatch *batch) {
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (auto &request : batch->requests_) {
+            queue_.push_back(&request);
+        }
+    }
+    cv_.notify_all();
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "common/config.h"
+
+class IOBatch;
+
+/**
+ * @description: 一个页面读写请求, 可以跨越多个连续页面; 磁盘上连续的数据可以分散在多个内存缓冲区中
+ */
+struct IORequest {
+    int fd;
+    page_id_t page_no;              // 起始页号, 文件偏移为page_no * PAGE_SIZE
+    std::vector<struct iovec> iovs; // 内存缓冲区及大小, 按文件偏移顺序排列
+    size_t num_bytes;               // 所有缓冲区的总大小
+    bool is_write;
+    IOBatch *batch;                 // 所属的批次, 完成时通知该批次
+};
+
+/**
+ * @description: 一批一起提交的读写请求
+ *              提交后不能再添加请求; 调用wait()等待批次内所有请求完成
+ */
+class IOBatch {
+   public:
+    IOBatch() = default;
+
+    void add_read(int fd, page_id_t page_no, char *buf, size_t num_bytes) {
+        requests_.push_back({fd, page_no, {{buf, num_bytes}}, num_bytes, false, this});
+    }
+
+    void add_write(int fd, page_id_t page_no, const char *buf, size_t num_bytes) {
+        requests_.push_back({fd, page_no, {{const_cast<char *>(buf), num_bytes}}, num_bytes, true, this});
+    }
+
+    /**
+     * @description: 把分散在多个缓冲区中的数据写到从page_no开始的连续磁盘空间
+     * @param {vector<iovec>} iovs 按文件偏移顺序排列的缓冲区, 个数不超过IOV_MAX
+     */
+    void add_writev(int fd, page_id_t page_no, std::vector<struct iovec> iovs) {
+        size_t num_bytes = 0;
+        for (auto &iov : iovs) {
+            num_bytes += iov.iov_len;
+        }
+        requests_.push_back({fd, page_no, std::move(iovs), num_bytes, true, this});
+    }
+
+    size_t size() const { return requests_.size(); }
+
+    bool empty() const { return requests_.empty(); }
+
+    bool is_done() const { return pending_.load() == 0; }
+
+    void wait();
+
+    void drain();
+
+   private:
+    friend class AsyncIO;
+    friend class UringIO;
+    friend class ThreadPoolIO;
+
+    void complete(const IORequest &request, ssize_t result);
+
+    std::vector<IORequest> requests_;
+    std::atomic<size_t> pending_{0};    // 尚未完成的请求数
+    std::atomic<bool> failed_{false};   // 是否有请求读写的字节数不等于请求的大小
+    std::mutex latch_;                  // 只配合cv_使用
+    std::condition_variable cv_;
+};
+
+/**
+ * @description: 异步磁盘IO引擎, 提交与完成分离: submit()只负责提交, 由IOBatch::wait()等待完成
+ *              create()在内核支持时使用io_uring, 否则退化为pread/pwrite工作线程池
+ */
+class AsyncIO {
+   public:
+    virtual ~AsyncIO() = default;
+
+    /**
+     * @description: 异步提交批次内的所有请求, 批次在完成前必须保持有效
+     * @param {IOBatch*} batch 要提交的批次
+     */
+    void submit(IOBatch *batch);
+
+    virtual const char *name() const = 0;
+
+    static std::unique_ptr<AsyncIO> create(size_t queue_depth = ASYNC_IO_QUEUE_DEPTH, size_t num_workers = ASYNC_IO_WORKERS);
+
+   protected:
+    virtual void submit_requests(IOBatch *batch) = 0;
+
+    static ssize_t do_sync_io(const IORequest &request);
+
+    static void complete(IORequest *request, ssize_t result) { request->batch->complete(*request, result); }
+};
+
+/**
+ * @description: 基于io_uring的实现, 一个提交队列, 一个收割线程负责处理完成队列
+ */
+class UringIO : public AsyncIO {
+   public:
+    explicit UringIO(size_t queue_depth);
+
+    ~UringIO();
+
+    bool is_valid() const { return ring_fd_ >= 0; }
+
+    const char *name() const { return "io_uring"; }
+
+   protected:
+    void submit_requests(IOBatch *batch);
+
+   private:
+    void reap();
+
+    void release();
+
+    int ring_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    void *sq_ptr_ = nullptr;
+    void *cq_ptr_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    struct io_uring_sqe *sqes_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    struct io_uring_cqe *cqes_ = nullptr;
+
+    std::mutex submit_latch_;           // 提交队列只有一个生产者
+    std::condition_variable space_cv_;  // 在途请求数降到sq_entries_以下时唤醒提交者
+    size_t inflight_ = 0;               // 在途请求数, 受submit_latch_保护; 不超过sq_entries_, 保证完成队列不会溢出
+    std::unordered_set<IORequest *> inflight_requests_;  // 已填入提交队列、尚未收割的请求, 受submit_latch_保护
+    int reap_error_ = 0;                // 收割线程因io_uring_enter出错退出时的errno, 受submit_latch_保护; 之后的提交直接失败
+    std::thread *reaper_thread_ = nullptr;
+};
+
+/**
+ * @description: 不支持io_uring时的实现, 若干工作线程从队列中取请求执行pread/pwrite
+ */
+class ThreadPoolIO : public AsyncIO {
+   public:
+    explicit ThreadPoolIO(size_t num_workers);
+
+    ~ThreadPoolIO();
+
+    const char *name() const { return "thread pool"; }
+
+   protected:
+    void submit_requests(IOBatch *batch);
+
+   private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<IORequest *> queue_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -10,6 +10,13 @@ See the Mulan PSL v2 for more details. */
 
 #include "buffer_pool_manager.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+
 /**
  * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
  * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
@@ -20,21 +27,65 @@ bool BufferPoolManager::find_victim_page(frame_id_t* frame_id) {
     // 1 使用BufferPoolManager::free_list_判断缓冲池是否已满需要淘汰页面
     // 1.1 未满获得frame
     // 1.2 已满使用lru_replacer中的方法选择淘汰页面
-    // std::unique_lock<std::mutex> l(latch_);
+    std::unique_lock<std::mutex> l(free_latch_);
     if(!free_list_.empty()){
         // 有空闲帧
         *frame_id = free_list_.front();
         free_list_.pop_front();
-        // l.unlock();
         return true;
     }
-    else{
-        return replacer_->victim(frame_id);
+    l.unlock();
+    return replacer_->victim(frame_id);
+}
+
+/**
+ * @description: 获得一个可淘汰帧并对其帧latch上锁。
+ *              victim取出帧到上锁之间, 该帧上的旧页面可能被其他线程重新pin住, 或者该帧因缩容而退役,
+ *              因此上锁后需检查is_usable_frame, 不满足则重新挑选
+ * @return {bool} true: 成功获得并锁住可替换帧, false: 缓冲池中所有帧都被pin住
+ * @param {frame_id_t*} frame_id 返回已上锁的帧id
+ */
+bool BufferPoolManager::lock_victim_frame(frame_id_t* frame_id) {
+    while(find_victim_page(frame_id)){
+        (pagelatch_+*frame_id)->lock();
+        if(is_usable_frame(*frame_id)){
+            // 旧页面在被victim后可能又被pin/unpin过而重新进入replacer, 这里将其移出
+            replacer_->pin(*frame_id);
+            return true;
+        }
+        // 已被其他线程重新pin住, 由其unpin时再放回replacer; 退役帧由resize处理
+        (pagelatch_+*frame_id)->unlock();
+    }
+    return false;
+}
+
+/**
+ * @description: 从free_list_中取出一个空闲帧并对其帧latch上锁, 不淘汰任何页面
+ * @return {bool} true: 成功获得并锁住空闲帧, false: free_list_为空
+ * @param {frame_id_t*} frame_id 返回已上锁的帧id
+ */
+bool BufferPoolManager::lock_free_frame(frame_id_t* frame_id) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> free_guard(free_latch_);
+            if (free_list_.empty()) {
+                return false;
+            }
+            *frame_id = free_list_.front();
+            free_list_.pop_front();
+        }
+        (pagelatch_ + *frame_id)->lock();
+        if (is_usable_frame(*frame_id)) {
+            replacer_->pin(*frame_id);
+            return true;
+        }
+        (pagelatch_ + *frame_id)->unlock();
     }
 }
 
 /**
- * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page table
+ * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)
+ *              调用者需持有该帧的latch; 旧页面在页表中的映射采用延迟删除
  * @param {Page*} page 写回页指针
  * @param {PageId} new_page_id 新的page_id
  * @param {frame_id_t} new_frame_id 新的帧frame_id
@@ -46,22 +97,67 @@ void BufferPoolManager::update_page(Page *page, PageId new_page_id, frame_id_t n
     // 3 重置page的data，更新page id
     if(page->is_dirty()){
         // for logging
-        auto lsn = page->get_page_lsn();
-        log_manager_->ForceFlush(lsn);
+        if(log_manager_ != nullptr) {
+            auto lsn = page->get_page_lsn();
+            log_manager_->ForceFlush(lsn);
+        }
         
         disk_manager_->write_page(page->get_page_id().fd, page->get_page_id().page_no, page->data_, PAGE_SIZE);
+        // 前台线程付出了一次同步写, 说明淘汰端的干净帧不够了, 唤醒后台写线程
+        cleaner_cv_.notify_one();
     }
-    // std::unique_lock<std::mutex> l(latch_);
-    // page_table_.erase(page->get_page_id());
-    // page_table_[new_page_id] = new_frame_id;
-    // l.unlock();
 
-    page->id_ = new_page_id;
-    page->is_dirty_ = false;
+    set_dirty(page, new_frame_id, false);
+    set_page_id(page, new_frame_id, new_page_id);
     page->pin_count_ = 0;
     page->reset_memory();
 }
 
+/**
+ * @description: 修改帧中页面的page_id, 并同步维护新旧两个文件的页面索引; 调用者需持有该帧的latch
+ * @param {Page*} page 帧中的页面
+ * @param {frame_id_t} frame_id 帧号
+ * @param {PageId} new_page_id 新的page_id, page_no为INVALID_PAGE_ID表示帧不再存放任何页面
+ */
+void BufferPoolManager::set_page_id(Page *page, frame_id_t frame_id, PageId new_page_id) {
+    PageId old_page_id = page->id_;
+    if (old_page_id.page_no != INVALID_PAGE_ID) {
+        FileFrameIndex &old_file = file_frames_[old_page_id.fd];
+        std::lock_guard<std::mutex> guard(old_file.latch_);
+        old_file.resident_.erase(frame_id);
+        old_file.dirty_.erase(frame_id);
+    }
+    page->id_ = new_page_id;
+    if (new_page_id.page_no != INVALID_PAGE_ID) {
+        FileFrameIndex &new_file = file_frames_[new_page_id.fd];
+        std::lock_guard<std::mutex> guard(new_file.latch_);
+        new_file.resident_.insert(frame_id);
+    }
+}
+
+/**
+ * @description: 修改页面的脏标记, 并同步维护所属文件的脏页索引; 调用者需持有该帧的latch
+ * @param {Page*} page 帧中的页面
+ * @param {frame_id_t} frame_id 帧号
+ * @param {bool} is_dirty 新的脏标记
+ */
+void BufferPoolManager::set_dirty(Page *page, frame_id_t frame_id, bool is_dirty) {
+    if (page->is_dirty_ == is_dirty) {
+        return;
+    }
+    page->is_dirty_ = is_dirty;
+    if (page->id_.page_no == INVALID_PAGE_ID) {
+        return;
+    }
+    FileFrameIndex &file = file_frames_[page->id_.fd];
+    std::lock_guard<std::mutex> guard(file.latch_);
+    if (is_dirty) {
+        file.dirty_.insert(frame_id);
+    } else {
+        file.dirty_.erase(frame_id);
+    }
+}
+
 /**
  * @description: 从buffer pool获取需要的页。
  *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
@@ -78,65 +174,69 @@ Page* BufferPoolManager::fetch_page(PageId page_id) {
     // 3.     调用disk_manager_的read_page读取目标页到frame
     // 4.     固定目标页，更新pin_count_
     // 5.     返回目标页
-    // std::cout << "fetch page :" << page_id.page_no << std::endl;
 
-    std::unique_lock<std::mutex> l(latch_);
+    PageTablePartition &part = get_partition(page_id);
+    std::unique_lock<std::mutex> l(part.latch_);
     Page* loc_page;
     frame_id_t frame_id;
-    if(page_table_.count(page_id)){
-        frame_id = page_table_[page_id];
-        // lock frame
-        // while(true){
-        //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-        //     if( is_latch == false) break;
-        //     // else std::cout << "hcy" ;
-        // }
+    auto iter = part.table_.find(page_id);
+    if(iter != part.table_.end()){
+        frame_id = iter->second;
         (pagelatch_+frame_id)->lock();
         // 检查获取的页是否是期望的
         loc_page = pages_ + frame_id;
-        if( !(loc_page->get_page_id() == page_id) ){
-            // 不等于page_id, 首先将这个页从页表删除(延迟删除)，之后重新fetch
-            page_table_.erase(page_id);
-            (pagelatch_+frame_id)->unlock();
-            // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
+        if( loc_page->get_page_id() == page_id ){
+            replacer_->pin(frame_id);
+            part.hits_++;
+            // 是期望的页，分区latch可以释放
             l.unlock();
-            return fetch_page(page_id);
+            loc_page->pin_count_ ++;
+            // 在帧latch内读取, 与read_pages完成时的更新互斥
+            bool pending = io_pending_[frame_id];
+            (pagelatch_+frame_id)->unlock();
+            if(pending){
+                // 页面由预读线程装入, 数据尚未读完; 已经pin住, 帧不会被淘汰
+                wait_for_io(frame_id);
+                std::lock_guard<std::mutex> frame_guard(pagelatch_[frame_id]);
+                if( !(loc_page->get_page_id() == page_id) ){
+                    // 读入失败, read_pages已把页面移出页表, 这里撤销自己的pin, 最后一个撤销的线程归还帧
+                    if(--loc_page->pin_count_ == 0){
+                        release_frame(frame_id);
+                    }
+                    throw InternalError("BufferPoolManager::fetch_page Error");
+                }
+            }
+            return loc_page;
         }
-        replacer_->pin(frame_id);
-        // 是期望的页，l可以释放
-        l.unlock();
-        loc_page->pin_count_ ++;
+        // 不等于page_id, 将这个页从页表删除(延迟删除)，之后按未命中处理
+        part.table_.erase(iter);
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
-    }
-    else{
-        if(find_victim_page(&frame_id) == false){
-            throw BufferpoolFullError();
-            return nullptr;
-        }
-        // 得到分配的帧号
-        loc_page = pages_+ frame_id;
-        // 对帧上锁, cas操作，0 -> 1
-        // while(true){
-        //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-        //     if( is_latch == false) break;
-        //     // else std::cout << "hcy" ;
-        // }
-        (pagelatch_+frame_id)->lock();
-        // 在这里更新页表
-        page_table_[page_id] = frame_id;
-        l.unlock();
+    }
 
-        // 上了frame的锁, 慢慢update, 此时新旧page_id都会映射到这个帧
-        update_page(loc_page, page_id, frame_id);
-        // std::cout << "now read page from disk: " << page_id.page_no << std::endl;
+    if(lock_victim_frame(&frame_id) == false){
+        throw BufferpoolFullError();
+    }
+    // 得到分配的帧号并已持有帧latch, 在这里更新页表
+    loc_page = pages_+ frame_id;
+    part.table_[page_id] = frame_id;
+    part.misses_++;
+    l.unlock();
+
+    // 上了frame的锁, 慢慢update, 此时新旧page_id都会映射到这个帧
+    update_page(loc_page, page_id, frame_id);
+    try {
         disk_manager_->read_page(page_id.fd, page_id.page_no, loc_page->data_, PAGE_SIZE);
-        loc_page->pin_count_ ++;
-        // page_table_.erase(loc_page->get_page_id());
-        // 读取完毕，解锁
+    } catch (InternalError &) {
+        // 读入失败, 把帧的页号置为无效后归还; 页表中的旧映射之后按延迟删除处理
+        set_page_id(loc_page, frame_id, {-1, INVALID_PAGE_ID});
+        loc_page->reset_memory();
+        release_frame(frame_id);
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
+        throw;
     }
+    loc_page->pin_count_ ++;
+    // 读取完毕，解锁
+    (pagelatch_+frame_id)->unlock();
     return loc_page;
 }
 
@@ -157,44 +257,38 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
     // 2.2.1 若自减后等于0，则调用replacer_的Unpin
     // 3 根据参数is_dirty，更改P的is_dirty_
 
-    std::unique_lock<std::mutex> l(latch_);
-    if(!page_table_.count(page_id)){
+    PageTablePartition &part = get_partition(page_id);
+    std::unique_lock<std::mutex> l(part.latch_);
+    auto iter = part.table_.find(page_id);
+    if(iter == part.table_.end()){
         // Not found page in page table
         return false;
     }
-    int frame_id = page_table_[page_id];
+    frame_id_t frame_id = iter->second;
     Page* page = pages_ + frame_id;
 
-    // 对帧上锁, cas操作，0 -> 1
-    // while(true){
-    //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-    //     if( is_latch == false) break;
-    //     // else std::cout << "hcy" ;
-    // }
     (pagelatch_+frame_id)->lock();
     // 检查获取的页是否是期望的
     if( !(page->get_page_id() == page_id) ){
-        // 不等于page_id, 首先将这个页从页表删除(延迟删除)，之后重新fetch
-        page_table_.erase(page_id);
+        // 不等于page_id, 将这个页从页表删除(延迟删除)
+        part.table_.erase(iter);
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
         return false;
     }
+    l.unlock();
 
     int pin_cnt = page->pin_count_;
     if(pin_cnt == 0){
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
         return false;
     }
-    if(--page->pin_count_ == 0){
-        replacer_->unpin(page_table_[page_id]);
+    if(is_dirty) {
+        set_dirty(page, frame_id, true);
     }
-    if(page->is_dirty_ == false) {
-        page->is_dirty_ = is_dirty;
+    if(--page->pin_count_ == 0){
+        release_frame(frame_id);
     }
     (pagelatch_+frame_id)->unlock();
-    // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
     return true;
 }
 
@@ -210,41 +304,38 @@ bool BufferPoolManager::flush_page(PageId page_id) {
     // 1.1 目标页P没有被page_table_记录 ，返回false
     // 2. 无论P是否为脏都将其写回磁盘。
     // 3. 更新P的is_dirty_
-    // std::cout << "flush_page: " << page_id.page_no << std::endl;
-    std::unique_lock<std::mutex> l(latch_);
-    if(!page_table_.count(page_id)){
+    PageTablePartition &part = get_partition(page_id);
+    std::unique_lock<std::mutex> l(part.latch_);
+    auto iter = part.table_.find(page_id);
+    if(iter == part.table_.end()){
         // Not found page in page table
         return false;
     }
-    int frame_id = page_table_[page_id];
+    frame_id_t frame_id = iter->second;
     Page* page = pages_ + frame_id;
-    // while(true){
-    //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-    //     if( is_latch == false) break;
-    //     // else std::cout << "hcy" ;
-    // }
     (pagelatch_+frame_id)->lock();
     if( !(page->get_page_id() == page_id) ){
         // 不等于page_id, 首先将这个页从页表删除(延迟删除)
-        page_table_.erase(page_id);
+        part.table_.erase(iter);
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
         return false;
     }
     l.unlock();
+    if(io_pending_[frame_id]){
+        // 预读尚未完成, 磁盘上的就是最新数据
+        (pagelatch_+frame_id)->unlock();
+        return true;
+    }
     // for logging
-    auto lsn = page->get_page_lsn();
-    log_manager_->ForceFlush(lsn);
+    if(log_manager_ != nullptr) {
+        auto lsn = page->get_page_lsn();
+        log_manager_->ForceFlush(lsn);
+    }
 
     disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
     
-    page->is_dirty_ = false;
+    set_dirty(page, frame_id, false);
     (pagelatch_+frame_id)->unlock();
-    // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
-    // free_list_.push_back(page_table_[page_id]);
-    // page_table_.erase(page->get_page_id());
-    // page->pin_count_ = 0;
-    // page->reset_memory();
     return true;
 }
 
@@ -260,41 +351,35 @@ Page* BufferPoolManager::new_page(PageId* page_id) {
     // 4.   固定frame，更新pin_count_
     // 5.   返回获得的page
 
-    // 分配一个可用的frame
-    int frame_id;
-    std::unique_lock<std::mutex> l(latch_);
+    // 先在不持有任何latch的情况下挑选可用的frame, 失败时不会在磁盘上白白分配page_no
+    frame_id_t frame_id;
     if(find_victim_page(&frame_id) == false) return nullptr;
 
     // 在磁盘上分配一个新的fd中的page_id
     page_id->page_no = disk_manager_->allocate_page(page_id->fd);
 
-    // 对帧上锁, cas操作，0 -> 1
-    // while(true){
-    //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-    //     if( is_latch == false) break;
-    //     // else std::cout << "hcy" ;
-    // }
+    // 分区latch -> 帧latch, 上锁后若该帧已被其他线程pin住或已退役则重新挑选
+    PageTablePartition &part = get_partition(*page_id);
+    std::unique_lock<std::mutex> l(part.latch_);
     (pagelatch_+frame_id)->lock();
+    if(!is_usable_frame(frame_id)) {
+        (pagelatch_+frame_id)->unlock();
+        if(lock_victim_frame(&frame_id) == false) return nullptr;
+    } else {
+        replacer_->pin(frame_id);
+    }
 
-    page_table_[*page_id] = frame_id;
-    replacer_->pin(frame_id);
+    part.table_[*page_id] = frame_id;
     l.unlock();
 
-    // std::cout << "new page :" << page_id->page_no << std::endl;
-
     update_page(pages_ + frame_id, *page_id, frame_id);
-    // flush_page(*page_id);
 
     // 写回磁盘
-    // for logging
-    auto lsn = (pages_ + frame_id)->get_page_lsn();
-    log_manager_->ForceFlush(lsn);
     disk_manager_->write_page(page_id->fd, page_id->page_no, (pages_ + frame_id)->data_, PAGE_SIZE);
 
     (pages_ + frame_id)->pin_count_ = 1;
 
     (pagelatch_+frame_id)->unlock();
-    // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
     
     return pages_ + frame_id;
 }
@@ -308,72 +393,770 @@ bool BufferPoolManager::delete_page(PageId page_id) {
     // 1.   在page_table_中查找目标页，若不存在返回true
     // 2.   若目标页的pin_count不为0，则返回false
     // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_，返回true
-    // std::cout << "delete page :" << page_id.page_no << std::endl;
-    std::unique_lock<std::mutex> l(latch_);
     disk_manager_->deallocate_page(page_id.page_no);
-    if(!page_table_.count(page_id)){
+    PageTablePartition &part = get_partition(page_id);
+    std::unique_lock<std::mutex> l(part.latch_);
+    auto iter = part.table_.find(page_id);
+    if(iter == part.table_.end()){
         // Not found page in page table
         return true;
     }
-    frame_id_t frame_id = page_table_[page_id];
+    frame_id_t frame_id = iter->second;
     Page* page = pages_ + frame_id;
-    // while(true){
-    //     bool is_latch = __sync_val_compare_and_swap(frame_latch_ + frame_id, false, true);
-    //     if( is_latch == false) break;
-    //     // else std::cout << "hcy" ;
-    // }
     (pagelatch_+frame_id)->lock();
     if( !(page->get_page_id() == page_id) ){
         // 不等于page_id, 首先将这个页从页表删除(延迟删除)
-        page_table_.erase(page_id);
+        part.table_.erase(iter);
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
         return true;
     }
 
     if(page->pin_count_ != 0){
         (pagelatch_+frame_id)->unlock();
-        // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
         return false;
     }
-    // disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
 
-    page_table_.erase(page->get_page_id());
-    free_list_.push_back(frame_id);
+    part.table_.erase(iter);
     l.unlock();
+    // 帧即将进入free_list_, 先从replacer中移除, 避免同一帧被free_list_和replacer各分配一次
+    replacer_->remove(frame_id);
 
-    page->id_ = {-1 , INVALID_PAGE_ID };
-    page->is_dirty_ = false;
+    set_dirty(page, frame_id, false);
+    set_page_id(page, frame_id, {-1 , INVALID_PAGE_ID });
     page->pin_count_ = 0;
     page->reset_memory();
+    if(static_cast<size_t>(frame_id) < pool_size_) {
+        // 退役帧不进入free_list_, 扩容时由resize放回
+        std::lock_guard<std::mutex> free_guard(free_latch_);
+        free_list_.push_back(frame_id);
+    }
     (pagelatch_+frame_id)->unlock();
-    // assert(true == __sync_val_compare_and_swap(frame_latch_ + frame_id, true, false));
     return true;
 }
 
 /**
- * @description: 将buffer_pool中的所有页写回到磁盘
+ * @description: 将buffer_pool中fd的所有脏页写回到磁盘, 代价只与该文件的脏页数有关
  * @param {int} fd 文件句柄
  */
 void BufferPoolManager::flush_all_pages(int fd) {
-    // std::unique_lock<std::mutex> l(latch_);
-    // std::cout << "flush_all_page: " << fd << std::endl;
-    for (size_t i = 0; i < pool_size_; i++) {
-        // flush_page(pages_[i].get_page_id());
-        if(pages_[i].get_page_id().fd == fd){
-            flush_page(pages_[i].get_page_id());
+    // 先从脏页索引按page_no收集fd的脏页, 再每ASYNC_IO_QUEUE_DEPTH个一批上锁, 作为一个IOBatch写回
+    std::vector<std::pair<page_id_t, frame_id_t>> fd_pages;
+    {
+        FileFrameIndex &file = file_frames_[fd];
+        std::lock_guard<std::mutex> guard(file.latch_);
+        fd_pages.reserve(file.dirty_.size());
+        for (frame_id_t frame_id : file.dirty_) {
+            fd_pages.emplace_back(pages_[frame_id].get_page_id().page_no, frame_id);
+        }
+    }
+    std::sort(fd_pages.begin(), fd_pages.end());
+
+    std::vector<frame_id_t> chunk;
+    std::vector<frame_id_t> locked;
+    for (size_t i = 0; i < fd_pages.size(); i += ASYNC_IO_QUEUE_DEPTH) {
+        chunk.clear();
+        for (size_t j = i; j < fd_pages.size() && j < i + ASYNC_IO_QUEUE_DEPTH; j++) {
+            chunk.push_back(fd_pages[j].second);
+        }
+        // 同时持有多个帧latch时按帧号从小到大加锁, 避免与其他批量写回的线程死锁
+        std::sort(chunk.begin(), chunk.end());
+        locked.clear();
+        lsn_t max_lsn = INVALID_LSN;
+        for (frame_id_t frame_id : chunk) {
+            (pagelatch_ + frame_id)->lock();
+            if (pages_[frame_id].get_page_id().fd != fd || !pages_[frame_id].is_dirty_ || io_pending_[frame_id]) {
+                // 收集之后该帧已换成其他文件的页或已被写回
+                (pagelatch_ + frame_id)->unlock();
+                continue;
+            }
+            max_lsn = std::max(max_lsn, pages_[frame_id].get_page_lsn());
+            locked.push_back(frame_id);
+        }
+        // for logging
+        if (log_manager_ != nullptr && !locked.empty()) {
+            log_manager_->ForceFlush(max_lsn);
         }
+        write_back_frames(locked);
     }
 }
 
 /**
- * @description: 将buffer_pool中的所有的fd页删除
+ * @description: 将buffer_pool中的所有的fd页删除, 代价只与该文件在缓冲池中的页面数有关
  * @param {int} fd 文件句柄
  */
 void BufferPoolManager::del_all_pages(int fd){
-    for (size_t i = 0; i < pool_size_; i++) {
-        if(pages_[i].get_page_id().fd == fd){
-            delete_page(pages_[i].get_page_id());
+    // 预读线程pin住的页面无法删除, 先等待该文件上的预读结束
+    cancel_prefetch(fd);
+    std::vector<PageId> page_ids;
+    {
+        FileFrameIndex &file = file_frames_[fd];
+        std::lock_guard<std::mutex> guard(file.latch_);
+        page_ids.reserve(file.resident_.size());
+        for (frame_id_t frame_id : file.resident_) {
+            page_ids.push_back(pages_[frame_id].get_page_id());
+        }
+    }
+    for (auto &page_id : page_ids) {
+        delete_page(page_id);
+    }
+}
+
+/**
+ * @description: 获取自上次reset_stats以来fetch_page的命中与未命中次数
+ * @param {size_t*} hits 命中次数
+ * @param {size_t*} misses 未命中次数
+ */
+void BufferPoolManager::get_stats(size_t *hits, size_t *misses) {
+    *hits = 0;
+    *misses = 0;
+    for (int i = 0; i < PAGE_TABLE_PARTITIONS; i++) {
+        std::lock_guard<std::mutex> guard(page_table_[i].latch_);
+        *hits += page_table_[i].hits_;
+        *misses += page_table_[i].misses_;
+    }
+}
+
+/**
+ * @description: 统计自上次reset_stats以来fetch_page的命中率
+ * @return {double} 命中次数/(命中次数+未命中次数), 没有fetch时返回0
+ */
+double BufferPoolManager::get_hit_ratio() {
+    size_t hits, misses;
+    get_stats(&hits, &misses);
+    return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+}
+
+/**
+ * @description: 清零命中率统计
+ */
+void BufferPoolManager::reset_stats() {
+    for (int i = 0; i < PAGE_TABLE_PARTITIONS; i++) {
+        std::lock_guard<std::mutex> guard(page_table_[i].latch_);
+        page_table_[i].hits_ = 0;
+        page_table_[i].misses_ = 0;
+    }
+}
+
+/**
+ * @description: 启动后台写线程, 每隔PAGE_CLEANER_INTERVAL或被前台淘汰脏页唤醒时执行一轮clean_victim_frames
+ */
+void BufferPoolManager::run_page_cleaner() {
+    cleaner_thread_ = new std::thread([this] {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> l(cleaner_latch_);
+                if (cleaner_stop_) {
+                    break;
+                }
+                cleaner_cv_.wait_for(l, PAGE_CLEANER_INTERVAL);
+                if (cleaner_stop_) {
+                    break;
+                }
+            }
+            try {
+                clean_victim_frames();
+            } catch (std::exception &) {
+                // 写回失败的页面仍是脏页, 下一轮重试, 淘汰时也会由fetch_page同步写回
+            }
+        }
+    });
+}
+
+/**
+ * @description: 将replacer中即将被淘汰的clean_target_个帧里的脏页写回磁盘, 按(fd, page_no)顺序写
+ *              只写pin_count_为0的页, 并遵守WAL: 页面LSN大于LogManager已持久化的LSN时跳过, 留给下一轮
+ * @return {size_t} 本轮写回的页面数量
+ */
+size_t BufferPoolManager::clean_victim_frames() {
+    // free_list_中的帧会先于replacer中的帧被使用, 它们也算作干净帧
+    size_t free_frames;
+    {
+        std::lock_guard<std::mutex> free_guard(free_latch_);
+        free_frames = free_list_.size();
+    }
+    if (free_frames >= clean_target_) {
+        return 0;
+    }
+    std::vector<frame_id_t> candidates;
+    replacer_->peek_victims(clean_target_ - free_frames, &candidates);
+
+    // 收集脏页; 帧latch被前台线程持有时跳过, 不与前台争抢
+    std::vector<std::pair<PageId, frame_id_t>> dirty_pages;
+    for (frame_id_t frame_id : candidates) {
+        if (!(pagelatch_ + frame_id)->try_lock()) {
+            continue;
+        }
+        Page *page = pages_ + frame_id;
+        if (page->pin_count_ == 0 && page->is_dirty_) {
+            dirty_pages.emplace_back(page->get_page_id(), frame_id);
+        }
+        (pagelatch_ + frame_id)->unlock();
+    }
+    std::sort(dirty_pages.begin(), dirty_pages.end(),
+              [](const auto &a, const auto &b) { return a.first.Get() < b.first.Get(); });
+
+    lsn_t persist_lsn = log_manager_ != nullptr ? log_manager_->get_persist_lsn() : INVALID_LSN;
+    size_t written = 0;
+    std::vector<frame_id_t> locked;
+    for (size_t i = 0; i < dirty_pages.size();) {
+        // 每次最多锁住ASYNC_IO_QUEUE_DEPTH个帧, 作为一个批次提交
+        locked.clear();
+        for (; i < dirty_pages.size() && locked.size() < ASYNC_IO_QUEUE_DEPTH; i++) {
+            auto &[page_id, frame_id] = dirty_pages[i];
+            if (!(pagelatch_ + frame_id)->try_lock()) {
+                continue;
+            }
+            Page *page = pages_ + frame_id;
+            // 收集之后该帧可能已被淘汰、重新pin住或被其他线程写回
+            if (!(page->get_page_id() == page_id) || page->pin_count_ != 0 || !page->is_dirty_ ||
+                (log_manager_ != nullptr && page->get_page_lsn() > persist_lsn)) {
+                (pagelatch_ + frame_id)->unlock();
+                continue;
+            }
+            locked.push_back(frame_id);
+        }
+        written += locked.size();
+        write_back_frames(locked);
+    }
+    return written;
+}
+
+/**
+ * @description: 把一组已持有帧latch的页面作为一个IOBatch写回磁盘, 写完后清除脏标记并释放这些帧latch
+ *              按(fd, page_no)排序后, 每段页号连续的页面合并为一个向量写请求
+ *              调用者需保证这些页面的日志已经持久化
+ * @param {vector<frame_id_t>&} frame_ids 已上锁的帧
+ */
+void BufferPoolManager::write_back_frames(const std::vector<frame_id_t> &frame_ids) {
+    std::vector<frame_id_t> sorted = frame_ids;
+    std::sort(sorted.begin(), sorted.end(), [this](frame_id_t a, frame_id_t b) {
+        return pages_[a].get_page_id().Get() < pages_[b].get_page_id().Get();
+    });
+    IOBatch batch;
+    for (size_t i = 0; i < sorted.size();) {
+        PageId first = pages_[sorted[i]].get_page_id();
+        std::vector<struct iovec> iovs;
+        size_t j = i;
+        for (; j < sorted.size() && iovs.size() < IOV_MAX; j++) {
+            PageId page_id = pages_[sorted[j]].get_page_id();
+            if (page_id.fd != first.fd || page_id.page_no != first.page_no + static_cast<int>(j - i)) {
+                break;
+            }
+            iovs.push_back({pages_[sorted[j]].data_, PAGE_SIZE});
+        }
+        batch.add_writev(first.fd, first.page_no, std::move(iovs));
+        i = j;
+    }
+    bool ok = true;
+    try {
+        disk_manager_->submit_io(&batch);
+        batch.wait();
+    } catch (RMDBError &) {
+        // 提交出错时已交给内核的请求仍在写这些帧, 等它们完成后才能释放帧latch
+        batch.drain();
+        ok = false;
+    }
+    for (frame_id_t frame_id : frame_ids) {
+        if (ok) {
+            set_dirty(pages_ + frame_id, frame_id, false);
+        }
+        (pagelatch_ + frame_id)->unlock();
+    }
+    if (!ok) {
+        throw InternalError("BufferPoolManager::write_back_frames Error");
+    }
+}
+
+/**
+ * @description: 启动预读线程, 依次处理prefetch_pages提交的预读请求
+ */
+void BufferPoolManager::run_prefetcher() {
+    prefetch_thread_ = new std::thread([this] {
+        std::unique_lock<std::mutex> l(prefetch_latch_);
+        while (true) {
+            prefetch_cv_.wait(l, [this] { return prefetch_stop_ || !prefetch_queue_.empty() || !warm_queue_.empty(); });
+            if (prefetch_stop_) {
+                break;
+            }
+            // 顺序扫描的预读优先于重启后的预热
+            auto &queue = prefetch_queue_.empty() ? warm_queue_ : prefetch_queue_;
+            PrefetchRequest request = std::move(queue.front());
+            queue.pop_front();
+            prefetching_fd_ = request.fd;
+            l.unlock();
+            try {
+                if (request.page_nos.empty()) {
+                    read_ahead(request.fd, request.start_page_no, request.num_pages);
+                } else {
+                    read_pages(request.fd, request.page_nos, true);
+                }
+            } catch (std::exception &) {
+                // 预读只是优化, 出错时交由之后的fetch_page按未命中处理
+            }
+            l.lock();
+            prefetching_fd_ = -1;
+            prefetch_cv_.notify_all();
+        }
+    });
+}
+
+/**
+ * @description: 异步预读fd中从start_page_no开始的num_pages个页面, 不等待读入完成
+ *              预读请求队列已满时直接丢弃该请求
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} start_page_no 第一个要预读的页面
+ * @param {int} num_pages 预读的页面数量
+ */
+void BufferPoolManager::prefetch_pages(int fd, page_id_t start_page_no, int num_pages) {
+    {
+        std::lock_guard<std::mutex> guard(prefetch_latch_);
+        if (prefetch_queue_.size() >= PREFETCH_QUEUE_LIMIT) {
+            return;
+        }
+        prefetch_queue_.push_back({fd, start_page_no, num_pages});
+    }
+    prefetch_cv_.notify_all();
+}
+
+/**
+ * @description: 丢弃fd上尚未开始的预读与预热请求, 并等待正在进行的fd上的预读结束
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::cancel_prefetch(int fd) {
+    std::unique_lock<std::mutex> l(prefetch_latch_);
+    for (auto *queue : {&prefetch_queue_, &warm_queue_}) {
+        for (auto it = queue->begin(); it != queue->end();) {
+            it = it->fd == fd ? queue->erase(it) : it + 1;
+        }
+    }
+    prefetch_cv_.wait(l, [&] { return prefetching_fd_ != fd; });
+}
+
+/**
+ * @description: 等待预读线程把帧frame_id的数据读入, 调用者需已pin住该帧
+ * @param {frame_id_t} frame_id 帧号
+ */
+void BufferPoolManager::wait_for_io(frame_id_t frame_id) {
+    std::unique_lock<std::mutex> l(io_latch_);
+    io_cv_.wait(l, [&] { return !io_pending_[frame_id]; });
+}
+
+/**
+ * @description: 同步执行一次预读: 读入fd中[start_page_no, start_page_no + num_pages)里不在缓冲池中的页面
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} start_page_no 第一个要预读的页面
+ * @param {int} num_pages 预读的页面数量
+ */
+void BufferPoolManager::read_ahead(int fd, page_id_t start_page_no, int num_pages) {
+    num_pages = std::min(num_pages, disk_manager_->get_fd2pageno(fd) - start_page_no);
+    if (num_pages <= 0) {
+        return;
+    }
+    std::vector<page_id_t> page_nos(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        page_nos[i] = start_page_no + i;
+    }
+    read_pages(fd, page_nos, false);
+}
+
+/**
+ * @description: 为page_nos中不在缓冲池中的页面分配帧, 每段连续的页面用一个大的读请求读入, 所有读请求作为一个批次提交,
+ *              再复制到各自的帧中
+ *              分配的帧在读入完成前保持pin住并标记io_pending_, 命中这些页面的fetch_page会等待读入完成
+ * @param {int} fd 文件句柄
+ * @param {vector<page_id_t>&} page_nos 要读入的页面, 按page_no从小到大排列
+ * @param {bool} free_frames_only 为true时只使用free_list_中的帧, 不淘汰缓冲池中已有的页面
+ */
+void BufferPoolManager::read_pages(int fd, const std::vector<page_id_t> &page_nos, bool free_frames_only) {
+    page_id_t num_file_pages = disk_manager_->get_fd2pageno(fd);
+
+    // 1. 逐页按 分区latch -> 帧latch 的顺序分配帧并更新页表, 同一时刻只持有一个帧latch
+    std::vector<std::pair<page_id_t, frame_id_t>> reserved;
+    for (page_id_t page_no : page_nos) {
+        if (page_no >= num_file_pages) {
+            break;
+        }
+        PageId page_id = {fd, page_no};
+        PageTablePartition &part = get_partition(page_id);
+        std::unique_lock<std::mutex> l(part.latch_);
+        auto iter = part.table_.find(page_id);
+        if (iter != part.table_.end()) {
+            std::lock_guard<std::mutex> frame_guard(pagelatch_[iter->second]);
+            if (pages_[iter->second].get_page_id() == page_id) {
+                // 已在缓冲池中
+                continue;
+            }
+            part.table_.erase(iter);
+        }
+        frame_id_t frame_id;
+        if (!(free_frames_only ? lock_free_frame(&frame_id) : lock_victim_frame(&frame_id))) {
+            // 没有可用的帧了, 不再继续预读
+            break;
+        }
+        Page *page = pages_ + frame_id;
+        part.table_[page_id] = frame_id;
+        l.unlock();
+        update_page(page, page_id, frame_id);
+        page->pin_count_ = 1;
+        io_pending_[frame_id] = true;
+        (pagelatch_ + frame_id)->unlock();
+        reserved.emplace_back(page_no, frame_id);
+    }
+    if (reserved.empty()) {
+        return;
+    }
+
+    // 2. 每段连续的页面读到暂存区的对应位置, 所有段作为一个批次提交; 暂存区按O_DIRECT的要求对齐
+    std::unique_ptr<char, decltype(&free)> staging(
+        static_cast<char *>(aligned_alloc(DIRECT_IO_ALIGNMENT, reserved.size() * PAGE_SIZE)), &free);
+    IOBatch batch;
+    for (size_t i = 0; i < reserved.size();) {
+        size_t j = i + 1;
+        while (j < reserved.size() && reserved[j].first == reserved[j - 1].first + 1) {
+            j++;
+        }
+        batch.add_read(fd, reserved[i].first, staging.get() + i * PAGE_SIZE, (j - i) * PAGE_SIZE);
+        i = j;
+    }
+    bool batch_ok = true;
+    try {
+        disk_manager_->submit_io(&batch);
+        batch.wait();
+    } catch (RMDBError &) {
+        // 等已经交给内核的请求完成后再释放暂存区, 之后逐页重读
+        batch.drain();
+        batch_ok = false;
+        read_fallbacks_++;
+    }
+
+    // 3. 复制数据并释放帧; 批量读失败时逐页重读, 仍失败的页面从页表中移除并把帧的页号置为无效,
+    //    等待这些页面的fetch_page据此发现读入失败, 各自撤销pin, 由最后一个撤销pin的线程归还帧
+    for (size_t i = 0; i < reserved.size(); i++) {
+        auto [page_no, frame_id] = reserved[i];
+        Page *page = pages_ + frame_id;
+        bool page_ok = true;
+        if (batch_ok) {
+            memcpy(page->data_, staging.get() + i * PAGE_SIZE, PAGE_SIZE);
+        } else {
+            try {
+                disk_manager_->read_page(fd, page_no, page->data_, PAGE_SIZE);
+            } catch (InternalError &) {
+                page_ok = false;
+            }
+        }
+        PageId page_id = {fd, page_no};
+        PageTablePartition &part = get_partition(page_id);
+        std::unique_lock<std::mutex> l(part.latch_, std::defer_lock);
+        if (!page_ok) {
+            l.lock();
+            auto iter = part.table_.find(page_id);
+            if (iter != part.table_.end() && iter->second == frame_id) {
+                part.table_.erase(iter);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> frame_guard(pagelatch_[frame_id]);
+            if (!page_ok) {
+                set_page_id(page, frame_id, {-1, INVALID_PAGE_ID});
+                page->reset_memory();
+            }
+            io_pending_[frame_id] = false;
+            if (--page->pin_count_ == 0) {
+                release_frame(frame_id);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> io_guard(io_latch_);
+        }
+        io_cv_.notify_all();
+    }
+}
+
+/**
+ * @description: 帧的pin_count_降为0时调用: 正常的帧放回replacer, 退役帧(缩容时仍被pin住)在此时淘汰并归还内存
+ *              调用者需持有该帧的latch
+ * @param {frame_id_t} frame_id 帧号
+ */
+void BufferPoolManager::release_frame(frame_id_t frame_id) {
+    if (static_cast<size_t>(frame_id) < pool_size_) {
+        replacer_->unpin(frame_id);
+        return;
+    }
+    retire_frame(frame_id);
+    arena_->release(frame_id, 1);
+}
+
+/**
+ * @description: 淘汰退役帧中的页面, 脏页先写回磁盘; 之后该帧不在free_list_与replacer中, 直到扩容时被放回
+ *              调用者需持有该帧的latch, 且该帧未被pin住
+ * @param {frame_id_t} frame_id 帧号
+ */
+void BufferPoolManager::retire_frame(frame_id_t frame_id) {
+    Page *page = pages_ + frame_id;
+    replacer_->remove(frame_id);
+    if (page->is_dirty_) {
+        // for logging
+        if (log_manager_ != nullptr) {
+            log_manager_->ForceFlush(page->get_page_lsn());
+        }
+        disk_manager_->write_page(page->get_page_id().fd, page->get_page_id().page_no, page->data_, PAGE_SIZE);
+        set_dirty(page, frame_id, false);
+    }
+    // 页表中的映射采用延迟删除
+    set_page_id(page, frame_id, {-1, INVALID_PAGE_ID});
+}
+
+/**
+ * @description: 在线调整缓冲池的帧数, 每次增减一个BUFFER_POOL_CHUNK_SIZE对齐的块
+ *              扩容时新增的帧进入free_list_; 缩容时淘汰末尾帧中的页面(脏页先写回)并归还其内存,
+ *              仍被pin住的帧在最后一次unpin时淘汰
+ *              new_pool_size为0或超过max_pool_size_时, throw InternalError
+ * @param {size_t} new_pool_size 新的帧数
+ */
+void BufferPoolManager::resize(size_t new_pool_size) {
+    if (new_pool_size == 0 || new_pool_size > max_pool_size_) {
+        throw InternalError("BufferPoolManager::resize: pool size should be in [1, " + std::to_string(max_pool_size_) + "]");
+    }
+    std::lock_guard<std::mutex> guard(resize_latch_);
+    if (new_pool_size > pool_size_) {
+        grow(new_pool_size);
+    } else {
+        shrink(new_pool_size);
+    }
+    clean_target_ = static_cast<size_t>(new_pool_size * PAGE_CLEANER_CLEAN_RATIO);
+    if (cleaner_thread_ == nullptr && clean_target_ > 0) {
+        run_page_cleaner();
+    }
+}
+
+/**
+ * @description: 逐块把帧数增加到new_pool_size, 调用者需持有resize_latch_
+ * @param {size_t} new_pool_size 新的帧数
+ */
+void BufferPoolManager::grow(size_t new_pool_size) {
+    while (pool_size_ < new_pool_size) {
+        size_t lo = pool_size_;
+        size_t hi = std::min(new_pool_size, (lo / BUFFER_POOL_CHUNK_SIZE + 1) * BUFFER_POOL_CHUNK_SIZE);
+        if (hi > constructed_frames_) {
+            construct_array(pages_, constructed_frames_, hi);
+            construct_array(pagelatch_, constructed_frames_, hi);
+            construct_array(io_pending_, constructed_frames_, hi);
+            for (size_t i = constructed_frames_; i < hi; ++i) {
+                pages_[i].data_ = arena_->page_data(i);
+            }
+            constructed_frames_ = hi;
+        }
+        replacer_->resize(hi);
+        // 先提高pool_size_, 之后仍被pin住的退役帧unpin时回到replacer, 不再被淘汰
+        pool_size_ = hi;
+        std::vector<frame_id_t> free_frames;
+        for (size_t i = lo; i < hi; ++i) {
+            std::lock_guard<std::mutex> frame_guard(pagelatch_[i]);
+            Page *page = pages_ + i;
+            if (page->pin_count_ != 0) {
+                continue;
+            }
+            if (page->get_page_id().page_no == INVALID_PAGE_ID) {
+                free_frames.push_back(static_cast<frame_id_t>(i));
+            } else {
+                // 上次缩容写回失败而留下的页面
+                replacer_->unpin(static_cast<frame_id_t>(i));
+            }
+        }
+        std::lock_guard<std::mutex> free_guard(free_latch_);
+        free_list_.insert(free_list_.end(), free_frames.begin(), free_frames.end());
+    }
+}
+
+/**
+ * @description: 逐块把帧数减少到new_pool_size, 调用者需持有resize_latch_
+ * @param {size_t} new_pool_size 新的帧数
+ */
+void BufferPoolManager::shrink(size_t new_pool_size) {
+    while (pool_size_ > new_pool_size) {
+        size_t hi = pool_size_;
+        size_t lo = std::max(new_pool_size, (hi - 1) / BUFFER_POOL_CHUNK_SIZE * BUFFER_POOL_CHUNK_SIZE);
+        // 1. 先降低pool_size_, 之后[lo, hi)中的帧不会再被用来存放新页面
+        pool_size_ = lo;
+        {
+            std::lock_guard<std::mutex> free_guard(free_latch_);
+            free_list_.remove_if([lo](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= lo; });
+        }
+        // 2. 淘汰未被pin住的页面, 按连续的段归还内存; 被pin住的帧留给release_frame
+        size_t run_start = lo;
+        for (size_t i = lo; i < hi; ++i) {
+            std::lock_guard<std::mutex> frame_guard(pagelatch_[i]);
+            if (pages_[i].pin_count_ == 0) {
+                retire_frame(static_cast<frame_id_t>(i));
+                continue;
+            }
+            arena_->release(run_start, i - run_start);
+            run_start = i + 1;
+        }
+        arena_->release(run_start, hi - run_start);
+        replacer_->resize(lo);
+    }
+}
+
+/**
+ * @description: 按热度从高到低收集缓冲池中的页面: 被pin住的页面最热, 其余按replacer淘汰顺序的逆序排列
+ * @param {vector<PageId>*} page_ids 收集到的页面
+ */
+void BufferPoolManager::get_hot_pages(std::vector<PageId> *page_ids) {
+    size_t num_frames = pool_size_;
+    std::vector<frame_id_t> victims;
+    replacer_->peek_victims(num_frames, &victims);
+    std::vector<bool> evictable(num_frames, false);
+    for (frame_id_t frame_id : victims) {
+        if (static_cast<size_t>(frame_id) < num_frames) {
+            evictable[frame_id] = true;
+        }
+    }
+    auto collect = [&](frame_id_t frame_id) {
+        std::lock_guard<std::mutex> frame_guard(pagelatch_[frame_id]);
+        PageId page_id = pages_[frame_id].get_page_id();
+        if (page_id.page_no != INVALID_PAGE_ID && !io_pending_[frame_id]) {
+            page_ids->push_back(page_id);
+        }
+    };
+    for (size_t i = 0; i < num_frames; i++) {
+        if (!evictable[i]) {
+            collect(static_cast<frame_id_t>(i));
+        }
+    }
+    for (auto it = victims.rbegin(); it != victims.rend(); ++it) {
+        if (static_cast<size_t>(*it) < num_frames) {
+            collect(*it);
+        }
+    }
+}
+
+/**
+ * @description: 在后台把一组页面读入缓冲池, 不等待读入完成
+ *              只使用空闲帧, 不会淘汰其他页面; 空闲帧不够时只读入最靠前的页面
+ *              每个文件的页面按page_no排序后每WARM_UP_BATCH_PAGES个作为一个预热请求, 其中连续的页面合并成一次读
+ * @param {vector<PageId>&} page_ids 要读入的页面, 按热度从高到低排列
+ */
+void BufferPoolManager::warm_up(const std::vector<PageId> &page_ids) {
+    size_t free_frames;
+    {
+        std::lock_guard<std::mutex> free_guard(free_latch_);
+        free_frames = free_list_.size();
+    }
+    std::vector<PageId> hottest(page_ids.begin(), page_ids.begin() + std::min(page_ids.size(), free_frames));
+    std::sort(hottest.begin(), hottest.end(), [](const PageId &a, const PageId &b) { return a.Get() < b.Get(); });
+
+    std::vector<PrefetchRequest> requests;
+    for (size_t i = 0; i < hottest.size(); i++) {
+        if (requests.empty() || requests.back().fd != hottest[i].fd ||
+            requests.back().page_nos.size() >= WARM_UP_BATCH_PAGES) {
+            requests.push_back({hottest[i].fd, hottest[i].page_no, 0, {}});
         }
+        requests.back().page_nos.push_back(hottest[i].page_no);
+        requests.back().num_pages++;
     }
-}
\ No newline at end of file
+    {
+        std::lock_guard<std::mutex> guard(prefetch_latch_);
+        for (auto &request : requests) {
+            warm_queue_.push_back(std::move(request));
+        }
+    }
+    prefetch_cv_.notify_all();
+}
+
+/**
+ * @description: 把按热度排列的页面列表写入文件, 每行为"文件名 page_no"
+ *              先写临时文件再重命名, 保存过程中崩溃不会破坏上一次保存的列表
+ * @param {string&} path 保存的文件路径
+ */
+void BufferPoolManager::save_hot_pages(const std::string &path) {
+    std::vector<PageId> page_ids;
+    get_hot_pages(&page_ids);
+    std::unordered_map<int, std::string> file_names;
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream ofs(tmp_path);
+        for (auto &page_id : page_ids) {
+            auto iter = file_names.find(page_id.fd);
+            if (iter == file_names.end()) {
+                std::string file_name;
+                try {
+                    file_name = disk_manager_->get_file_name(page_id.fd);
+                } catch (FileNotOpenError &) {
+                    // 文件在收集之后已被关闭
+                }
+                iter = file_names.emplace(page_id.fd, file_name).first;
+            }
+            if (!iter->second.empty()) {
+                ofs << iter->second << ' ' << page_id.page_no << '\n';
+            }
+        }
+        if (!ofs) {
+            throw InternalError("BufferPoolManager::save_hot_pages Error");
+        }
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw UnixError();
+    }
+}
+
+/**
+ * @description: 读取save_hot_pages保存的页面列表并在后台预热, 文件不存在或其中的文件未打开时忽略
+ * @param {string&} path 页面列表的文件路径
+ */
+void BufferPoolManager::load_hot_pages(const std::string &path) {
+    std::ifstream ifs(path);
+    std::unordered_map<std::string, int> file_fds;
+    std::vector<PageId> page_ids;
+    std::string file_name;
+    page_id_t page_no;
+    while (ifs >> file_name >> page_no) {
+        auto iter = file_fds.find(file_name);
+        if (iter == file_fds.end()) {
+            iter = file_fds.emplace(file_name, disk_manager_->get_open_file_fd(file_name)).first;
+        }
+        if (iter->second >= 0) {
+            page_ids.push_back({iter->second, page_no});
+        }
+    }
+    warm_up(page_ids);
+}
+
+/**
+ * @description: 启动定期保存页面列表的线程, 每HOT_PAGES_DUMP_INTERVAL调用一次save_hot_pages
+ * @param {string&} path 保存的文件路径
+ */
+void BufferPoolManager::start_hot_pages_dumper(const std::string &path) {
+    stop_hot_pages_dumper();
+    dump_path_ = path;
+    dump_stop_ = false;
+    dump_thread_ = new std::thread([this] {
+        std::unique_lock<std::mutex> l(dump_latch_);
+        while (!dump_cv_.wait_for(l, HOT_PAGES_DUMP_INTERVAL, [this] { return dump_stop_; })) {
+            l.unlock();
+            try {
+                save_hot_pages(dump_path_);
+            } catch (std::exception &) {
+                // 保存失败时保留上一次的列表, 下一轮再试
+            }
+            l.lock();
+        }
+    });
+}
+
+/**
+ * @description: 停止定期保存页面列表的线程, 线程未启动时什么也不做
+ */
+void BufferPoolManager::stop_hot_pages_dumper() {
+    if (dump_thread_ == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(dump_latch_);
+        dump_stop_ = true;
+    }
+    dump_cv_.notify_all();
+    dump_thread_->join();
+    delete dump_thread_;
+    dump_thread_ = nullptr;
+}
@@ -12,59 +12,170 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "disk_manager.h"
 #include "errors.h"
 #include "page.h"
+#include "page_arena.h"
+#include "replacer/clock_replacer.h"
+#include "replacer/lru_k_replacer.h"
 #include "replacer/lru_replacer.h"
 #include "replacer/replacer.h"
 #include "recovery/log_manager.h"
 
+/**
+ * @description: 页表的一个分区, 每个分区持有独立的latch, 不同分区上的页面查找互不阻塞
+ */
+struct PageTablePartition {
+    std::mutex latch_;                                          // 保护本分区的table_
+    std::unordered_map<PageId, frame_id_t, PageIdHash> table_;  // 本分区内PageId到帧号的映射
+    size_t hits_ = 0;                                           // fetch_page命中次数, 受latch_保护
+    size_t misses_ = 0;                                         // fetch_page未命中次数, 受latch_保护
+};
+
+/**
+ * @description: 一个文件在缓冲池中的页面索引, 使按文件刷盘和删除的代价只与该文件的页面数有关
+ *              只在持有对应帧latch时修改, 其latch_为叶子锁
+ */
+struct FileFrameIndex {
+    std::mutex latch_;
+    std::unordered_set<frame_id_t> resident_;   // 存放该文件页面的帧
+    std::unordered_set<frame_id_t> dirty_;      // 其中存放脏页的帧
+};
+
 class BufferPoolManager {
    public:
-    size_t pool_size_;      // buffer_pool中可容纳页面的个数，即帧的个数
-    Page *pages_;           // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
+    std::atomic<size_t> pool_size_;     // buffer_pool中可容纳页面的个数，即帧的个数, 可由resize在线调整
+    size_t max_pool_size_;              // pool_size_的上限, 帧的元数据与页面数据都按这个容量预留地址空间
+    size_t constructed_frames_;         // 已构造元数据的帧数, 只增不减, 受resize_latch_保护
+    Page *pages_;           // buffer_pool中的Page对象数组，只含帧的元数据，按max_pool_size_预留空间，扩容时才构造新增的帧，在析构函数中释放
+    PageArena *arena_;      // 存放所有帧页面数据的连续内存, 第i帧的数据为arena_->page_data(i)
+    std::mutex resize_latch_;           // 串行化resize
+    PageTablePartition *page_table_;    // 按PageId哈希分成PAGE_TABLE_PARTITIONS个分区的页表，用于根据页面的PageId定位该页面的帧编号
     std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    std::mutex free_latch_; // 只保护free_list_
     DiskManager *disk_manager_;
-    Replacer *replacer_;    // buffer_pool的置换策略，当前赛题中为LRU置换策略
-    std::mutex latch_;      // 用于共享数据结构的并发控制
-    bool* frame_latch_;
+    Replacer *replacer_;    // buffer_pool的置换策略，LRU、LRUK或CLOCK，在构造时选择
     LogManager *log_manager_;
 
+    // 加锁顺序: 分区latch -> 帧latch, free_latch_与replacer内部的latch为叶子锁; 持有帧latch时不得再申请分区latch
+    // 缩容后下标不小于pool_size_的帧称为退役帧, 其元数据与latch不析构, 页表中指向它们的过期映射仍可安全检查
     std::mutex *pagelatch_;
 
+    FileFrameIndex *file_frames_;   // 按fd下标, 共DiskManager::MAX_FD个
+
+    // 后台写线程(page cleaner), 在淘汰端保持clean_target_个干净的帧, 使前台淘汰时不必同步写回脏页
+    std::atomic<size_t> clean_target_;
+    std::thread *cleaner_thread_ = nullptr;
+    std::atomic<bool> cleaner_stop_{false};
+    std::mutex cleaner_latch_;                  // 只配合cleaner_cv_使用
+    std::condition_variable cleaner_cv_;        // 前台淘汰到脏页时唤醒后台写线程
+
+    // 后台预读线程, 把顺序扫描即将访问的页面成段读入缓冲池, 空闲时处理重启后的预热请求
+    struct PrefetchRequest {
+        int fd;
+        page_id_t start_page_no;
+        int num_pages;
+        std::vector<page_id_t> page_nos;            // 预热请求要读入的页面, 按page_no排序; 预读请求为空
+    };
+    std::thread *prefetch_thread_ = nullptr;
+    bool prefetch_stop_ = false;
+    int prefetching_fd_ = -1;                       // 预读线程正在处理的文件, 空闲时为-1
+    std::deque<PrefetchRequest> prefetch_queue_;
+    std::deque<PrefetchRequest> warm_queue_;        // 预热请求, 优先级低于prefetch_queue_, 不受PREFETCH_QUEUE_LIMIT限制
+    std::mutex prefetch_latch_;                     // 保护以上四项
+    std::condition_variable prefetch_cv_;
+    std::atomic<bool> *io_pending_;                 // io_pending_[i]为true表示帧i已映射到页面, 但预读的数据尚未读入
+    std::mutex io_latch_;                           // 只配合io_cv_使用
+    std::condition_variable io_cv_;                 // 预读的页面读入完成时唤醒等待者
+    std::atomic<size_t> read_fallbacks_{0};         // read_pages批量读失败、退化为逐页读的次数
+
+    // 定期把按热度排列的页面列表保存到文件的线程, 由start_hot_pages_dumper启动
+    std::thread *dump_thread_ = nullptr;
+    std::string dump_path_;
+    bool dump_stop_ = false;
+    std::mutex dump_latch_;                         // 保护dump_stop_, 配合dump_cv_使用
+    std::condition_variable dump_cv_;
+
    public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr)
-        : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-        // 为buffer pool分配一块连续的内存空间
-        pages_ = new Page[pool_size_];
-        frame_latch_ = new bool[pool_size_];
-        for(size_t i=0; i<pool_size_; i++){
-            frame_latch_[i] = false;
-        }
-        pagelatch_ = new std::mutex[pool_size_];
+    /**
+     * @description: 创建BufferPoolManager
+     * @param {size_t} pool_size 帧的个数
+     * @param {string&} replacer_type 置换策略, "LRU"、"LRUK"或"CLOCK", 默认为REPLACER_TYPE
+     * @param {size_t} max_pool_size resize可以扩容到的最大帧数, 不大于pool_size时不能扩容
+     */
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                      const std::string &replacer_type = REPLACER_TYPE, size_t max_pool_size = 0)
+        : pool_size_(pool_size), max_pool_size_(std::max(pool_size, max_pool_size)), constructed_frames_(pool_size),
+          disk_manager_(disk_manager), log_manager_(log_manager) {
+        // 为buffer pool分配一块连续的内存空间, 页面数据与元数据分开存放, 都按max_pool_size_预留
+        arena_ = new PageArena(max_pool_size_);
+        pages_ = reserve_array<Page>(max_pool_size_);
+        pagelatch_ = reserve_array<std::mutex>(max_pool_size_);
+        io_pending_ = reserve_array<std::atomic<bool>>(max_pool_size_);
+        construct_array(pages_, 0, pool_size_);
+        construct_array(pagelatch_, 0, pool_size_);
+        construct_array(io_pending_, 0, pool_size_);
+        page_table_ = new PageTablePartition[PAGE_TABLE_PARTITIONS];
+        file_frames_ = new FileFrameIndex[DiskManager::MAX_FD];
 
         // 可以被Replacer改变
-        if (REPLACER_TYPE.compare("LRU"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE.compare("CLOCK"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else {
+        if (replacer_type == "CLOCK") {
+            replacer_ = new ClockReplacer(pool_size_, max_pool_size_);
+        } else if (replacer_type == "LRUK") {
+            replacer_ = new LRUKReplacer(pool_size_);
+        } else if (replacer_type == "LRU") {
             replacer_ = new LRUReplacer(pool_size_);
+        } else {
+            throw InternalError("Unknown replacer type: " + replacer_type);
         }
         // 初始化时，所有的page都在free_list_中
         for (size_t i = 0; i < pool_size_; ++i) {
             free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+            pages_[i].data_ = arena_->page_data(i);
+            io_pending_[i] = false;
+        }
+        run_prefetcher();
+        clean_target_ = static_cast<size_t>(pool_size * PAGE_CLEANER_CLEAN_RATIO);
+        if (clean_target_ > 0) {
+            run_page_cleaner();
         }
     }
 
     ~BufferPoolManager() {
-        delete[] pages_;
+        stop_hot_pages_dumper();
+        if (cleaner_thread_ != nullptr) {
+            {
+                std::lock_guard<std::mutex> guard(cleaner_latch_);
+                cleaner_stop_ = true;
+            }
+            cleaner_cv_.notify_one();
+            cleaner_thread_->join();
+            delete cleaner_thread_;
+        }
+        {
+            std::lock_guard<std::mutex> guard(prefetch_latch_);
+            prefetch_stop_ = true;
+        }
+        prefetch_cv_.notify_all();
+        prefetch_thread_->join();
+        delete prefetch_thread_;
+        destroy_array(pages_, constructed_frames_, max_pool_size_);
+        delete arena_;
+        destroy_array(io_pending_, constructed_frames_, max_pool_size_);
+        delete[] page_table_;
+        delete[] file_frames_;
+        destroy_array(pagelatch_, constructed_frames_, max_pool_size_);
         delete replacer_;
     }
 
@@ -89,8 +200,77 @@ class BufferPoolManager {
 
     void del_all_pages(int fd);
 
+    void get_stats(size_t *hits, size_t *misses);
+
+    double get_hit_ratio();
+
+    void reset_stats();
+
+    size_t clean_victim_frames();
+
+    void prefetch_pages(int fd, page_id_t start_page_no, int num_pages);
+
+    void read_ahead(int fd, page_id_t start_page_no, int num_pages);
+
+    void resize(size_t new_pool_size);
+
+    void get_hot_pages(std::vector<PageId> *page_ids);
+
+    void warm_up(const std::vector<PageId> &page_ids);
+
+    void save_hot_pages(const std::string &path);
+
+    void load_hot_pages(const std::string &path);
+
+    void start_hot_pages_dumper(const std::string &path);
+
+    void stop_hot_pages_dumper();
+
    private:
+    /**
+     * @description: 获取page_id所属的页表分区
+     * @param {PageId&} page_id 目标页
+     */
+    PageTablePartition &get_partition(const PageId &page_id) {
+        return page_table_[PageIdHash()(page_id) % PAGE_TABLE_PARTITIONS];
+    }
+
     bool find_victim_page(frame_id_t* frame_id);
 
+    void run_page_cleaner();
+
+    void write_back_frames(const std::vector<frame_id_t> &frame_ids);
+
+    void run_prefetcher();
+
+    void wait_for_io(frame_id_t frame_id);
+
+    void cancel_prefetch(int fd);
+
+    bool lock_victim_frame(frame_id_t* frame_id);
+
+    bool lock_free_frame(frame_id_t* frame_id);
+
+    void read_pages(int fd, const std::vector<page_id_t> &page_nos, bool free_frames_only);
+
     void update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id);
-};
\ No newline at end of file
+
+    void set_page_id(Page* page, frame_id_t frame_id, PageId new_page_id);
+
+    void set_dirty(Page* page, frame_id_t frame_id, bool is_dirty);
+
+    /**
+     * @description: 帧是否可以用来存放新页面: 未被pin住且没有退役; 调用者需持有该帧的latch
+     */
+    bool is_usable_frame(frame_id_t frame_id) {
+        return pages_[frame_id].pin_count_ == 0 && static_cast<size_t>(frame_id) < pool_size_;
+    }
+
+    void release_frame(frame_id_t frame_id);
+
+    void retire_frame(frame_id_t frame_id);
+
+    void grow(size_t new_pool_size);
+
+    void shrink(size_t new_pool_size);
+};
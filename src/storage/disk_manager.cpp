@@ -11,13 +11,22 @@ See the Mulan PSL v2 for more details. */
 #include "storage/disk_manager.h"
 
 #include <assert.h>    // for assert
+#include <errno.h>     // for errno
+#include <stdlib.h>    // for aligned_alloc, free
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
-#include <unistd.h>    // for lseek
+#include <unistd.h>    // for pread, pwrite
 
 #include "defs.h"
 
-DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char))); }
+// O_DIRECT要求缓冲区地址和读写长度都按DIRECT_IO_ALIGNMENT对齐, 缓冲池的帧总是满足这一点
+static bool is_direct_aligned(const void *buf, size_t num_bytes) {
+    return reinterpret_cast<uintptr_t>(buf) % DIRECT_IO_ALIGNMENT == 0 && num_bytes % DIRECT_IO_ALIGNMENT == 0;
+}
+
+DiskManager::DiskManager() : async_io_(AsyncIO::create()) {
+    memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char)));
+}
 
 /**
  * @description: 将数据写入文件的指定磁盘页面中
@@ -27,23 +36,17 @@ DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<
  * @param {int} num_bytes 要写入磁盘的数据大小
  */
 void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, size_t num_bytes) {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用write()函数
-    // 注意write返回值与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
-    
-    std::unique_lock<std::mutex> fdlatch(fdlatch_[fd]);
-
-    off_t result = lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    if (result == -1) {
-        // lseek 失败，抛出异常或处理错误
-        std::cerr << "lseek failed";
+    if (fd2direct_[fd] && !is_direct_aligned(offset, num_bytes)) {
+        write_page_unaligned(fd, page_no, offset, num_bytes);
+        return;
     }
-    // 写入数据
+    // 使用pwrite, 不移动共享的文件偏移, 同一个fd上的并发读写互不干扰
+    // 注意write返回值与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
     size_t bytes_written = 0;
+    off_t file_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
 
     while (bytes_written < num_bytes) {
-        ssize_t result = write(fd, offset + bytes_written, num_bytes - bytes_written);
+        ssize_t result = pwrite(fd, offset + bytes_written, num_bytes - bytes_written, file_offset + bytes_written);
 
         if (result == -1) {
             // 处理错误
@@ -69,20 +72,13 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, size
  * @param {int} num_bytes 读取的数据量大小
  */
 void DiskManager::read_page(int fd, page_id_t page_no, char *offset, size_t num_bytes) {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用read()函数
-    // 注意read返回值与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
-
-    std::unique_lock<std::mutex> fdlatch(fdlatch_[fd]);
-    
-    off_t result = lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    if (result == -1) {
-        // lseek 失败，抛出异常或处理错误
-        std::cerr << "lseek failed";
+    if (fd2direct_[fd] && !is_direct_aligned(offset, num_bytes)) {
+        read_page_unaligned(fd, page_no, offset, num_bytes);
+        return;
     }
-    // 读取数据
-    ssize_t bytes_read = read(fd, offset, num_bytes);
+    // 使用pread, 不移动共享的文件偏移
+    // 注意read返回值与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
+    ssize_t bytes_read = pread(fd, offset, num_bytes, static_cast<off_t>(page_no) * PAGE_SIZE);
     if (bytes_read == -1 || (size_t)bytes_read != num_bytes) {
         // 读取的字节数与期望的不一致，抛出异常或处理错误
         throw InternalError("DiskManager::read_page Error");
@@ -90,6 +86,48 @@ void DiskManager::read_page(int fd, page_id_t page_no, char *offset, size_t num_
     return;
 }
 
+/**
+ * @description: O_DIRECT文件上的未对齐写(如只写文件头), 经过对齐的中转缓冲区按整页写入
+ *              最后一个页面中不被覆盖的部分先从磁盘读出, 保持与普通文件上部分写相同的语义
+ */
+void DiskManager::write_page_unaligned(int fd, page_id_t page_no, const char *offset, size_t num_bytes) {
+    size_t aligned_bytes = (num_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    std::unique_ptr<char, decltype(&free)> buf(static_cast<char *>(aligned_alloc(DIRECT_IO_ALIGNMENT, aligned_bytes)), &free);
+    if (num_bytes % PAGE_SIZE != 0) {
+        char *tail = buf.get() + aligned_bytes - PAGE_SIZE;
+        off_t tail_offset = static_cast<off_t>(page_no) * PAGE_SIZE + aligned_bytes - PAGE_SIZE;
+        // 超出文件末尾的部分读不到, 补0
+        ssize_t bytes_read = pread(fd, tail, PAGE_SIZE, tail_offset);
+        if (bytes_read == -1) {
+            throw InternalError("DiskManager::write_page Error");
+        }
+        memset(tail + bytes_read, 0, PAGE_SIZE - bytes_read);
+    }
+    memcpy(buf.get(), offset, num_bytes);
+    write_page(fd, page_no, buf.get(), aligned_bytes);
+}
+
+/**
+ * @description: O_DIRECT文件上的未对齐读, 按整页读到对齐的中转缓冲区后再拷贝需要的部分
+ */
+void DiskManager::read_page_unaligned(int fd, page_id_t page_no, char *offset, size_t num_bytes) {
+    size_t aligned_bytes = (num_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    std::unique_ptr<char, decltype(&free)> buf(static_cast<char *>(aligned_alloc(DIRECT_IO_ALIGNMENT, aligned_bytes)), &free);
+    // 文件末尾的页面可能不完整, 只要读到的字节数不少于num_bytes即可
+    ssize_t bytes_read = pread(fd, buf.get(), aligned_bytes, static_cast<off_t>(page_no) * PAGE_SIZE);
+    if (bytes_read == -1 || (size_t)bytes_read < num_bytes) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    memcpy(offset, buf.get(), num_bytes);
+}
+
+/**
+ * @description: 异步提交一批页面读写请求, 调用者随后通过batch->wait()等待全部完成
+ *              批次中的请求可以跨越多个连续页面, 同一批次的请求之间没有顺序保证
+ * @param {IOBatch*} batch 要提交的请求批次, 完成前必须保持有效
+ */
+void DiskManager::submit_io(IOBatch *batch) { async_io_->submit(batch); }
+
 /**
  * @description: 分配一个新的页号
  * @return {page_id_t} 分配的新页号
@@ -187,8 +225,9 @@ void DiskManager::destroy_file(const std::string &path) {
  * @description: 打开指定路径文件 
  * @return {int} 返回打开的文件的文件句柄
  * @param {string} &path 文件所在路径
+ * @param {bool} allow_direct_io 开启O_DIRECT模式时该文件是否使用O_DIRECT, 日志文件按任意长度追加写, 不能使用
  */
-int DiskManager::open_file(const std::string &path) {
+int DiskManager::open_file(const std::string &path, bool allow_direct_io) {
     // Todo:
     // 调用open()函数，使用O_RDWR模式
     // 注意不能重复打开相同文件，并且需要更新文件打开列表
@@ -200,7 +239,13 @@ int DiskManager::open_file(const std::string &path) {
         // return iter->second;
         throw FileNotClosedError(path);
     }
-    int fd = open(path.c_str(), O_RDWR);
+    bool direct = direct_io_ && allow_direct_io;
+    int fd = open(path.c_str(), O_RDWR | (direct ? O_DIRECT : 0));
+    if (fd == -1 && direct && errno == EINVAL) {
+        // 文件系统不支持O_DIRECT(如tmpfs), 退化为经过页缓存的读写
+        direct = false;
+        fd = open(path.c_str(), O_RDWR);
+    }
     if (fd == -1) {
         // 处理文件打开失败的情况
         // std::cerr << "fail to open file" << std::endl;
@@ -208,6 +253,7 @@ int DiskManager::open_file(const std::string &path) {
     } else {
         path2fd_[path] = fd;
         fd2path_[fd] = path;
+        fd2direct_[fd] = direct;
     }
     return fd;
 }
@@ -232,6 +278,7 @@ void DiskManager::close_file(int fd) {
         std::string path = iter->second;
         fd2path_.erase(fd);
         path2fd_.erase(path);
+        fd2direct_[fd] = false;
         close(fd);
     }
     return;
@@ -255,10 +302,12 @@ int DiskManager::get_file_size(const std::string &file_name) {
  * @param {int} fd 文件句柄
  */
 std::string DiskManager::get_file_name(int fd) {
-    if (!fd2path_.count(fd)) {
+    std::unique_lock<std::mutex> l(latch_);
+    auto iter = fd2path_.find(fd);
+    if (iter == fd2path_.end()) {
         throw FileNotOpenError(fd);
     }
-    return fd2path_[fd];
+    return iter->second;
 }
 
 /**
@@ -273,6 +322,17 @@ int DiskManager::get_file_fd(const std::string &file_name) {
     return path2fd_[file_name];
 }
 
+/**
+ * @description:  获得已打开文件的文件句柄, 与get_file_fd不同, 文件未打开时不会打开它
+ * @return {int} 文件句柄, 文件未打开时返回-1
+ * @param {string} &file_name 文件名
+ */
+int DiskManager::get_open_file_fd(const std::string &file_name) {
+    std::unique_lock<std::mutex> l(latch_);
+    auto iter = path2fd_.find(file_name);
+    return iter == path2fd_.end() ? -1 : iter->second;
+}
+
 
 /**
  * @description:  读取日志文件内容
@@ -284,7 +344,7 @@ int DiskManager::get_file_fd(const std::string &file_name) {
 int DiskManager::read_log(char *log_data, int size, int offset) {
     // read log file from the previous end
     if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
+        log_fd_ = open_file(LOG_FILE_NAME, false);
     }
     int file_size = get_file_size(LOG_FILE_NAME);
     if (offset > file_size) {
@@ -307,7 +367,7 @@ int DiskManager::read_log(char *log_data, int size, int offset) {
  */
 void DiskManager::write_log(char *log_data, size_t size) {
     if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
+        log_fd_ = open_file(LOG_FILE_NAME, false);
     }
 
     // write from the file_end
@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/config.h"
 #include "errors.h"  
+#include "storage/async_io.h"
 
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
@@ -37,6 +38,19 @@ class DiskManager {
 
     void read_page(int fd, page_id_t page_no, char *offset, size_t num_bytes);
 
+    /**
+     * @description: 设置之后打开的表和索引文件是否使用O_DIRECT, 已经打开的文件不受影响
+     */
+    void set_direct_io(bool direct_io) { direct_io_ = direct_io; }
+
+    bool is_direct_io() const { return direct_io_; }
+
+    bool is_direct_io(int fd) const { return fd2direct_[fd]; }
+
+    void submit_io(IOBatch *batch);
+
+    const char *get_async_io_name() const { return async_io_->name(); }
+
     page_id_t allocate_page(int fd);
 
     void deallocate_page(page_id_t page_id);
@@ -55,7 +69,7 @@ class DiskManager {
 
     void destroy_file(const std::string &path);
 
-    int open_file(const std::string &path);
+    int open_file(const std::string &path, bool allow_direct_io = true);
 
     void close_file(int fd);
 
@@ -65,6 +79,8 @@ class DiskManager {
 
     int get_file_fd(const std::string &file_name);
 
+    int get_open_file_fd(const std::string &file_name);
+
     /*日志操作*/
     int read_log(char *log_data, int size, int offset);
 
@@ -91,6 +107,10 @@ class DiskManager {
     static constexpr int MAX_FD = 100;
 
    private:
+    void write_page_unaligned(int fd, page_id_t page_no, const char *offset, size_t num_bytes);
+
+    void read_page_unaligned(int fd, page_id_t page_no, char *offset, size_t num_bytes);
+
     // 文件打开列表，用于记录文件是否被打开
     std::mutex latch_; // 哈希表并发锁
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
@@ -98,5 +118,7 @@ class DiskManager {
 
     int log_fd_ = -1;                             // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 文件中已经分配的页面个数，初始值为0
-    std::mutex fdlatch_[MAX_FD];
+    bool direct_io_ = DATA_FILE_DIRECT_IO;        // 之后打开的表和索引文件是否使用O_DIRECT
+    bool fd2direct_[MAX_FD]{};                    // 文件是否以O_DIRECT打开, 在open_file中设置
+    std::unique_ptr<AsyncIO> async_io_;           // 批量异步读写页面的IO引擎
 };
\ No newline at end of file
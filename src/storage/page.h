@@ -30,13 +30,22 @@ struct PageId {
     }
 
     inline int64_t Get() const {
-        return (static_cast<int64_t>(fd << 16) | page_no);
+        return (static_cast<int64_t>(fd) << 32) | static_cast<uint32_t>(page_no);
     }
 };
 
 // PageId的自定义哈希算法, 用于构建unordered_map<PageId, frame_id_t, PageIdHash>
+// 对(fd, page_no)拼成的64位整数做murmur3 fmix64混淆, page_no超过65535时也不会冲突
 struct PageIdHash {
-    size_t operator()(const PageId &x) const { return (x.fd << 16) | x.page_no; }
+    size_t operator()(const PageId &x) const {
+        uint64_t h = static_cast<uint64_t>(x.Get());
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
 };
 
 template <>
@@ -47,13 +56,14 @@ struct std::hash<PageId> {
 /**
  * @description: Page类声明, Page是RMDB数据块的单位、是负责数据操作Record模块的操作对象，
  * Page对象在磁盘上有文件存储, 若在Buffer中则有帧偏移, 并非特指Buffer或Disk上的数据
+ * Page对象只保存帧的元数据, 页面数据存放在BufferPoolManager的PageArena中, 由data_指向
  */
 class Page {
     friend class BufferPoolManager;
 
    public:
     
-    Page() { reset_memory(); }
+    Page() = default;
 
     ~Page() = default;
 
@@ -71,11 +81,60 @@ class Page {
 
     inline void set_page_lsn(lsn_t page_lsn) { memcpy(get_data() + OFFSET_LSN, &page_lsn, sizeof(lsn_t)); }
 
-    void Wlatch() { rwlatch_.lock(); }
+    // 写锁在加锁和解锁时各把版本号加一, 持有写锁期间版本号为奇数
+    void Wlatch() {
+        rwlatch_.lock();
+        version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
     void Rlatch() { rwlatch_.lock_shared(); }
-    void WUnlatch() { rwlatch_.unlock(); }
+    void WUnlatch() {
+        version_.fetch_add(1, std::memory_order_release);
+        rwlatch_.unlock();
+    }
     void RUnlatch() { rwlatch_.unlock_shared(); }
 
+    /**
+     * @description: 开始一次乐观读, 不加锁, 只记录当前版本号
+     * @param {uint64_t*} version 传出参数, 当前版本号, 读完后交给validate_version()校验
+     * @return {bool} 有写者正持有写锁时返回false, 此时不应读取页面
+     */
+    bool read_version(uint64_t *version) const {
+        *version = version_.load(std::memory_order_acquire);
+        return (*version & 1) == 0;
+    }
+
+    /**
+     * @description: 校验乐观读期间页面没有被修改过, 校验失败时读到的数据可能不一致, 必须丢弃
+     * @param {uint64_t} version read_version()得到的版本号
+     * @return {bool} 版本号是否仍为version
+     */
+    bool validate_version(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
+    /**
+     * @description: 对页面执行只读操作read, 先乐观读并校验版本号, 连续失败OPTIMISTIC_READ_RETRIES次后加读锁执行
+     * @param {Fn} read 只读操作, 可能被执行多次, 也可能读到正在被修改的数据, 只能把结果写到局部变量中
+     */
+    template <typename Fn>
+    void optimistic_read(Fn &&read) {
+        for (int i = 0; i < OPTIMISTIC_READ_RETRIES; i++) {
+            uint64_t version;
+            if (!read_version(&version)) {
+                continue;
+            }
+            read();
+            if (validate_version(version)) {
+                return;
+            }
+        }
+        Rlatch();
+        read();
+        RUnlatch();
+    }
+
    public:
     void reset_memory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
@@ -83,9 +142,9 @@ class Page {
     PageId id_;
 
     /** The actual data that is stored within a page.
-     *  该页面在bufferPool中的偏移地址
+     *  该页面在bufferPool中的偏移地址, 指向PageArena中PAGE_SIZE大小的一块内存
      */
-    char data_[PAGE_SIZE] = {};
+    char *data_ = nullptr;
 
     /** 脏页判断 */
     bool is_dirty_ = false;
@@ -95,4 +154,7 @@ class Page {
 
     // page latch. used to protect the content
     std::shared_mutex rwlatch_;
+
+    /** 页面内容的版本号, 供乐观读校验; 只在持有rwlatch_写锁时修改 */
+    std::atomic<uint64_t> version_{0};
 };
\ No newline at end of file
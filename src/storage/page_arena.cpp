@@ -0,0 +1,67 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/page_arena.h"
+
+PageArena::PageArena(size_t num_pages, bool use_huge_pages) : num_pages_(num_pages) {
+    size_t size = num_pages_ * PAGE_SIZE;
+    if (size == 0) {
+        return;
+    }
+#ifdef MAP_HUGETLB
+    if (use_huge_pages) {
+        // 大页映射的长度必须是大页大小的整数倍; 系统大页不足时mmap返回ENOMEM, 退化为普通映射
+        size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void *ptr = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            base_ = static_cast<char *>(ptr);
+            mapped_size_ = huge_size;
+            backing_ = Backing::HUGETLB;
+            return;
+        }
+    }
+#endif
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw UnixError();
+    }
+    base_ = static_cast<char *>(ptr);
+    mapped_size_ = size;
+#ifdef MADV_HUGEPAGE
+    // 透明大页只是建议, 内核未开启THP时忽略失败
+    if (use_huge_pages && madvise(ptr, size, MADV_HUGEPAGE) == 0) {
+        backing_ = Backing::THP;
+    }
+#endif
+}
+
+PageArena::~PageArena() {
+    if (base_ != nullptr) {
+        munmap(base_, mapped_size_);
+    }
+}
+
+void PageArena::release(size_t first, size_t count) {
+    if (backing_ == Backing::HUGETLB || count == 0) {
+        return;
+    }
+    madvise(page_data(first), count * PAGE_SIZE, MADV_DONTNEED);
+}
+
+const char *PageArena::backing_name() const {
+    switch (backing_) {
+        case Backing::HUGETLB:
+            return "hugetlb";
+        case Backing::THP:
+            return "transparent huge pages";
+        default:
+            return "regular pages";
+    }
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <new>
+
+#include "common/config.h"
+#include "errors.h"
+
+/**
+ * @description: 缓冲池页面数据所在的一整块匿名映射内存, 起始地址按页对齐
+ *              优先使用MAP_HUGETLB大页; 系统没有预留大页时退化为普通映射并用madvise请求透明大页;
+ *              匿名映射由内核在首次访问时清零, 构造时不需要逐页初始化
+ *              普通映射只预留地址空间, 按缓冲池最大容量映射, 实际占用的物理内存只与用到的页面有关
+ *              每个页面的地址都按PAGE_SIZE对齐, 帧可以直接作为O_DIRECT读写的缓冲区
+ */
+class PageArena {
+    static_assert(PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0, "buffer pool frames must stay aligned for O_DIRECT");
+
+   public:
+    enum class Backing { HUGETLB, THP, REGULAR };
+
+    /**
+     * @description: 映射能容纳num_pages个页面的内存, 映射失败时throw UnixError
+     * @param {size_t} num_pages 页面个数
+     * @param {bool} use_huge_pages 是否尝试使用大页
+     */
+    explicit PageArena(size_t num_pages, bool use_huge_pages = BUFFER_POOL_USE_HUGE_PAGES);
+
+    ~PageArena();
+
+    PageArena(const PageArena &) = delete;
+    PageArena &operator=(const PageArena &) = delete;
+
+    /**
+     * @description: 返回第i个页面的数据地址
+     */
+    char *page_data(size_t i) const { return base_ + i * PAGE_SIZE; }
+
+    /**
+     * @description: 把[first, first + count)这些页面的物理内存还给系统, 之后再访问时内容为0
+     *              大页映射的内存在映射时已经预留, 无法按页归还, 此时什么也不做
+     * @param {size_t} first 第一个页面
+     * @param {size_t} count 页面个数
+     */
+    void release(size_t first, size_t count);
+
+    size_t num_pages() const { return num_pages_; }
+
+    Backing backing() const { return backing_; }
+
+    const char *backing_name() const;
+
+   private:
+    char *base_ = nullptr;
+    size_t num_pages_;
+    size_t mapped_size_ = 0;    // 实际映射的字节数, 使用MAP_HUGETLB时向上取整到大页大小
+    Backing backing_ = Backing::REGULAR;
+};
+
+/**
+ * @description: 为capacity个T预留一段匿名映射的地址空间, 元素由construct_array按需构造
+ *              未构造的部分不会被访问, 也就不占用物理内存; 映射失败时throw UnixError
+ * @param {size_t} capacity 最多容纳的元素个数
+ */
+template <typename T>
+T *reserve_array(size_t capacity) {
+    void *ptr = mmap(nullptr, capacity * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                     -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw UnixError();
+    }
+    return static_cast<T *>(ptr);
+}
+
+/**
+ * @description: 在reserve_array预留的空间上默认构造下标为[from, to)的元素
+ */
+template <typename T>
+void construct_array(T *array, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        new (array + i) T();
+    }
+}
+
+/**
+ * @description: 析构前constructed个元素, 并解除reserve_array建立的映射
+ */
+template <typename T>
+void destroy_array(T *array, size_t constructed, size_t capacity) {
+    for (size_t i = 0; i < constructed; ++i) {
+        array[i].~T();
+    }
+    munmap(array, capacity * sizeof(T));
+}
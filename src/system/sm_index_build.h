@@ -0,0 +1,114 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "index/ix_handle.h"
+#include "sm_meta.h"
+
+/* 表元数据的读写锁, 写者优先
+ * std::shared_mutex读者优先, 写操作源源不断时在线建立索引可能一直拿不到写锁; 写者等待期间持有turnstile_,
+ * 新来的读者在turnstile_上排队, 已持有读锁的语句结束后写者就能拿到锁 */
+class MetaLatch {
+   private:
+    std::mutex turnstile_;
+    std::shared_mutex latch_;
+
+   public:
+    void lock() {
+        std::lock_guard<std::mutex> guard(turnstile_);
+        latch_.lock();
+    }
+
+    void unlock() { latch_.unlock(); }
+
+    void lock_shared() {
+        { std::lock_guard<std::mutex> guard(turnstile_); }
+        latch_.lock_shared();
+    }
+
+    void unlock_shared() { latch_.unlock_shared(); }
+};
+
+/* 在线建立索引期间的旁路日志
+ * 索引登记之后, 修改表中记录的语句把对新索引的影响(插入或删除一个键值对)按发生的顺序追加到这里;
+ * 建索引线程扫描完表后按顺序重放, 最后一轮在持有元数据写锁时完成, 之后索引发布到DbMeta中由写操作直接维护 */
+class IndexBuildLog {
+   private:
+    struct Entry {
+        bool is_insert;
+        Rid rid;
+    };
+
+    IndexMeta index_meta_;          // 正在建立的索引
+    std::mutex latch_;              // 多个写者并发追加
+    std::vector<Entry> entries_;
+    std::vector<char> keys_;        // 与entries_一一对应, 每个key长index_meta_.col_tot_len
+
+   public:
+    explicit IndexBuildLog(const IndexMeta &index_meta) : index_meta_(index_meta) {}
+
+    const IndexMeta &get_index_meta() const { return index_meta_; }
+
+    /**
+     * @description: 记录一次写操作, 调用者持有元数据读锁
+     * @param {bool} is_insert 插入还是删除记录
+     * @param {char*} rec_data 被插入或删除的记录
+     * @param {Rid&} rid 记录的位置
+     */
+    void append(bool is_insert, const char *rec_data, const Rid &rid) {
+        std::lock_guard<std::mutex> guard(latch_);
+        size_t offset = keys_.size();
+        keys_.resize(offset + index_meta_.col_tot_len);
+        for (auto &col : index_meta_.cols) {
+            memcpy(keys_.data() + offset, rec_data + col.offset, col.len);
+            offset += col.len;
+        }
+        entries_.push_back({is_insert, rid});
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> guard(latch_);
+        return entries_.size();
+    }
+
+    /**
+     * @description: 取出目前为止记录的所有写操作, 按顺序应用到新索引上
+     * 扫描表时每条记录读到的可能是这些写操作之前或之后的状态, 所以重放必须是幂等的:
+     * 插入时key已存在就跳过, 删除时只删除仍指向同一条记录的key
+     * @return {size_t} 重放的写操作数量
+     */
+    size_t replay(IxHandle *ih, Transaction *txn) {
+        std::vector<Entry> entries;
+        std::vector<char> keys;
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            entries.swap(entries_);
+            keys.swap(keys_);
+        }
+        int len = index_meta_.col_tot_len;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const char *key = keys.data() + i * len;
+            if (entries[i].is_insert) {
+                ih->insert_entry(key, entries[i].rid, txn);
+                continue;
+            }
+            std::vector<Rid> rids;
+            if (ih->get_value(key, &rids, txn) && rids[0] == entries[i].rid) {
+                ih->delete_entry(key, txn);
+            }
+        }
+        return entries.size();
+    }
+};
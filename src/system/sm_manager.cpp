@@ -14,6 +14,8 @@ See the Mulan PSL v2 for more details. */
 #include <unistd.h>
 
 #include <fstream>
+#include <iomanip>
+#include <thread>
 
 #include "index/ix.h"
 #include "record/rm.h"
@@ -94,9 +96,12 @@ void SmManager::open_db(const std::string& db_name) {
     for(auto &tab: db_.tabs_){
         fhs_.emplace(tab.first, rm_manager_->open_file(tab.first));
         for(auto &index : tab.second.indexes){
-            ihs_.emplace(ix_manager_->get_index_name(tab.first, index.cols), ix_manager_->open_index(tab.first, index.cols));
+            ihs_.emplace(ix_manager_->get_index_name(tab.first, index.cols), open_index(tab.first, index));
         }
     }
+    // 按上次关闭前保存的页面列表在后台预热缓冲池, 不阻塞后续的恢复与建立连接
+    buffer_pool_manager_->load_hot_pages(BUFFER_POOL_HOT_PAGES_NAME);
+    buffer_pool_manager_->start_hot_pages_dumper(BUFFER_POOL_HOT_PAGES_NAME);
 }
 
 /**
@@ -114,11 +119,22 @@ void SmManager::flush_meta() {
 void SmManager::close_db() {
     std::ofstream ofs(DB_META_NAME);
     ofs << db_;
+    // 文件关闭前保存页面列表, 之后fd不再能对应到文件名
+    buffer_pool_manager_->stop_hot_pages_dumper();
+    try {
+        buffer_pool_manager_->save_hot_pages(BUFFER_POOL_HOT_PAGES_NAME);
+    } catch (RMDBError &) {
+        // 页面列表只用于预热, 保存失败不影响关闭数据库
+    }
     for(auto &tab: db_.tabs_){
         buffer_pool_manager_->flush_all_pages(fhs_.at(tab.first)->GetFd());
         rm_manager_->close_file(fhs_.at(tab.first).get());
         fhs_.erase(tab.first);
         for(auto &index : tab.second.indexes){
+            if (IX_BLOOM_FILTER_PERSIST) {
+                auto ih = ihs_.at(ix_manager_->get_index_name(tab.first, index.cols)).get();
+                ih->save_bloom_filter(ix_manager_->get_index_name(tab.first, index.cols) + ".bloom");
+            }
             buffer_pool_manager_->flush_all_pages(ihs_.at(ix_manager_->get_index_name(tab.first, index.cols))->GetFd());
             ix_manager_->close_index(ihs_.at(ix_manager_->get_index_name(tab.first, index.cols)).get());
             ihs_.erase(ix_manager_->get_index_name(tab.first, index.cols));
@@ -148,6 +164,17 @@ void SmManager::show_tables(Context* context) {
     AppendToOutputFile(ss.str());
 }
 
+/**
+ * @description: 数据库中所有表的名称
+ */
+std::vector<std::string> SmManager::get_table_names() const {
+    std::vector<std::string> tab_names;
+    for (auto &entry : db_.tabs_) {
+        tab_names.push_back(entry.first);
+    }
+    return tab_names;
+}
+
 /**
  * @description: 显示表的元数据
  * @param {string&} tab_name 表名称
@@ -223,51 +250,276 @@ void SmManager::drop_table(const std::string& tab_name, Context* context) {
     flush_meta();
 }
 
+/**
+ * @description: 打开索引文件, 根据索引元数据选择B+树或哈希索引的文件句柄
+ * @param {string&} tab_name 表的名称
+ * @param {IndexMeta&} index 索引元数据
+ * @return {unique_ptr<IxHandle>} 索引文件句柄
+ */
+std::unique_ptr<IxHandle> SmManager::open_index(const std::string& tab_name, const IndexMeta& index) {
+    std::unique_ptr<IxHandle> ih;
+    if (index.is_hash) {
+        ih = ix_manager_->open_hash_index(tab_name, index.cols);
+    } else {
+        ih = ix_manager_->open_index(tab_name, index.cols);
+    }
+    if (IX_BLOOM_FILTER) {
+        attach_bloom_filter(tab_name, index, ih.get());
+    }
+    return ih;
+}
+
+/**
+ * @description: 为刚打开的索引准备布隆过滤器, 优先读入上次关闭时保存的过滤器, 否则扫描索引中的key重建
+ * 保存的过滤器读入后立即删除, 异常退出后它可能缺少最后插入的key, 下次打开必须重建
+ * @param {string&} tab_name 表的名称
+ * @param {IndexMeta&} index 索引元数据, 过滤器只覆盖key字段, 不含INCLUDE字段
+ * @param {IxHandle*} ih 索引文件句柄
+ */
+void SmManager::attach_bloom_filter(const std::string& tab_name, const IndexMeta& index, IxHandle* ih) {
+    std::string bloom_name = ix_manager_->get_index_name(tab_name, index.cols) + ".bloom";
+    std::unique_ptr<IxBloomFilter> bloom;
+    if (disk_manager_->is_file(bloom_name)) {
+        if (IX_BLOOM_FILTER_PERSIST) {
+            bloom = IxBloomFilter::load(bloom_name, index.key_tot_len());
+        }
+        disk_manager_->destroy_file(bloom_name);
+    }
+    if (bloom != nullptr && bloom->num_added() <= bloom->capacity()) {
+        ih->set_bloom_filter(std::move(bloom));
+        return;
+    }
+    // 按表中能存放的记录数分配, 在线建立索引时索引还是空的, 之后扫描表插入的key都会加进过滤器
+    auto file_hdr = fhs_.at(tab_name)->get_file_hdr();
+    size_t expected_keys = static_cast<size_t>(file_hdr.num_pages) * file_hdr.num_records_per_page;
+    ih->rebuild_bloom_filter(index.key_tot_len(), expected_keys);
+}
+
 /**
  * @description: 创建索引
  * @param {string&} tab_name 表的名称
  * @param {vector<string>&} col_names 索引包含的字段名称
+ * @param {vector<string>&} include_col_names INCLUDE的字段名称, 排在key字段之后存放在B+树中, 不参与比较和唯一性检查
+ * @param {bool} is_hash 是否创建可扩展哈希索引, 哈希索引不能带INCLUDE字段
  * @param {Context*} context
+ * @return {shared_ptr<IndexBuildLog>} 新索引的旁路日志, 索引文件已创建但还没有发布到元数据中, 由build_index()填充后发布
  */
-void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
+std::shared_ptr<IndexBuildLog> SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names,
+                                                       const std::vector<std::string>& include_col_names, bool is_hash,
+                                                       Context* context) {
+    // 登记期间持有元数据写锁, 之后修改这张表的语句都会把写操作记到新索引的旁路日志中
+    std::unique_lock<MetaLatch> guard(meta_latch_);
     if (!db_.is_table(tab_name)) {
         throw TableNotFoundError(tab_name);
     }
-    if(ix_manager_->exists(tab_name, col_names)){
+    if(db_.get_table(tab_name).is_index(col_names)){
         throw IndexExistsError(tab_name, col_names);
     }
+    if(is_hash && !include_col_names.empty()){
+        throw RMDBError("Hash index does not support INCLUDE columns");
+    }
     IndexMeta index_meta;
     index_meta.tab_name = tab_name;
+    index_meta.is_hash = is_hash;
     index_meta.col_num = 0;
     index_meta.col_tot_len = 0;
+    // 交给B+树的字段元数据, INCLUDE字段只是随key存放的数据, 按CHAR逐字节比较, 不要求字段类型可以比较
+    std::vector<ColMeta> ix_cols;
     for(auto col: col_names){
         auto iter = db_.get_table(tab_name).get_col(col);
         index_meta.col_num++;
         index_meta.col_tot_len += (*iter).len;
         index_meta.cols.push_back(*iter);
+        ix_cols.push_back(*iter);
+    }
+    for(auto col: include_col_names){
+        auto iter = db_.get_table(tab_name).get_col(col);
+        if(index_meta.has_col(col)) continue;
+        index_meta.col_num++;
+        index_meta.include_num++;
+        index_meta.col_tot_len += (*iter).len;
+        index_meta.cols.push_back(*iter);
+        ix_cols.push_back(*iter);
+        ix_cols.back().type = TYPE_STRING;
+    }
+    if(ix_manager_->exists(tab_name, index_meta.cols)){
+        throw IndexExistsError(tab_name, col_names);
+    }
+    if(is_hash){
+        ix_manager_->create_hash_index(tab_name, ix_cols);
+    } else {
+        ix_manager_->create_index(tab_name, ix_cols);
+    }
+    auto build = std::make_shared<IndexBuildLog>(index_meta);
+    index_builds_[tab_name].push_back(build);
+    return build;
+}
+
+/**
+ * @description: 在线填充create_index()创建的索引, 期间不阻塞修改表的语句
+ * 先不加锁地并行扫描表建立索引, 再重放扫描期间的写操作; 旁路日志足够短时持有元数据写锁重放最后一轮, 把索引发布到DbMeta中
+ * @param {shared_ptr<IndexBuildLog>&} build create_index()返回的旁路日志
+ * @param {Context*} context
+ */
+void SmManager::build_index(const std::shared_ptr<IndexBuildLog>& build, Context* context) {
+    const IndexMeta& index_meta = build->get_index_meta();
+    const std::string& tab_name = index_meta.tab_name;
+    std::string ix_name = ix_manager_->get_index_name(tab_name, index_meta.cols);
+    std::unique_ptr<IxHandle> ih;
+    try {
+        ih = open_index(tab_name, index_meta);
+        scan_table_into_index(index_meta, ih.get(), ix_name, context->txn_);
+        // 每一轮重放期间新增的写操作比上一轮少才继续, 重放赶不上写入时直接持有写锁重放剩余部分
+        size_t last_replayed = SIZE_MAX;
+        while (build->size() >= ONLINE_INDEX_CATCHUP_ENTRIES) {
+            size_t replayed = build->replay(ih.get(), context->txn_);
+            if (replayed >= last_replayed) {
+                break;
+            }
+            last_replayed = replayed;
+        }
+        std::unique_lock<MetaLatch> guard(meta_latch_);
+        build->replay(ih.get(), context->txn_);
+        db_.get_table(tab_name).indexes.push_back(index_meta);
+        ihs_.emplace(ix_name, std::move(ih));
+        finish_index_build(build);
+    } catch (...) {
+        // 建立失败时撤销登记, 删除索引文件; 打开索引失败时ih为空
+        std::unique_lock<MetaLatch> guard(meta_latch_);
+        finish_index_build(build);
+        if (ih != nullptr) {
+            ix_manager_->close_index(ih.get());
+            ix_manager_->del_index_from_buf(ih.get());
+        }
+        ix_manager_->destroy_index(tab_name, index_meta.cols);
+        throw;
+    }
+}
+
+/**
+ * @description: 并行扫描表, 把每条记录的key放进新索引
+ * 不对表加锁, 各线程按页面号交错分工, 逐页面乐观读取; B+树的key先外部排序, 扫描结束后自底向上批量建立, 哈希索引由各线程直接插入
+ */
+void SmManager::scan_table_into_index(const IndexMeta& index_meta, IxHandle* ih, const std::string& ix_name,
+                                      Transaction* txn) {
+    RmFileHandle* fh = fhs_.at(index_meta.tab_name).get();
+    // 登记之后才新分配的页面上只有登记之后插入的记录, 它们都在旁路日志中
+    int num_pages = fh->get_file_hdr().num_pages;
+    int record_size = fh->get_file_hdr().record_size;
+    auto ix = dynamic_cast<IxIndexHandle*>(ih);
+    std::unique_ptr<IxExternalSorter> sorter;
+    if (ix != nullptr) {
+        sorter = std::make_unique<IxExternalSorter>(ix->get_file_hdr(), ix_name + ".sort");
+    }
+    std::mutex sorter_latch;
+
+    int num_threads = std::min({ONLINE_INDEX_BUILD_THREADS, std::max(1, (int)std::thread::hardware_concurrency()),
+                                std::max(1, num_pages - RM_FIRST_RECORD_PAGE)});
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            try {
+                std::vector<Rid> rids;
+                std::vector<char> records;
+                std::vector<char> keys;
+                for (int page_no = RM_FIRST_RECORD_PAGE + t; page_no < num_pages; page_no += num_threads) {
+                    fh->get_page_all_records(page_no, &rids, &records);
+                    keys.resize(rids.size() * index_meta.col_tot_len);
+                    for (size_t i = 0; i < rids.size(); ++i) {
+                        char* key = keys.data() + i * index_meta.col_tot_len;
+                        int offset = 0;
+                        for (auto& col : index_meta.cols) {
+                            memcpy(key + offset, records.data() + i * record_size + col.offset, col.len);
+                            offset += col.len;
+                        }
+                    }
+                    if (sorter == nullptr) {
+                        for (size_t i = 0; i < rids.size(); ++i) {
+                            ih->insert_entry(keys.data() + i * index_meta.col_tot_len, rids[i], txn);
+                        }
+                        continue;
+                    }
+                    // 每个页面的key攒在一起交给排序, 只在这里串行
+                    std::lock_guard<std::mutex> guard(sorter_latch);
+                    for (size_t i = 0; i < rids.size(); ++i) {
+                        sorter->add(keys.data() + i * index_meta.col_tot_len, rids[i]);
+                    }
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if (sorter != nullptr) {
+        sorter->finish();
+        ix->bulk_load(sorter.get());
+    }
+}
+
+/**
+ * @description: 撤销索引的登记, 之后的写操作不再记录到它的旁路日志中; 调用者持有元数据写锁
+ */
+void SmManager::finish_index_build(const std::shared_ptr<IndexBuildLog>& build) {
+    auto iter = index_builds_.find(build->get_index_meta().tab_name);
+    if (iter == index_builds_.end()) {
+        return;
+    }
+    auto& builds = iter->second;
+    builds.erase(std::remove(builds.begin(), builds.end(), build), builds.end());
+    if (builds.empty()) {
+        index_builds_.erase(iter);
+    }
+}
+
+/**
+ * @description: 修改表中的记录后调用, 把写操作记到表上正在在线建立的索引的旁路日志中; 调用者持有元数据读锁
+ * @param {string&} tab_name 表的名称
+ * @param {bool} is_insert 插入还是删除记录, 更新记录按删除旧记录和插入新记录各记一次
+ * @param {char*} rec_data 被插入或删除的记录
+ * @param {Rid&} rid 记录的位置
+ */
+void SmManager::log_index_write(const std::string& tab_name, bool is_insert, const char* rec_data, const Rid& rid) {
+    if (index_builds_.empty()) {
+        return;
+    }
+    auto iter = index_builds_.find(tab_name);
+    if (iter == index_builds_.end()) {
+        return;
+    }
+    for (auto& build : iter->second) {
+        build->append(is_insert, rec_data, rid);
     }
-    ix_manager_->create_index(tab_name, index_meta.cols);
-    db_.get_table(tab_name).indexes.push_back(index_meta);
 }
 
 /**
  * @description: 删除索引
  * @param {string&} tab_name 表名称
- * @param {vector<string>&} col_names 索引包含的字段名称
+ * @param {vector<string>&} col_names 索引包含的字段名称, 可以不写INCLUDE字段
  * @param {Context*} context
  */
 void SmManager::drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
     if (!db_.is_table(tab_name)) {
         throw TableNotFoundError(tab_name);
     }
-    if(!ix_manager_->exists(tab_name, col_names)){
+    if(!db_.get_table(tab_name).is_index(col_names)){
         throw IndexNotFoundError(tab_name, col_names);
     }
-    ix_manager_->close_index(ihs_.at(get_ix_manager()->get_index_name(tab_name, col_names)).get());
-    ix_manager_->del_index_from_buf(ihs_.at(get_ix_manager()->get_index_name(tab_name, col_names)).get());
-    ihs_.erase(get_ix_manager()->get_index_name(tab_name, col_names));
-    ix_manager_->destroy_index(tab_name,col_names);
     auto ix_meta_iter = db_.get_table(tab_name).get_index_meta(col_names);
+    // 索引文件名包含INCLUDE字段
+    std::string ix_name = get_ix_manager()->get_index_name(tab_name, ix_meta_iter->cols);
+    ix_manager_->close_index(ihs_.at(ix_name).get());
+    ix_manager_->del_index_from_buf(ihs_.at(ix_name).get());
+    ihs_.erase(ix_name);
+    ix_manager_->destroy_index(tab_name, ix_meta_iter->cols);
     db_.get_table(tab_name).indexes.erase(ix_meta_iter);
 }
 
@@ -302,15 +554,111 @@ void SmManager::show_index(const std::string& tab_name, Context* context) {
         record.push_back("unique");
         std::string index_col = "(";
         ss << "| " << tab_name << " | unique | (" ;
-        for(int i=0; i < entry.col_num-1; i++){
+        for(int i=0; i < entry.key_num()-1; i++){
             ss << entry.cols[i].name << "," ;
             index_col = index_col + entry.cols[i].name + ",";
         }
-        ss << entry.cols.back().name << ") |\n" ;
-        index_col = index_col + entry.cols.back().name + ")";
+        ss << entry.cols[entry.key_num()-1].name << ")" ;
+        index_col = index_col + entry.cols[entry.key_num()-1].name + ")";
+        if(entry.include_num > 0){
+            ss << " include (";
+            index_col += " include (";
+            for(int i = entry.key_num(); i < entry.col_num; i++){
+                std::string sep = i + 1 < entry.col_num ? "," : ")";
+                ss << entry.cols[i].name << sep;
+                index_col = index_col + entry.cols[i].name + sep;
+            }
+        }
+        if(entry.is_hash){
+            ss << " using hash";
+            index_col += " using hash";
+        }
+        ss << " |\n" ;
         record.push_back(index_col);
         printer.print_record(record, context);
     }
     printer.print_separator(context);
     AppendToOutputFile(ss.str());
 }
+
+/**
+ * @description: 显示每张表和每个索引中可以回收复用的空间
+ *               表文件统计空闲页面链表上的空页面和空闲slot, 索引文件统计B+树合并后释放的空闲页面
+ * @param {Context*} context 
+ */
+void SmManager::show_space(Context* context) {
+    if (!enable_output_file) return;
+    std::stringstream ss;
+    std::vector<std::string> captions = {"File", "Pages", "FreePages", "FreeBytes"};
+    ss << "| File | Pages | FreePages | FreeBytes |\n";
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    auto print_file = [&](const std::string &file, int num_pages, int num_free_pages, size_t free_bytes) {
+        std::vector<std::string> record = {file, std::to_string(num_pages), std::to_string(num_free_pages),
+                                           std::to_string(free_bytes)};
+        printer.print_record(record, context);
+        ss << "| " << file << " | " << num_pages << " | " << num_free_pages << " | " << free_bytes << " |\n";
+    };
+    for (auto &entry : db_.tabs_) {
+        auto &tab = entry.second;
+        auto &fh = fhs_.at(tab.name);
+        RmFileHdr file_hdr = fh->get_file_hdr();
+        int num_empty_pages;
+        int num_free_slots = fh->get_num_free_slots(&num_empty_pages);
+        print_file(tab.name, file_hdr.num_pages, num_empty_pages, static_cast<size_t>(num_free_slots) * file_hdr.record_size);
+        for (auto &index : tab.indexes) {
+            auto ix_name = ix_manager_->get_index_name(tab.name, index.cols);
+            auto &ih = ihs_.at(ix_name);
+            int num_free_pages = ih->get_num_free_pages();
+            print_file(ix_name, ih->get_num_pages(), num_free_pages, static_cast<size_t>(num_free_pages) * PAGE_SIZE);
+        }
+    }
+    printer.print_separator(context);
+    AppendToOutputFile(ss.str());
+}
+
+/**
+ * @description: 显示每个索引的树高、结点数和key的压缩效果
+ *               Ratio为key不压缩时占用的字节数与实际占用的字节数之比, 不压缩的索引为1
+ * @param {Context*} context 
+ */
+void SmManager::show_index_stats(Context* context) {
+    if (!enable_output_file) return;
+    std::stringstream ss;
+    std::vector<std::string> captions = {"Index", "Height", "InternalPages", "LeafPages", "Entries", "AvgPrefix", "Ratio"};
+    ss << "| Index | Height | InternalPages | LeafPages | Entries | AvgPrefix | Ratio |\n";
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    auto to_fixed = [](double value) {
+        std::stringstream out;
+        out << std::fixed << std::setprecision(2) << value;
+        return out.str();
+    };
+    for (auto &entry : db_.tabs_) {
+        for (auto &index : entry.second.indexes) {
+            auto ix_name = ix_manager_->get_index_name(entry.second.name, index.cols);
+            IxIndexStats stats = ihs_.at(ix_name)->get_stats();
+            int num_nodes = stats.num_internal_pages + stats.num_leaf_pages;
+            std::string avg_prefix = to_fixed(static_cast<double>(stats.prefix_bytes) / num_nodes);
+            std::string ratio = stats.stored_key_bytes == 0
+                                    ? to_fixed(1)
+                                    : to_fixed(static_cast<double>(stats.key_bytes) / stats.stored_key_bytes);
+            std::vector<std::string> record = {ix_name,
+                                               std::to_string(stats.height),
+                                               std::to_string(stats.num_internal_pages),
+                                               std::to_string(stats.num_leaf_pages),
+                                               std::to_string(stats.num_entries),
+                                               avg_prefix,
+                                               ratio};
+            printer.print_record(record, context);
+            ss << "| " << ix_name << " | " << stats.height << " | " << stats.num_internal_pages << " | "
+               << stats.num_leaf_pages << " | " << stats.num_entries << " | " << avg_prefix << " | " << ratio << " |\n";
+        }
+    }
+    printer.print_separator(context);
+    AppendToOutputFile(ss.str());
+}
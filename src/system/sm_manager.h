@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include "index/ix.h"
 #include "record/rm_file_handle.h"
 #include "sm_defs.h"
+#include "sm_index_build.h"
 #include "sm_meta.h"
 #include "common/context.h"
 
@@ -29,12 +30,16 @@ class SmManager {
    public:
     DbMeta db_;             // 当前打开的数据库的元数据
     std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;    // file name -> record file handle, 当前数据库中每张表的数据文件
-    std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;   // file name -> index file handle, 当前数据库中每个索引的文件
+    std::unordered_map<std::string, std::unique_ptr<IxHandle>> ihs_;        // file name -> index file handle, 当前数据库中每个索引的文件, B+树或哈希索引
     DiskManager* disk_manager_;
+    // 表元数据的读写锁: 读写表中记录的语句执行期间持有读锁; 在线建立索引只在登记和发布时短暂持有写锁
+    MetaLatch meta_latch_;
    private:
     BufferPoolManager* buffer_pool_manager_;
     RmManager* rm_manager_;
     IxManager* ix_manager_;
+    // 表名 -> 表上正在在线建立的索引的旁路日志, 受meta_latch_保护
+    std::unordered_map<std::string, std::vector<std::shared_ptr<IndexBuildLog>>> index_builds_;
 
    public:
     SmManager(DiskManager* disk_manager, BufferPoolManager* buffer_pool_manager, RmManager* rm_manager,
@@ -66,17 +71,41 @@ class SmManager {
 
     void show_tables(Context* context);
 
+    std::vector<std::string> get_table_names() const;
+
     void desc_table(const std::string& tab_name, Context* context);
 
     void create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context);
 
     void drop_table(const std::string& tab_name, Context* context);
 
-    void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
+    std::shared_ptr<IndexBuildLog> create_index(const std::string& tab_name, const std::vector<std::string>& col_names,
+                                                const std::vector<std::string>& include_col_names, bool is_hash,
+                                                Context* context);
+
+    void build_index(const std::shared_ptr<IndexBuildLog>& build, Context* context);
+
+    bool is_index_building(const std::string& tab_name) const { return index_builds_.count(tab_name) != 0; }
+
+    void log_index_write(const std::string& tab_name, bool is_insert, const char* rec_data, const Rid& rid);
+
+    std::unique_ptr<IxHandle> open_index(const std::string& tab_name, const IndexMeta& index);
 
     void drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
     
     void drop_index(const std::string& tab_name, const std::vector<ColMeta>& col_names, Context* context);
 
     void show_index(const std::string& tab_name, Context* context);
+
+    void show_space(Context* context);
+
+    void show_index_stats(Context* context);
+
+   private:
+    void attach_bloom_filter(const std::string& tab_name, const IndexMeta& index, IxHandle* ih);
+
+    void scan_table_into_index(const IndexMeta& index_meta, IxHandle* ih, const std::string& ix_name,
+                               Transaction* txn);
+
+    void finish_index_build(const std::shared_ptr<IndexBuildLog>& build);
 };
\ No newline at end of file
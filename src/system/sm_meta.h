@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -48,6 +49,8 @@ struct IndexMeta {
     int col_tot_len;                // 索引字段长度总和
     int col_num;                    // 索引字段数量
     std::vector<ColMeta> cols;      // 索引包含的字段
+    int include_num = 0;            // cols末尾INCLUDE字段的数量, 只随key存放在B+树中供索引扫描读取, 不参与索引匹配和唯一性检查
+    bool is_hash = false;           // 是否是可扩展哈希索引, 否则是B+树; 哈希索引只支持所有key字段上的等值查找
 
     IndexMeta(){}
     
@@ -56,10 +59,36 @@ struct IndexMeta {
         col_tot_len = other.col_tot_len;
         col_num = other.col_num;
         for(auto col : other.cols) cols.push_back(col);
+        include_num = other.include_num;
+        is_hash = other.is_hash;
+    }
+
+    /* 不含INCLUDE字段的key字段数量 */
+    int key_num() const { return col_num - include_num; }
+
+    /* 不含INCLUDE字段的key字段长度总和 */
+    int key_tot_len() const {
+        int len = 0;
+        for(int i = 0; i < key_num(); ++i) len += cols[i].len;
+        return len;
+    }
+
+    /* 索引是否包含名为col_name的字段, 包括INCLUDE字段 */
+    bool has_col(const std::string &col_name) const {
+        return std::any_of(cols.begin(), cols.end(), [&](const ColMeta &col) { return col.name == col_name; });
+    }
+
+    /* col_names是否是索引的全部字段, 或者是不含INCLUDE字段的key字段 */
+    bool match(const std::vector<std::string>& col_names) const {
+        if((int)col_names.size() != col_num && (int)col_names.size() != key_num()) return false;
+        for(size_t i = 0; i < col_names.size(); ++i) {
+            if(cols[i].name.compare(col_names[i]) != 0) return false;
+        }
+        return true;
     }
 
     friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
-        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num;
+        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num << " " << index.include_num << " " << index.is_hash;
         for(auto& col: index.cols) {
             os << "\n" << col;
         }
@@ -68,6 +97,12 @@ struct IndexMeta {
 
     friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
         is >> index.tab_name >> index.col_tot_len >> index.col_num;
+        // 旧版本的元数据这一行没有include_num和is_hash
+        std::string rest;
+        std::getline(is, rest);
+        index.include_num = 0;
+        index.is_hash = false;
+        std::istringstream(rest) >> index.include_num >> index.is_hash;
         for(int i = 0; i < index.col_num; ++i) {
             ColMeta col;
             is >> col;
@@ -97,33 +132,19 @@ struct TabMeta {
         return pos != cols.end();
     }
 
-    /* 判断当前表上是否建有指定索引，索引包含的字段为col_names */
+    /* 判断当前表上是否建有指定索引，索引包含的字段为col_names, col_names可以不含INCLUDE字段 */
     bool is_index(const std::vector<std::string>& col_names) const {
         for(auto& index: indexes) {
-            if(index.col_num == (int)col_names.size()) {
-                size_t i = 0;
-                for(; (int)i < index.col_num; ++i) {
-                    if(index.cols[i].name.compare(col_names[i]) != 0)
-                        break;
-                }
-                if((int)i == index.col_num) return true;
-            }
+            if(index.match(col_names)) return true;
         }
 
         return false;
     }
 
-    /* 根据字段名称集合获取索引元数据 */
+    /* 根据字段名称集合获取索引元数据, col_names可以不含INCLUDE字段 */
     std::vector<IndexMeta>::iterator get_index_meta(const std::vector<std::string>& col_names) {
         for(auto index = indexes.begin(); index != indexes.end(); ++index) {
-            if((*index).col_num != (int)col_names.size()) continue;
-            auto& index_cols = (*index).cols;
-            size_t i = 0;
-            for(; i < col_names.size(); ++i) {
-                if(index_cols[i].name.compare(col_names[i]) != 0) 
-                    break;
-            }
-            if(i == col_names.size()) return index;
+            if((*index).match(col_names)) return index;
         }
         throw IndexNotFoundError(name, col_names);
     }
@@ -0,0 +1,121 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "index/ix.h"
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_FILE_NAME = "bench";  // 索引文件名的前缀, 每种线程数使用一个单独的索引文件
+const int BENCH_POOL_SIZE = 8192;            // 缓冲池能放下整棵树, 只测量并发控制的开销
+const int BENCH_TOTAL_KEYS = 100000;         // 每种线程数一共插入的key数
+const int BENCH_LOOKUP_ROUNDS = 4;           // 点查的次数是插入的key数的倍数
+
+/** 多线程插入和点查的吞吐, 观察B+树并发控制随线程数的扩展情况
+ * 每个线程以随机顺序插入一段连续的key, 不同线程的插入大多落在不同的叶子结点上;
+ * 之后每个线程在全部key中随机点查 */
+class BPlusTreeConcurrentTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BENCH_POOL_SIZE, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+    }
+
+    std::vector<ColMeta> index_cols(const std::string &tab_name) {
+        ColMeta col;
+        col.tab_name = tab_name;
+        col.name = "col1";
+        col.type = TYPE_INT;
+        col.len = sizeof(int);
+        col.offset = 0;
+        col.index = true;
+        col.agg_type = ast::SV_AGG_NONE;
+        return {col};
+    }
+
+    // 启动num_threads个线程执行work(thread_id), 返回全部线程结束所用的秒数
+    template <typename Fn>
+    double run_threads(int num_threads, Fn &&work) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back(work, t);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+TEST_F(BPlusTreeConcurrentTest, InsertAndLookupScaling) {
+    for (int num_threads : {1, 2, 4, 8}) {
+        std::string tab_name = TEST_FILE_NAME + std::to_string(num_threads);
+        auto cols = index_cols(tab_name);
+        if (ix_manager_->exists(tab_name, cols)) {
+            ix_manager_->destroy_index(tab_name, cols);
+        }
+        ix_manager_->create_index(tab_name, cols);
+        auto ih = ix_manager_->open_index(tab_name, cols);
+
+        const int keys_per_thread = BENCH_TOTAL_KEYS / num_threads;
+        const int num_keys = keys_per_thread * num_threads;
+        std::atomic<int> insert_failures{0};
+        std::atomic<int> lookup_failures{0};
+
+        double insert_secs = run_threads(num_threads, [&](int t) {
+            Transaction txn(t);
+            std::vector<int> keys(keys_per_thread);
+            std::iota(keys.begin(), keys.end(), t * keys_per_thread);
+            std::shuffle(keys.begin(), keys.end(), std::default_random_engine(t));
+            for (int key : keys) {
+                Rid rid = {.page_no = key, .slot_no = key};
+                if (ih->insert_entry((const char *)&key, rid, &txn) == -1) {
+                    insert_failures++;
+                }
+            }
+        });
+
+        double lookup_secs = run_threads(num_threads, [&](int t) {
+            std::default_random_engine engine(t);
+            std::uniform_int_distribution<int> dist(0, num_keys - 1);
+            for (int i = 0; i < keys_per_thread * BENCH_LOOKUP_ROUNDS; i++) {
+                int key = dist(engine);
+                std::vector<Rid> result;
+                if (!ih->get_value((const char *)&key, &result, nullptr) || result[0].slot_no != key) {
+                    lookup_failures++;
+                }
+            }
+        });
+
+        printf("threads: %d  insert: %.0f ops/s  lookup: %.0f ops/s\n", num_threads, num_keys / insert_secs,
+               num_keys * BENCH_LOOKUP_ROUNDS / lookup_secs);
+        ASSERT_EQ(insert_failures.load(), 0);
+        ASSERT_EQ(lookup_failures.load(), 0);
+
+        ix_manager_->close_index(ih.get());
+        ix_manager_->del_index_from_buf(ih.get());  // 下一个索引文件可能复用同一个fd
+        ix_manager_->destroy_index(tab_name, cols);
+    }
+}
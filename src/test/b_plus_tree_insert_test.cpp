@@ -24,7 +24,10 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <functional>
+#include <map>
 #include <random>  // for std::default_random_engine
+#include <thread>  // NOLINT
 
 #include "gtest/gtest.h"
 
@@ -89,7 +92,7 @@ class BPlusTreeTests : public ::testing::Test {
         coldef.push_back({"col1", TYPE_INT, 4});
         coldef.push_back({"col2", TYPE_INT, 4});
         sm_->create_table(TEST_FILE_NAME, coldef, nullptr);
-        sm_->create_index(TEST_FILE_NAME, TEST_COL, nullptr);
+        sm_->create_index(TEST_FILE_NAME, TEST_COL, {}, false, nullptr);
         assert(ix_manager_->exists(TEST_FILE_NAME, TEST_COL));
         // 打开测试文件
         ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
@@ -626,3 +629,307 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     std::cout << "Insert keys count: " << add_cnt << '\n' << "Delete keys count: " << del_cnt << '\n';
     check_all(ih_.get(), mock);
 }
+
+/**
+ * @brief 大量删除后合并释放的结点进入空闲页面链表，重新打开索引后链表仍然有效，再次插入时优先复用空闲页面
+ */
+TEST_F(BPlusTreeTests, FreePageReuseTest) {
+    const int order = 4;
+    const int scale = 100;
+    const int delete_scale = 90;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::multimap<int, Rid> mock;
+    for (int key = 1; key <= scale; key++) {
+        Rid rid = {.page_no = 0, .slot_no = key};
+        bool insert_ret = ih_->insert_entry((const char *)&key, rid, txn_.get());
+        ASSERT_EQ(insert_ret, true);
+        mock.insert(std::make_pair(key, rid));
+    }
+    int num_pages = ih_->get_num_pages();
+    ASSERT_EQ(ih_->get_num_free_pages(), 0);
+
+    for (int key = 1; key <= delete_scale; key++) {
+        ASSERT_EQ(ih_->delete_entry((const char *)&key, txn_.get()), true);
+        mock.erase(key);
+    }
+    int num_free_pages = ih_->get_num_free_pages();
+    ASSERT_GT(num_free_pages, 0);
+    ASSERT_EQ(ih_->get_num_pages(), num_pages);
+    check_all(ih_.get(), mock);
+
+    // 空闲页面链表随文件头和页面一起持久化
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
+    ih_->file_hdr_->btree_order_ = order;
+    ASSERT_EQ(ih_->get_num_free_pages(), num_free_pages);
+
+    for (int key = 1; key <= delete_scale; key++) {
+        Rid rid = {.page_no = 0, .slot_no = key};
+        bool insert_ret = ih_->insert_entry((const char *)&key, rid, txn_.get());
+        ASSERT_EQ(insert_ret, true);
+        mock.insert(std::make_pair(key, rid));
+    }
+    // 新结点都来自空闲页面链表，文件没有变大
+    ASSERT_LT(ih_->get_num_free_pages(), num_free_pages);
+    ASSERT_EQ(ih_->get_num_pages(), num_pages);
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief 一个线程插入的同时, 多个线程不加锁地查找已经存在的key, 每次都必须找到正确的rid
+ */
+TEST_F(BPlusTreeTests, ConcurrentReadWhileInsertTest) {
+    const int scale = 4000;
+    const int num_readers = 4;
+
+    std::multimap<int, Rid> mock;
+    for (int key = 1; key <= scale / 2; key++) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        bool insert_ret = ih_->insert_entry((const char *)&key, rid, txn_.get());
+        ASSERT_EQ(insert_ret, true);
+        mock.insert(std::make_pair(key, rid));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < num_readers; i++) {
+        readers.emplace_back([&, i]() {
+            std::default_random_engine engine(i);
+            std::uniform_int_distribution<int> dist(1, scale / 2);
+            while (!stop.load()) {
+                int key = dist(engine);
+                std::vector<Rid> result;
+                if (!ih_->get_value((const char *)&key, &result, nullptr) || result[0].page_no != key ||
+                    result[0].slot_no != key) {
+                    wrong++;
+                }
+            }
+        });
+    }
+
+    // 读线程运行期间不能ASSERT提前返回, 否则线程不会被join; 失败的插入计数后在join之后检查
+    int failed_inserts = 0;
+    for (int key = scale / 2 + 1; key <= scale; key++) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        if (!ih_->insert_entry((const char *)&key, rid, txn_.get())) {
+            failed_inserts++;
+            continue;
+        }
+        mock.insert(std::make_pair(key, rid));
+    }
+    stop = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(failed_inserts, 0);
+    ASSERT_EQ(wrong.load(), 0);
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief CHAR字段的索引做前缀压缩, 随机插入和删除后检查每个结点的key都在fence key的范围内,
+ * 查找、lower_bound/upper_bound和扫描的结果与std::map一致, 重新打开索引后压缩仍然有效
+ */
+TEST_F(BPlusTreeTests, PrefixCompressionTest) {
+    const int key_len = 64;
+    const int scale = 6000;
+    const std::string tab_name = "table2";
+
+    ColMeta col;
+    col.tab_name = tab_name;
+    col.name = "col1";
+    col.type = TYPE_STRING;
+    col.len = key_len;
+    col.offset = 0;
+    col.index = true;
+    col.agg_type = ast::SV_AGG_NONE;
+    std::vector<ColMeta> cols = {col};
+    ix_manager_->create_index(tab_name, cols);
+    auto ih = ix_manager_->open_index(tab_name, cols);
+    ASSERT_TRUE(ih->file_hdr_->compress_keys_);
+
+    // 所有key有共同的前缀, 相邻的key只在最后几位数字上不同
+    auto make_key = [&](int n) {
+        std::string key(key_len, '\0');
+        std::string text = "customer-account-" + std::to_string(10000000 + n);
+        memcpy(key.data(), text.data(), text.size());
+        return key;
+    };
+
+    std::function<void(page_id_t, const std::string *, const std::string *)> check_fences =
+        [&](page_id_t page_no, const std::string *low, const std::string *high) {
+            IxNodeHandle *node = ih->fetch_node(page_no);
+            ASSERT_EQ(node->get_low_fence() != nullptr, low != nullptr);
+            ASSERT_EQ(node->get_high_fence() != nullptr, high != nullptr);
+            if (low != nullptr) {
+                ASSERT_EQ(memcmp(node->get_low_fence(), low->data(), key_len), 0);
+            }
+            if (high != nullptr) {
+                ASSERT_EQ(memcmp(node->get_high_fence(), high->data(), key_len), 0);
+            }
+            std::vector<std::string> keys(node->get_size(), std::string(key_len, '\0'));
+            for (int i = 0; i < node->get_size(); i++) {
+                node->copy_key(i, keys[i].data());
+                ASSERT_TRUE(i == 0 || keys[i - 1] < keys[i]);
+                ASSERT_TRUE(high == nullptr || keys[i] < *high);
+                // 内部结点的第0个key不参与查找, 只检查其他key
+                ASSERT_TRUE(low == nullptr || (!node->is_leaf_page() && i == 0) || *low <= keys[i]);
+            }
+            if (!node->is_leaf_page()) {
+                for (int i = 0; i < node->get_size(); i++) {
+                    const std::string *child_low = i == 0 ? low : &keys[i];
+                    const std::string *child_high = i + 1 == node->get_size() ? high : &keys[i + 1];
+                    check_fences(node->value_at(i), child_low, child_high);
+                }
+            }
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            delete node;
+        };
+
+    std::map<std::string, Rid> mock;
+    std::default_random_engine engine(0);
+    std::uniform_int_distribution<int> dist(0, scale * 2);
+    for (int i = 0; i < scale; i++) {
+        int n = dist(engine);
+        std::string key = make_key(n);
+        bool insert = mock.size() < scale / 2 || engine() % 3 != 0;
+        if (insert && mock.count(key) == 0) {
+            Rid rid = {.page_no = n, .slot_no = i};
+            ASSERT_NE(ih->insert_entry(key.data(), rid, txn_.get()), -1);
+            mock[key] = rid;
+        } else if (!insert && !mock.empty()) {
+            auto it = mock.lower_bound(key);
+            if (it == mock.end()) {
+                it = mock.begin();
+            }
+            ASSERT_TRUE(ih->delete_entry(it->first.data(), txn_.get()));
+            mock.erase(it);
+        }
+    }
+
+    auto check = [&]() {
+        check_fences(ih->file_hdr_->root_page_, nullptr, nullptr);
+        for (int n = 0; n <= scale * 2; n++) {
+            std::string key = make_key(n);
+            std::vector<Rid> result;
+            auto it = mock.find(key);
+            ASSERT_EQ(ih->get_value(key.data(), &result, nullptr), it != mock.end());
+            if (it != mock.end()) {
+                ASSERT_EQ(result[0], it->second);
+            }
+            auto mock_lower = mock.lower_bound(key);
+            if (mock_lower != mock.end()) {
+                ASSERT_EQ(ih->get_rid(ih->lower_bound(key.data())), mock_lower->second);
+            }
+            auto mock_upper = mock.upper_bound(key);
+            if (mock_upper != mock.end()) {
+                ASSERT_EQ(ih->get_rid(ih->upper_bound(key.data())), mock_upper->second);
+            }
+        }
+        IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        for (auto &entry : mock) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(scan.rid(), entry.second);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+    };
+    check();
+
+    // 每个结点都存了两个fence key, 压缩后key占用的空间仍然比不压缩时少, 叶子结点也更少
+    IxIndexStats stats = ih->get_stats();
+    ASSERT_EQ(stats.num_entries, mock.size());
+    ASSERT_GT(stats.prefix_bytes, 0);
+    ASSERT_GT(stats.key_bytes, stats.stored_key_bytes);
+    ASSERT_LT(stats.num_leaf_pages, (int)mock.size() / (ih->file_hdr_->btree_order_ / 2));
+
+    ix_manager_->close_index(ih.get());
+    ih = ix_manager_->open_index(tab_name, cols);
+    ASSERT_TRUE(ih->file_hdr_->compress_keys_);
+    check();
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 带INCLUDE字段的索引: INCLUDE字段接在key字段之后按字节比较, 唯一性只按key字段检查,
+ * 索引覆盖查询时从叶子结点中直接读出INCLUDE字段
+ */
+TEST_F(BPlusTreeTests, IncludeColumnsTest) {
+    const int scale = 3000;
+    const int payload_len = 16;
+    const std::string tab_name = "table3";
+
+    ColMeta key_col;
+    key_col.tab_name = tab_name;
+    key_col.name = "col1";
+    key_col.type = TYPE_INT;
+    key_col.len = sizeof(int);
+    key_col.offset = 0;
+    key_col.index = true;
+    key_col.agg_type = ast::SV_AGG_NONE;
+    ColMeta include_col = key_col;
+    include_col.name = "col2";
+    include_col.type = TYPE_STRING;  // SmManager::create_index()把INCLUDE字段按CHAR交给B+树
+    include_col.len = payload_len;
+    include_col.offset = sizeof(int);
+    std::vector<ColMeta> cols = {key_col, include_col};
+    ix_manager_->create_index(tab_name, cols);
+    auto ih = ix_manager_->open_index(tab_name, cols);
+    const int key_len = sizeof(int) + payload_len;
+
+    auto make_key = [&](int n, int payload) {
+        std::string key(key_len, '\0');
+        memcpy(key.data(), &n, sizeof(int));
+        std::string text = "payload-" + std::to_string(payload);
+        memcpy(key.data() + sizeof(int), text.data(), text.size());
+        return key;
+    };
+
+    // key字段取负数和正数, payload随机, 保证INCLUDE字段不影响按key字段的查找
+    std::map<int, std::pair<std::string, Rid>> mock;
+    std::default_random_engine engine(0);
+    std::uniform_int_distribution<int> dist(-scale, scale);
+    for (int i = 0; i < scale; i++) {
+        int n = dist(engine);
+        std::string key = make_key(n, engine() % 100000);
+        std::vector<Rid> result;
+        if (ih->get_value_by_prefix(key.data(), sizeof(int), &result, txn_.get())) {
+            ASSERT_TRUE(mock.count(n));
+            ASSERT_EQ(result[0], mock[n].second);
+            continue;
+        }
+        ASSERT_EQ(mock.count(n), 0);
+        Rid rid = {.page_no = n, .slot_no = i};
+        ASSERT_NE(ih->insert_entry(key.data(), rid, txn_.get()), -1);
+        mock[n] = {key, rid};
+    }
+
+    for (int n = -scale - 1; n <= scale + 1; n++) {
+        // INCLUDE部分填任意内容, 只比较前sizeof(int)个字节
+        std::string key = make_key(n, -1);
+        std::vector<Rid> result;
+        auto it = mock.find(n);
+        ASSERT_EQ(ih->get_value_by_prefix(key.data(), sizeof(int), &result, txn_.get()), it != mock.end());
+        if (it != mock.end()) {
+            ASSERT_EQ(result[0], it->second.second);
+        }
+    }
+
+    IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+    std::string key(key_len, '\0');
+    for (auto &entry : mock) {
+        ASSERT_FALSE(scan.is_end());
+        Rid rid;
+        ASSERT_TRUE(ih->read_entry(scan.iid(), key.data(), &rid));
+        ASSERT_EQ(key, entry.second.first);
+        ASSERT_EQ(rid, entry.second.second);
+        scan.next();
+    }
+    ASSERT_TRUE(scan.is_end());
+    ix_manager_->close_index(ih.get());
+}
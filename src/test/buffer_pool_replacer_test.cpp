@@ -0,0 +1,149 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/buffer_pool_manager.h"
+
+const std::string TEST_DB_NAME = "ReplacerBenchmark_db";  // 以数据库名作为根目录
+const std::string TEST_INDEX_FILE = "hot_index";          // 模拟B+树内部结点等被点查频繁访问的页
+const std::string TEST_TABLE_FILE = "big_table";          // 被全表扫描的大表, 其中前HOT_HEAP_PAGES页也会被点查访问
+
+constexpr int POOL_SIZE = 256;
+constexpr int HOT_INDEX_PAGES = 64;
+constexpr int HOT_HEAP_PAGES = 64;
+constexpr int TABLE_PAGES = 2048;
+constexpr int LOOKUP_THREADS = 4;
+constexpr int LOOKUPS_PER_THREAD = 50000;
+constexpr int FETCH_PER_SCANNED_PAGE = 3;  // 与RmScan + get_record一样, 扫描时同一页会被连续fetch多次
+
+/** 混合负载: 若干点查线程访问热点索引页和热点堆页, 同时一个线程反复顺序扫描整张大表
+ * 对每种置换策略分别运行, 输出整体命中率和热点页命中率
+ * 大表远大于缓冲池, 扫描到的每个冷页(page_no >= HOT_HEAP_PAGES)必然未命中一次,
+ * 因此热点页(索引页与前HOT_HEAP_PAGES个堆页)的未命中次数 = 总未命中次数 - 扫描过的冷页数 */
+class ReplacerBenchmark : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    int index_fd_ = -1;
+    int table_fd_ = -1;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        if (!disk_manager_->is_dir(TEST_DB_NAME)) {
+            disk_manager_->create_dir(TEST_DB_NAME);
+        }
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+        for (auto &name : {TEST_INDEX_FILE, TEST_TABLE_FILE}) {
+            if (disk_manager_->is_file(name)) {
+                disk_manager_->destroy_file(name);
+            }
+            disk_manager_->create_file(name);
+        }
+        index_fd_ = disk_manager_->open_file(TEST_INDEX_FILE);
+        table_fd_ = disk_manager_->open_file(TEST_TABLE_FILE);
+
+        // 用一个临时的缓冲池把两个文件的页分配出来
+        BufferPoolManager bpm(POOL_SIZE, disk_manager_.get());
+        for (auto [fd, num_pages] : {std::make_pair(index_fd_, HOT_INDEX_PAGES), std::make_pair(table_fd_, TABLE_PAGES)}) {
+            for (int i = 0; i < num_pages; i++) {
+                PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+                Page *page = bpm.new_page(&page_id);
+                snprintf(page->get_data(), PAGE_SIZE, "%d:%d", fd, i);
+                bpm.unpin_page(page_id, true);
+            }
+            bpm.flush_all_pages(fd);
+        }
+    }
+
+    void TearDown() override {
+        disk_manager_->close_file(index_fd_);
+        disk_manager_->close_file(table_fd_);
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        disk_manager_->destroy_dir(TEST_DB_NAME);
+    }
+
+    /**
+     * @description: 在指定置换策略下运行混合负载
+     * @return {double} 热点页的命中率
+     */
+    double run_workload(const std::string &replacer_type) {
+        BufferPoolManager bpm(POOL_SIZE, disk_manager_.get(), nullptr, replacer_type);
+        std::atomic<int> running_lookups(LOOKUP_THREADS);
+        size_t cold_scanned = 0;
+        size_t hot_scanned = 0;
+
+        std::thread scanner([&]() {
+            while (running_lookups.load() > 0) {
+                for (int page_no = 0; page_no < TABLE_PAGES && running_lookups.load() > 0; page_no++) {
+                    for (int i = 0; i < FETCH_PER_SCANNED_PAGE; i++) {
+                        bpm.fetch_page(PageId{table_fd_, page_no});
+                        bpm.unpin_page(PageId{table_fd_, page_no}, false);
+                    }
+                    if (page_no < HOT_HEAP_PAGES) {
+                        hot_scanned++;
+                    } else {
+                        cold_scanned++;
+                    }
+                }
+            }
+        });
+
+        std::vector<std::thread> lookups;
+        for (int t = 0; t < LOOKUP_THREADS; t++) {
+            lookups.emplace_back([&, t]() {
+                std::mt19937 rng(t);
+                for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+                    // 一次点查: 经过一个索引页, 再回表读取一个堆页
+                    PageId index_page = {index_fd_, static_cast<int>(rng() % HOT_INDEX_PAGES)};
+                    PageId heap_page = {table_fd_, static_cast<int>(rng() % HOT_HEAP_PAGES)};
+                    bpm.fetch_page(index_page);
+                    bpm.fetch_page(heap_page);
+                    bpm.unpin_page(heap_page, false);
+                    bpm.unpin_page(index_page, false);
+                }
+                running_lookups--;
+            });
+        }
+        for (auto &th : lookups) {
+            th.join();
+        }
+        scanner.join();
+
+        size_t hits, misses;
+        bpm.get_stats(&hits, &misses);
+        size_t hot_fetches = 2 * LOOKUP_THREADS * LOOKUPS_PER_THREAD + FETCH_PER_SCANNED_PAGE * hot_scanned;
+        double hot_hit_ratio = 1 - static_cast<double>(misses - cold_scanned) / hot_fetches;
+        std::cout << "replacer: " << replacer_type << " overall hit ratio: " << bpm.get_hit_ratio()
+                  << " hot page hit ratio: " << hot_hit_ratio << " scanned pages: " << cold_scanned + hot_scanned
+                  << std::endl;
+        return hot_hit_ratio;
+    }
+};
+
+/**
+ * 只输出各置换策略的命中率供比较, 不作为通过条件: 扫描线程与点查线程的交错由调度决定, 每次运行的结果不同
+ */
+TEST_F(ReplacerBenchmark, MixedScanAndLookup) {
+    for (auto &replacer_type : {"LRU", "LRUK", "CLOCK"}) {
+        run_workload(replacer_type);
+    }
+}
@@ -0,0 +1,157 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <cstdio>
+
+#include "execution/csv_loader.h"
+#include "gtest/gtest.h"
+#include "index/ix.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+#include "system/sm.h"
+
+const std::string TEST_DB_NAME = "CsvLoaderTest_db";  // 测试数据库, 结束时删除
+const std::string TEST_FILE_NAME = "table1";          // 表名, 表有两个int列col1和col2
+const std::string TEST_CSV_NAME = "load_test.csv";    // 测试过程中生成的CSV文件, 结束时删除
+
+/** 每个测试点新建并打开数据库TEST_DB_NAME, 在其中建立表TEST_FILE_NAME, 把CSV文件解析后写入这张表 */
+class CsvLoaderTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_;
+    std::unique_ptr<SmManager> sm_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_.get(), ix_manager_.get());
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            sm_->drop_db(TEST_DB_NAME);
+        }
+        sm_->create_db(TEST_DB_NAME);
+        sm_->open_db(TEST_DB_NAME);
+        std::vector<ColDef> coldef;
+        coldef.push_back({"col1", TYPE_INT, 4});
+        coldef.push_back({"col2", TYPE_INT, 4});
+        sm_->create_table(TEST_FILE_NAME, coldef, nullptr);
+    }
+
+    void TearDown() override {
+        remove(TEST_CSV_NAME.c_str());
+        sm_->close_db();
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        sm_->drop_db(TEST_DB_NAME);
+    }
+};
+
+/**
+ * @brief 用CsvLoader读取跨越多个块的CSV文件, 成批写入表中, 记录的内容和顺序与文件一致
+ */
+TEST_F(CsvLoaderTest, LoadIntoTable) {
+    const int scale = 600000;  // 文件大于LOAD_CHUNK_SIZE
+    auto fh = sm_->fhs_.at(TEST_FILE_NAME).get();
+    auto &cols = sm_->db_.get_table(TEST_FILE_NAME).cols;
+
+    FILE *csv = fopen(TEST_CSV_NAME.c_str(), "w");
+    fprintf(csv, "col1,col2\n");
+    for (int i = 0; i < scale; i++) {
+        // 混用\n和\r\n换行
+        fprintf(csv, i % 3 == 0 ? "%d,%d\r\n" : "%d,%d\n", i, -i);
+    }
+    fclose(csv);
+
+    std::vector<Rid> rids;
+    {
+        CsvLoader loader(TEST_CSV_NAME, cols, fh->get_file_hdr().record_size);
+        CsvLoader::Batch batch;
+        int num_batches = 0;
+        while (loader.next(&batch)) {
+            num_batches++;
+            size_t offset = rids.size();
+            rids.resize(offset + batch.num_records);
+            fh->insert_load_records(batch.records.data(), batch.num_records, rids.data() + offset);
+        }
+        ASSERT_GT(num_batches, 1);
+    }
+    fh->finish_load();
+    ASSERT_EQ(rids.size(), (size_t)scale);
+    for (int i = 0; i < scale; i++) {
+        auto rec = fh->get_record(rids[i], nullptr);
+        ASSERT_EQ(*(int *)(rec->data + cols[0].offset), i);
+        ASSERT_EQ(*(int *)(rec->data + cols[1].offset), -i);
+    }
+
+    // 再次load时从上一次最后一个未满的页面继续写
+    Rid rid;
+    fh->insert_load_records(fh->get_record(rids[1], nullptr)->data, 1, &rid);
+    fh->finish_load();
+    if (scale % fh->get_file_hdr().num_records_per_page != 0) {
+        ASSERT_EQ(rid.page_no, rids.back().page_no);
+    }
+    ASSERT_EQ(*(int *)(fh->get_record(rid, nullptr)->data + cols[0].offset), 1);
+
+    // 字段数与表的列数不一致
+    csv = fopen(TEST_CSV_NAME.c_str(), "w");
+    fprintf(csv, "col1,col2\n1,2\n3,4,5\n");
+    fclose(csv);
+    CsvLoader loader(TEST_CSV_NAME, cols, fh->get_file_hdr().record_size);
+    CsvLoader::Batch batch;
+    ASSERT_THROW(loader.next(&batch), InvalidValueCountError);
+}
+
+/**
+ * @brief 空闲链表上有多个未满的页面时, 成批写入依次填满链表上的每个页面, 链表用完后才分配新页面
+ */
+TEST_F(CsvLoaderTest, LoadFillsFreePages) {
+    auto fh = sm_->fhs_.at(TEST_FILE_NAME).get();
+    int per_page = fh->get_file_hdr().num_records_per_page;
+    int record_size = fh->get_file_hdr().record_size;
+    std::vector<Rid> rids;
+    for (int i = 0; i < 3 * per_page; i++) {
+        int rec[2] = {i, -i};
+        rids.push_back(fh->insert_record((char *)rec, nullptr));
+    }
+    ASSERT_EQ(fh->get_file_hdr().first_free_page_no, RM_NO_PAGE);
+
+    // 先在第一个页面、再在第二个页面上各删除两条记录, 空闲链表为第二个页面 -> 第一个页面
+    std::vector<Rid> holes = {rids[per_page], rids[per_page + 1], rids[0], rids[1]};
+    for (int i : {0, 1, per_page, per_page + 1}) {
+        fh->delete_record(rids[i], nullptr);
+    }
+    ASSERT_EQ(fh->get_file_hdr().first_free_page_no, rids[per_page].page_no);
+    int num_pages = fh->get_file_hdr().num_pages;
+
+    // 两个页面的空位写满后, 最后一条记录写到新页面上
+    const int num_records = (int)holes.size() + 1;
+    std::vector<char> buf((size_t)num_records * record_size);
+    for (int i = 0; i < num_records; i++) {
+        int rec[2] = {3 * per_page + i, -(3 * per_page + i)};
+        memcpy(buf.data() + (size_t)i * record_size, rec, sizeof(rec));
+    }
+    std::vector<Rid> loaded(num_records);
+    fh->insert_load_records(buf.data(), num_records, loaded.data());
+    fh->finish_load();
+    for (size_t i = 0; i < holes.size(); i++) {
+        ASSERT_EQ(loaded[i], holes[i]);
+    }
+    ASSERT_EQ(fh->get_file_hdr().num_pages, num_pages + 1);
+    ASSERT_EQ(fh->get_file_hdr().first_free_page_no, loaded.back().page_no);
+    for (int i = 0; i < num_records; i++) {
+        ASSERT_EQ(*(int *)fh->get_record(loaded[i], nullptr)->data, 3 * per_page + i);
+    }
+}
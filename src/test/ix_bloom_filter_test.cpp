@@ -0,0 +1,176 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <atomic>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "index/ix.h"
+#include "storage/buffer_pool_manager.h"
+#include "transaction/transaction.h"
+
+const std::string TEST_DB_NAME = "IxBloomFilterTest_db";  // 测试过程中的索引和过滤器文件都放在这个目录下, 结束时删除
+const std::string TEST_FILE_NAME = "table1";              // 索引文件名的前缀
+
+/** 每个测试点在目录TEST_DB_NAME下建立一个int类型单列的B+树索引, 测试索引上的布隆过滤器 */
+class IxBloomFilterTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<IxIndexHandle> ih_;
+    std::unique_ptr<Transaction> txn_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        txn_ = std::make_unique<Transaction>(0);
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            disk_manager_->destroy_dir(TEST_DB_NAME);
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+        ix_manager_->create_index(TEST_FILE_NAME, index_cols());
+        ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_cols());
+    }
+
+    void TearDown() override {
+        ix_manager_->close_index(ih_.get());
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        disk_manager_->destroy_dir(TEST_DB_NAME);
+    }
+
+    std::vector<ColMeta> index_cols() {
+        ColMeta col;
+        col.tab_name = TEST_FILE_NAME;
+        col.name = "col1";
+        col.type = TYPE_INT;
+        col.len = sizeof(int);
+        col.offset = 0;
+        col.index = true;
+        col.agg_type = ast::SV_AGG_NONE;
+        return {col};
+    }
+};
+
+/**
+ * @brief 索引上的布隆过滤器不漏掉任何已插入的key, 对不存在的key误判率在设计范围内
+ * 扫描索引重建、逐条插入、扩容和保存后读入得到的过滤器都要满足
+ */
+TEST_F(IxBloomFilterTest, RebuildGrowAndPersist) {
+    const int scale = 20000;
+    for (int key = 0; key < scale; key++) {
+        ih_->insert_entry((const char *)&key, Rid{key, key}, txn_.get());
+    }
+    // 从索引中现有的key建立, 容量比key的数量少, 之后插入的key直接加进过滤器
+    ih_->rebuild_bloom_filter(sizeof(int), 0);
+    auto bloom = ih_->get_bloom_filter();
+    ASSERT_LT(bloom->capacity(), (size_t)scale);
+    for (int key = scale; key < 2 * scale; key++) {
+        ih_->insert_entry((const char *)&key, Rid{key, key}, txn_.get());
+    }
+    ih_->grow_bloom_filter();
+    bloom = ih_->get_bloom_filter();
+    ASSERT_GE(bloom->capacity(), (size_t)2 * scale);
+
+    auto check = [&](const IxBloomFilter *filter) {
+        for (int key = 0; key < 2 * scale; key++) {
+            ASSERT_TRUE(filter->may_contain((const char *)&key));
+        }
+        int false_positives = 0;
+        for (int key = 2 * scale; key < 4 * scale; key++) {
+            false_positives += filter->may_contain((const char *)&key);
+        }
+        ASSERT_LT(false_positives, 2 * scale * 3 / 100);
+    };
+    check(bloom);
+    for (int key = 0; key < 2 * scale; key++) {
+        ASSERT_TRUE(ih_->may_contain((const char *)&key));
+    }
+
+    const std::string bloom_name = TEST_FILE_NAME + ".bloom";
+    bloom->save(bloom_name);
+    ASSERT_EQ(IxBloomFilter::load(bloom_name, sizeof(int) + 1), nullptr);
+    auto loaded = IxBloomFilter::load(bloom_name, sizeof(int));
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_EQ(loaded->num_added(), bloom->num_added());
+    check(loaded.get());
+}
+
+/**
+ * @brief 逐条插入的key远超过滤器的初始容量, 插入时换上更大的过滤器, 误判率仍在设计范围内
+ * 多个线程并发插入时另一个线程检查已插入的key, 换过滤器期间也不会漏掉
+ */
+TEST_F(IxBloomFilterTest, GrowOnInsert) {
+    const int scale = 100000;
+    const int num_threads = 4;
+    ih_->rebuild_bloom_filter(sizeof(int), 0);
+    size_t init_capacity = ih_->get_bloom_filter()->capacity();
+    ASSERT_LT(init_capacity * 10, (size_t)scale);
+
+    // 第t个线程插入key t, t + num_threads, ..., inserted[t]为已插入的个数
+    std::atomic<int> inserted[num_threads];
+    for (auto &n : inserted) {
+        n = 0;
+    }
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        std::default_random_engine engine(0);
+        while (!done) {
+            int t = engine() % num_threads;
+            int n = inserted[t].load();
+            if (n > 0) {
+                int key = (int)(engine() % n) * num_threads + t;
+                ASSERT_TRUE(ih_->may_contain((const char *)&key));
+            }
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; t++) {
+        writers.emplace_back([&, t]() {
+            for (int key = t; key < scale; key += num_threads) {
+                ih_->insert_entry((const char *)&key, Rid{key, key}, txn_.get());
+                inserted[t]++;
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    ASSERT_GT(ih_->get_bloom_filter()->capacity(), init_capacity);
+    for (int key = 0; key < scale; key++) {
+        ASSERT_TRUE(ih_->may_contain((const char *)&key));
+    }
+    int false_positives = 0;
+    for (int key = scale; key < 2 * scale; key++) {
+        false_positives += ih_->may_contain((const char *)&key);
+    }
+    ASSERT_LT(false_positives, scale * 3 / 100);
+
+    // 换过过滤器后不保存到文件, 合并成一个后才保存
+    const std::string bloom_name = TEST_FILE_NAME + ".bloom";
+    ih_->save_bloom_filter(bloom_name);
+    ASSERT_FALSE(disk_manager_->is_file(bloom_name));
+    ih_->grow_bloom_filter();
+    ASSERT_GE(ih_->get_bloom_filter()->capacity(), (size_t)scale);
+    ih_->save_bloom_filter(bloom_name);
+    ASSERT_TRUE(disk_manager_->is_file(bloom_name));
+}
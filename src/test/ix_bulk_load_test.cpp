@@ -0,0 +1,235 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <map>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // 检查树的结构时要访问file_hdr_和fetch_node()
+
+#include "storage/buffer_pool_manager.h"
+#include "transaction/transaction.h"
+
+const std::string TEST_DB_NAME = "IxBulkLoadTest_db";  // 测试过程中的索引和排序文件都放在这个目录下, 结束时删除
+const std::string TEST_FILE_NAME = "table1";           // 索引文件名的前缀
+
+/** 每个测试点在目录TEST_DB_NAME下建立一个int类型单列的B+树索引, 只通过IxManager和IxIndexHandle访问 */
+class IxBulkLoadTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<IxIndexHandle> ih_;
+    std::unique_ptr<Transaction> txn_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        txn_ = std::make_unique<Transaction>(0);
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            disk_manager_->destroy_dir(TEST_DB_NAME);
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+        ix_manager_->create_index(TEST_FILE_NAME, index_cols());
+        ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_cols());
+    }
+
+    void TearDown() override {
+        ix_manager_->close_index(ih_.get());
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        disk_manager_->destroy_dir(TEST_DB_NAME);
+    }
+
+    std::vector<ColMeta> index_cols() {
+        ColMeta col;
+        col.tab_name = TEST_FILE_NAME;
+        col.name = "col1";
+        col.type = TYPE_INT;
+        col.len = sizeof(int);
+        col.offset = 0;
+        col.index = true;
+        col.agg_type = ast::SV_AGG_NONE;
+        return {col};
+    }
+
+    /**
+     * @brief 检查叶子层的前驱指针和后继指针
+     *
+     * @param ih
+     */
+    void check_leaf(const IxIndexHandle *ih) {
+        // check leaf list
+        page_id_t leaf_no = ih->file_hdr_->first_leaf_;
+        while (leaf_no != IX_LEAF_HEADER_PAGE) {
+            IxNodeHandle *curr = ih->fetch_node(leaf_no);
+            IxNodeHandle *prev = ih->fetch_node(curr->get_prev_leaf());
+            IxNodeHandle *next = ih->fetch_node(curr->get_next_leaf());
+            // Ensure prev->next == curr && next->prev == curr
+            ASSERT_EQ(prev->get_next_leaf(), leaf_no);
+            ASSERT_EQ(next->get_prev_leaf(), leaf_no);
+            leaf_no = curr->get_next_leaf();
+            buffer_pool_manager_->unpin_page(curr->get_page_id(), false);
+            buffer_pool_manager_->unpin_page(prev->get_page_id(), false);
+            buffer_pool_manager_->unpin_page(next->get_page_id(), false);
+        }
+    }
+
+    /**
+     * @brief dfs遍历整个树，检查孩子结点的第一个和最后一个key是否正确
+     *
+     * @param ih 树
+     * @param now_page_no 当前遍历到的结点
+     */
+    void check_tree(const IxIndexHandle *ih, int now_page_no) {
+        IxNodeHandle *node = ih->fetch_node(now_page_no);
+        if (node->is_leaf_page()) {
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            return;
+        }
+        for (int i = 0; i < node->get_size(); i++) {                 // 遍历node的所有孩子
+            IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
+            // check parent
+            assert(child->get_parent_page_no() == now_page_no);
+            // check first key
+            int node_key = node->key_at(i);  // node的第i个key
+            int child_first_key = child->key_at(0);
+            int child_last_key = child->key_at(child->get_size() - 1);
+            if (i != 0) {
+                // 除了第0个key之外，node的第i个key与其第i个孩子的第0个key的值相同
+                ASSERT_EQ(node_key, child_first_key);
+            }
+            if (i + 1 < node->get_size()) {
+                // 满足制约大小关系
+                ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
+            }
+
+            buffer_pool_manager_->unpin_page(child->get_page_id(), false);
+
+            check_tree(ih, node->value_at(i));  // 递归子树
+        }
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    }
+
+    /**
+     * @brief
+     *
+     * @param ih
+     * @param mock 函数外部记录插入/删除后的(key,rid)
+     */
+    void check_all(IxIndexHandle *ih, const std::multimap<int, Rid> &mock) {
+        check_tree(ih, ih->file_hdr_->root_page_);
+        if (!ih->is_empty()) {
+            check_leaf(ih);
+        }
+
+        for (auto &entry : mock) {
+            int mock_key = entry.first;
+            // test lower bound
+            {
+                auto mock_lower = mock.lower_bound(mock_key);        // multimap的lower_bound方法
+                Iid iid = ih->lower_bound((const char *)&mock_key);  // IxIndexHandle的lower_bound方法
+                Rid rid = ih->get_rid(iid);
+                ASSERT_EQ(rid, mock_lower->second);
+            }
+            // test upper bound
+            {
+                auto mock_upper = mock.upper_bound(mock_key);
+                Iid iid = ih->upper_bound((const char *)&mock_key);
+                if (iid != ih->leaf_end()) {
+                    Rid rid = ih->get_rid(iid);
+                    ASSERT_EQ(rid, mock_upper->second);
+                }
+            }
+        }
+
+        // test scan
+        IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        auto it = mock.begin();
+        int leaf_no = ih->file_hdr_->first_leaf_;
+        assert(leaf_no == scan.iid().page_no);
+        // 注意在scan里面是iid的slot_no进行自增
+        while (!scan.is_end() && it != mock.end()) {
+            Rid mock_rid = it->second;
+            Rid rid = scan.rid();
+            ASSERT_EQ(rid, mock_rid);
+            // go to next slot_no
+            it++;
+            scan.next();
+        }
+        ASSERT_EQ(scan.is_end(), true);
+        ASSERT_EQ(it, mock.end());
+    }
+};
+
+/**
+ * @brief 外部排序后自底向上批量建立B+树: 排序时内存很小, 产生多个有序段; 重复的key只保留最先加入的
+ * 建好后的树要满足与逐条插入得到的树相同的结构约束, 之后还能正常插入删除
+ */
+TEST_F(IxBulkLoadTest, SortAndBuild) {
+    const int scale = 30000;
+    const int order = 32;
+    ASSERT_TRUE(ih_->can_bulk_load());
+    // 一个结点最多order个键值对, 树有多层内部结点
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::multimap<int, Rid> mock;
+    std::default_random_engine engine(0);
+    std::uniform_int_distribution<int> dist(-scale * 2, scale * 2);
+    IxExternalSorter sorter(ih_->file_hdr_, TEST_FILE_NAME + ".sort", 64 * 1024);
+    for (int i = 0; i < scale; i++) {
+        int key = dist(engine);
+        Rid rid = {.page_no = key, .slot_no = i};
+        sorter.add((const char *)&key, rid);
+        if (mock.count(key) == 0) {
+            mock.emplace(key, rid);
+        }
+    }
+    sorter.finish();
+    ASSERT_GT(sorter.num_runs(), 1);
+    ASSERT_EQ(ih_->bulk_load(&sorter), mock.size());
+    ASSERT_FALSE(ih_->can_bulk_load());
+    check_all(ih_.get(), mock);
+    for (auto &entry : mock) {
+        std::vector<Rid> result;
+        ASSERT_TRUE(ih_->get_value((const char *)&entry.first, &result, txn_.get()));
+        ASSERT_EQ(result[0], entry.second);
+    }
+
+    // 批量建立的结点有空位, 插入后再删除一半
+    for (int i = 0; i < scale / 2; i++) {
+        int key = dist(engine);
+        Rid rid = {.page_no = key, .slot_no = scale + i};
+        if (ih_->insert_entry((const char *)&key, rid, txn_.get()) != -1) {
+            mock.emplace(key, rid);
+        }
+    }
+    check_all(ih_.get(), mock);
+    for (auto it = mock.begin(); it != mock.end();) {
+        if (engine() % 2) {
+            ASSERT_TRUE(ih_->delete_entry((const char *)&it->first, txn_.get()));
+            it = mock.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    check_all(ih_.get(), mock);
+}
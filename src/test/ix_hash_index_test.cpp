@@ -0,0 +1,148 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <map>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "index/ix.h"
+#include "storage/buffer_pool_manager.h"
+#include "transaction/transaction.h"
+
+const std::string TEST_DB_NAME = "IxHashIndexTest_db";  // 测试过程中的索引文件都放在这个目录下, 结束时删除
+const std::string TEST_FILE_NAME = "table1";            // 索引文件名的前缀
+
+/** 每个测试点在目录TEST_DB_NAME下建立一个可扩展哈希索引, 只通过IxManager和IxHashHandle访问 */
+class IxHashIndexTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<Transaction> txn_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        txn_ = std::make_unique<Transaction>(0);
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            disk_manager_->destroy_dir(TEST_DB_NAME);
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        disk_manager_->destroy_dir(TEST_DB_NAME);
+    }
+
+    std::vector<ColMeta> index_cols(const std::string &tab_name) {
+        ColMeta col;
+        col.tab_name = tab_name;
+        col.name = "col1";
+        col.type = TYPE_INT;
+        col.len = sizeof(int);
+        col.offset = 0;
+        col.index = true;
+        col.agg_type = ast::SV_AGG_NONE;
+        return {col};
+    }
+};
+
+/**
+ * @brief 可扩展哈希索引: 插入时桶分裂、目录翻倍, 删除后查找, 关闭后重新打开目录和桶都能从文件中读回
+ * 多个线程并发插入不同的key时, 分裂不会丢失其他线程插入的键值对
+ */
+TEST_F(IxHashIndexTest, InsertDeleteAndReopen) {
+    const int scale = 20000;
+    const int num_threads = 4;
+    auto cols = index_cols(TEST_FILE_NAME);
+    ix_manager_->create_hash_index(TEST_FILE_NAME, cols);
+    auto ih = ix_manager_->open_hash_index(TEST_FILE_NAME, cols);
+
+    std::map<int, Rid> mock;
+    std::default_random_engine engine(0);
+    std::uniform_int_distribution<int> dist(-scale * 4, scale * 4);
+    for (int i = 0; i < scale; i++) {
+        int n = dist(engine);
+        Rid rid = {.page_no = n, .slot_no = i};
+        page_id_t page_no = ih->insert_entry((const char *)&n, rid, txn_.get());
+        ASSERT_EQ(page_no == -1, mock.count(n) == 1);
+        mock.emplace(n, rid);
+    }
+    ASSERT_GT(ih->get_global_depth(), 0);
+
+    auto check_all = [&](IxHashHandle *ih) {
+        for (int n = -scale * 4 - 1; n <= scale * 4 + 1; n++) {
+            std::vector<Rid> result;
+            auto it = mock.find(n);
+            ASSERT_EQ(ih->get_value((const char *)&n, &result, txn_.get()), it != mock.end());
+            if (it != mock.end()) {
+                ASSERT_EQ(result.size(), 1);
+                ASSERT_EQ(result[0], it->second);
+            }
+        }
+        ASSERT_EQ(ih->get_stats().num_entries, mock.size());
+    };
+    check_all(ih.get());
+
+    // 删除一半的key
+    for (auto it = mock.begin(); it != mock.end();) {
+        if (engine() % 2) {
+            ASSERT_TRUE(ih->delete_entry((const char *)&it->first, txn_.get()));
+            ASSERT_FALSE(ih->delete_entry((const char *)&it->first, txn_.get()));
+            it = mock.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    check_all(ih.get());
+
+    // 关闭后重新打开
+    int global_depth = ih->get_global_depth();
+    ix_manager_->close_index(ih.get());
+    ix_manager_->del_index_from_buf(ih.get());
+    ih = ix_manager_->open_hash_index(TEST_FILE_NAME, cols);
+    ASSERT_EQ(ih->get_global_depth(), global_depth);
+    check_all(ih.get());
+
+    // 并发插入互不相同的key, 其间有桶分裂和目录翻倍
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < scale; i++) {
+                int n = scale * 4 + 2 + i * num_threads + t;
+                Rid rid = {.page_no = n, .slot_no = t};
+                ih->insert_entry((const char *)&n, rid, txn_.get());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < scale; i++) {
+            int n = scale * 4 + 2 + i * num_threads + t;
+            std::vector<Rid> result;
+            ASSERT_TRUE(ih->get_value((const char *)&n, &result, txn_.get()));
+            ASSERT_EQ(result[0], (Rid{.page_no = n, .slot_no = t}));
+        }
+    }
+    ASSERT_EQ(ih->get_stats().num_entries, mock.size() + scale * num_threads);
+    ix_manager_->close_index(ih.get());
+}
@@ -0,0 +1,164 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "index/ix.h"
+#include "record/rm.h"
+#include "storage/buffer_pool_manager.h"
+#include "system/sm.h"
+
+const std::string TEST_DB_NAME = "SmOnlineIndexTest_db";  // 测试数据库, 结束时删除
+const std::string TEST_FILE_NAME = "table1";              // 表名, 表有两个int列col1和col2
+
+/** 每个测试点新建并打开数据库TEST_DB_NAME, 在其中建立表TEST_FILE_NAME, 通过SmManager建立索引 */
+class SmOnlineIndexTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<RmManager> rm_;
+    std::unique_ptr<SmManager> sm_;
+    std::unique_ptr<Transaction> txn_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get(), nullptr);
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        rm_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_.get(), ix_manager_.get());
+        txn_ = std::make_unique<Transaction>(0);
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            sm_->drop_db(TEST_DB_NAME);
+        }
+        sm_->create_db(TEST_DB_NAME);
+        sm_->open_db(TEST_DB_NAME);
+        std::vector<ColDef> coldef;
+        coldef.push_back({"col1", TYPE_INT, 4});
+        coldef.push_back({"col2", TYPE_INT, 4});
+        sm_->create_table(TEST_FILE_NAME, coldef, nullptr);
+    }
+
+    void TearDown() override {
+        sm_->close_db();
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        sm_->drop_db(TEST_DB_NAME);
+    }
+
+    /**
+     * @description: 按key的顺序扫描索引, 键值对与mock一致; mock中的每个key都能点查到, 过滤器也不会漏掉
+     */
+    void check_index(IxIndexHandle *ih, const std::multimap<int, Rid> &mock) {
+        IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        for (auto &entry : mock) {
+            ASSERT_FALSE(scan.is_end());
+            ASSERT_EQ(scan.rid(), entry.second);
+            scan.next();
+        }
+        ASSERT_TRUE(scan.is_end());
+        for (auto &entry : mock) {
+            std::vector<Rid> result;
+            ASSERT_TRUE(ih->may_contain((const char *)&entry.first));
+            ASSERT_TRUE(ih->get_value((const char *)&entry.first, &result, txn_.get()));
+            ASSERT_EQ(result[0], entry.second);
+        }
+    }
+};
+
+/**
+ * @brief 在线建立索引的同时另一个线程修改表中的记录, 建好后索引与表的内容一致
+ * 写线程按执行算子的做法: 持有元数据读锁, 索引已发布时直接维护索引, 否则只记到旁路日志
+ */
+TEST_F(SmOnlineIndexTest, ConcurrentWrites) {
+    const int scale = 20000;
+    const std::vector<std::string> index_col = {"col2"};
+    auto fh = sm_->fhs_.at(TEST_FILE_NAME).get();
+    Transaction writer_txn(1);
+    Context context(nullptr, nullptr, txn_.get());
+
+    // 新索引建在col2上, col2的值各不相同
+    std::multimap<int, Rid> mock;
+    int next_val = 0;
+    for (int i = 0; i < scale; i++) {
+        int rec[2] = {i, next_val};
+        mock.emplace(next_val++, fh->insert_record((char *)rec, nullptr));
+    }
+
+    auto build = sm_->create_index(TEST_FILE_NAME, index_col, {}, false, &context);
+    ASSERT_TRUE(sm_->is_index_building(TEST_FILE_NAME));
+    std::string ix_name = ix_manager_->get_index_name(TEST_FILE_NAME, build->get_index_meta().cols);
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        std::default_random_engine engine(0);
+        for (int i = 0; i < scale || !done; i++) {
+            std::shared_lock<MetaLatch> guard(sm_->meta_latch_);
+            IxHandle *ih = nullptr;
+            if (sm_->db_.get_table(TEST_FILE_NAME).is_index(index_col)) {
+                ih = sm_->ihs_.at(ix_name).get();
+            }
+            int op = engine() % 3;
+            if (op == 0) {
+                int rec[2] = {i, next_val};
+                Rid rid = fh->insert_record((char *)rec, nullptr);
+                if (ih != nullptr) {
+                    ih->insert_entry((const char *)&rec[1], rid, &writer_txn);
+                } else {
+                    sm_->log_index_write(TEST_FILE_NAME, true, (const char *)rec, rid);
+                }
+                mock.emplace(next_val++, rid);
+                continue;
+            }
+            auto it = mock.lower_bound(engine() % next_val);
+            if (it == mock.end()) {
+                continue;
+            }
+            Rid rid = it->second;
+            auto old_rec = fh->get_record(rid, nullptr);
+            if (op == 1) {
+                fh->delete_record(rid, nullptr);
+                if (ih != nullptr) {
+                    ih->delete_entry(old_rec->data + sizeof(int), &writer_txn);
+                } else {
+                    sm_->log_index_write(TEST_FILE_NAME, false, old_rec->data, rid);
+                }
+                mock.erase(it);
+                continue;
+            }
+            int new_rec[2] = {i, next_val};
+            fh->update_record(rid, (char *)new_rec, nullptr);
+            if (ih != nullptr) {
+                ih->delete_entry(old_rec->data + sizeof(int), &writer_txn);
+                ih->insert_entry((const char *)&new_rec[1], rid, &writer_txn);
+            } else {
+                sm_->log_index_write(TEST_FILE_NAME, false, old_rec->data, rid);
+                sm_->log_index_write(TEST_FILE_NAME, true, (const char *)new_rec, rid);
+            }
+            mock.erase(it);
+            mock.emplace(next_val++, rid);
+        }
+    });
+    sm_->build_index(build, &context);
+    done = true;
+    writer.join();
+
+    ASSERT_TRUE(sm_->db_.get_table(TEST_FILE_NAME).is_index(index_col));
+    auto ih = static_cast<IxIndexHandle *>(sm_->ihs_.at(ix_name).get());
+    ASSERT_NE(ih->get_bloom_filter(), nullptr);
+    check_index(ih, mock);
+}
@@ -115,6 +115,8 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
     // 4. 把事务日志刷入磁盘中
     // 5. 更新事务状态
     assert(txn->get_state() != TransactionState::COMMITTED);
+    // 回滚也会修改表中的记录, 与其他写操作一样持有元数据读锁, 并记到正在在线建立的索引的旁路日志中
+    std::shared_lock<MetaLatch> meta_guard(sm_manager_->meta_latch_);
     auto write_set = txn->get_write_set();
     while (!write_set->empty()) {
         auto &item = write_set->back();
@@ -147,6 +149,7 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
             
             // TODO: 这里的nullptr后续需要替换
             fh->delete_record(item->GetRid(), nullptr);
+            sm_manager_->log_index_write(item->GetTableName(), false, Tuple->data, item->GetRid());
         }
         else if(item->GetWriteType() == WType::DELETE_TUPLE){
             auto fh = sm_manager_->fhs_.at(item->GetTableName()).get();
@@ -173,6 +176,7 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
                 sm_manager_->get_bpm()->unpin_page({fh->GetFd(), item->GetRid().page_no}, true);
             }
             fh->insert_record(item->GetRid(), item->GetRecord().data);
+            sm_manager_->log_index_write(item->GetTableName(), true, item->GetRecord().data, item->GetRid());
         }
         else if(item->GetWriteType() == WType::UPDATE_TUPLE){
             auto fh = sm_manager_->fhs_.at(item->GetTableName()).get();
@@ -208,6 +212,8 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
 
             // TODO: 这里的nullptr后续需要替换
             fh->update_record(item->GetRid(), item->GetRecord().data, nullptr);
+            sm_manager_->log_index_write(item->GetTableName(), false, Tuple->data, item->GetRid());
+            sm_manager_->log_index_write(item->GetTableName(), true, item->GetRecord().data, item->GetRid());
         }
         else assert(0);
         write_set->pop_back();
@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <random>
@@ -33,7 +34,12 @@ See the Mulan PSL v2 for more details. */
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "execution/load_scheduler.h"
+#include "index/ix_simd_search.h"
+#include "replacer/clock_replacer.h"
+#include "replacer/lru_k_replacer.h"
 #include "replacer/lru_replacer.h"
+#include "storage/async_io.h"
 #include "storage/disk_manager.h"
 
 const std::string TEST_DB_NAME = "BufferPoolManagerTest_db";  // 以数据库名作为根目录
@@ -142,6 +148,85 @@ std::ostream &operator<<(std::ostream &os, const Rid &rid) {
     return os << '(' << rid.page_no << ", " << rid.slot_no << ')';
 }
 
+TEST(ClockReplacerTest, SampleTest) {
+    ClockReplacer clock_replacer(7);
+
+    // Scenario: unpin six elements, i.e. add them to the replacer.
+    clock_replacer.unpin(1);
+    clock_replacer.unpin(2);
+    clock_replacer.unpin(3);
+    clock_replacer.unpin(4);
+    clock_replacer.unpin(5);
+    clock_replacer.unpin(6);
+    clock_replacer.unpin(1);
+    EXPECT_EQ(6, clock_replacer.Size());
+
+    // Scenario: get three victims from the clock.
+    int value;
+    clock_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+
+    // Scenario: pin elements in the replacer.
+    // Note that 3 has already been victimized, so pinning 3 should have no effect.
+    clock_replacer.pin(3);
+    clock_replacer.pin(4);
+    EXPECT_EQ(2, clock_replacer.Size());
+
+    // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
+    clock_replacer.unpin(4);
+
+    // Scenario: continue looking for victims. 4 gets a second chance because of its reference bit.
+    clock_replacer.victim(&value);
+    EXPECT_EQ(5, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(6, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(4, value);
+    EXPECT_FALSE(clock_replacer.victim(&value));
+}
+
+TEST(LRUKReplacerTest, ScanResistance) {
+    // K = 2, 关闭相关访问窗口, 便于精确构造访问序列
+    LRUKReplacer lru_k_replacer(7, 2, 0);
+
+    // Scenario: frames 1 and 2 are accessed twice, they enter the cache queue.
+    for (int i = 0; i < 2; i++) {
+        lru_k_replacer.pin(1);
+        lru_k_replacer.unpin(1);
+        lru_k_replacer.pin(2);
+        lru_k_replacer.unpin(2);
+    }
+
+    // Scenario: a scan touches frames 3, 4, 5 once each, they stay in the history queue.
+    for (int frame_id = 3; frame_id <= 5; frame_id++) {
+        lru_k_replacer.pin(frame_id);
+        lru_k_replacer.unpin(frame_id);
+    }
+    EXPECT_EQ(5, lru_k_replacer.Size());
+
+    // Scenario: victims come from the history queue first, in LRU order.
+    int value;
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(4, value);
+
+    // Scenario: removing a frame forgets it.
+    lru_k_replacer.remove(5);
+    EXPECT_EQ(2, lru_k_replacer.Size());
+
+    // Scenario: the cache queue is ordered by the K-th most recent access.
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(lru_k_replacer.victim(&value));
+}
+
 /** 注意：每个测试点只测试了单个文件！
  * 对于每个测试点，先创建和进入目录TEST_DB_NAME
  * 然后在此目录下创建和打开文件TEST_FILE_NAME_BIG，记录其文件描述符fd */
@@ -191,6 +276,155 @@ class BigStorageTest : public ::testing::Test {
     };
 };
 
+TEST_F(BigStorageTest, AsyncIOTest) {
+    const int num_pages = 64;
+    std::vector<std::unique_ptr<AsyncIO>> engines;
+    // 队列深度小于请求数, 覆盖提交队列写满后等待收割的情况
+    auto uring = std::make_unique<UringIO>(8);
+    if (uring->is_valid()) {
+        engines.push_back(std::move(uring));
+    }
+    engines.push_back(std::make_unique<ThreadPoolIO>(2));
+
+    std::vector<char> write_buf(num_pages * PAGE_SIZE);
+    std::vector<char> read_buf(num_pages * PAGE_SIZE);
+    for (auto &engine : engines) {
+        // Scenario: write every page with its own request in one batch.
+        rand_buf(write_buf.size(), write_buf.data());
+        IOBatch write_batch;
+        for (int i = 0; i < num_pages; i++) {
+            write_batch.add_write(fd_, i, write_buf.data() + i * PAGE_SIZE, PAGE_SIZE);
+        }
+        engine->submit(&write_batch);
+        write_batch.wait();
+        EXPECT_TRUE(write_batch.is_done());
+
+        // Scenario: read the file back with one request covering half of it and single-page requests for the rest.
+        IOBatch read_batch;
+        read_batch.add_read(fd_, 0, read_buf.data(), num_pages / 2 * PAGE_SIZE);
+        for (int i = num_pages / 2; i < num_pages; i++) {
+            read_batch.add_read(fd_, i, read_buf.data() + i * PAGE_SIZE, PAGE_SIZE);
+        }
+        engine->submit(&read_batch);
+        read_batch.wait();
+        EXPECT_EQ(0, memcmp(write_buf.data(), read_buf.data(), write_buf.size())) << engine->name();
+
+        // Scenario: reading past the end of file is a short read, and wait reports it.
+        IOBatch eof_batch;
+        eof_batch.add_read(fd_, num_pages, read_buf.data(), PAGE_SIZE);
+        engine->submit(&eof_batch);
+        EXPECT_THROW(eof_batch.wait(), InternalError) << engine->name();
+    }
+}
+
+TEST(UringIOTest, ReaperError) {
+    auto uring = std::make_unique<UringIO>(8);
+    if (!uring->is_valid()) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    int done_pipe[2];
+    int stuck_pipe[2];
+    ASSERT_EQ(pipe(done_pipe), 0);
+    ASSERT_EQ(pipe(stuck_pipe), 0);
+    std::vector<char> read_buf(2 * PAGE_SIZE);
+    std::vector<char> write_buf(PAGE_SIZE, 'x');
+
+    // Scenario: two reads are in flight; nothing is ever written to the second pipe.
+    IOBatch done_batch;
+    IOBatch stuck_batch;
+    done_batch.add_read(done_pipe[0], 0, read_buf.data(), PAGE_SIZE);
+    stuck_batch.add_read(stuck_pipe[0], 0, read_buf.data() + PAGE_SIZE, PAGE_SIZE);
+    uring->submit(&done_batch);
+    uring->submit(&stuck_batch);
+
+    // Scenario: with the ring fd invalidated, the reaper's next io_uring_enter fails with EBADF once it wakes up
+    // for the first read. It fails the read still in flight and stops instead of retrying forever.
+    int ring_fd = uring->ring_fd_;
+    uring->ring_fd_ = -1;
+    ASSERT_EQ(write(done_pipe[1], write_buf.data(), PAGE_SIZE), PAGE_SIZE);
+    EXPECT_THROW(stuck_batch.wait(), InternalError);
+    done_batch.drain();
+    EXPECT_EQ(uring->reap_error_, EBADF);
+    EXPECT_TRUE(uring->inflight_requests_.empty());
+
+    // Scenario: later submissions fail right away instead of waiting for a reaper that has stopped.
+    IOBatch late_batch;
+    late_batch.add_read(done_pipe[0], 0, read_buf.data(), PAGE_SIZE);
+    EXPECT_THROW(uring->submit(&late_batch), UnixError);
+    EXPECT_TRUE(late_batch.is_done());
+
+    uring->ring_fd_ = ring_fd;
+    uring.reset();
+    for (int fd : {done_pipe[0], done_pipe[1], stuck_pipe[0], stuck_pipe[1]}) {
+        close(fd);
+    }
+}
+
+TEST_F(BigStorageTest, DirectIOTest) {
+    // 以O_DIRECT重新打开测试文件; 文件系统不支持O_DIRECT时退化为普通读写, 下面的读写语义不变
+    disk_manager_->close_file(fd_);
+    disk_manager_->set_direct_io(true);
+    fd_ = disk_manager_->open_file(TEST_FILE_NAME_BIG);
+    disk_manager_->set_fd2pageno(fd_, 0);
+    const int num_pages = 8;
+
+    // Scenario: pages go through buffer pool frames, which are aligned, and are written back on eviction.
+    {
+        BufferPoolManager bpm(num_pages / 2, disk_manager_.get());
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm.new_page(&page_id);
+            ASSERT_NE(page, nullptr);
+            ASSERT_EQ(page_id.page_no, i);
+            memset(page->get_data(), 'a' + i, PAGE_SIZE);
+            bpm.unpin_page(page_id, true);
+        }
+        for (int i = 0; i < num_pages; i++) {
+            Page *page = bpm.fetch_page({fd_, i});
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(page->get_data()[0], 'a' + i);
+            EXPECT_EQ(page->get_data()[PAGE_SIZE - 1], 'a' + i);
+            bpm.unpin_page({fd_, i}, false);
+        }
+        bpm.flush_all_pages(fd_);
+    }
+
+    // Scenario: a read-ahead reads the file with one batch through its staging buffer, without falling back to
+    // single-page reads.
+    {
+        BufferPoolManager bpm(num_pages, disk_manager_.get());
+        bpm.read_ahead(fd_, 0, num_pages);
+        EXPECT_EQ(0, bpm.read_fallbacks_);
+        for (int i = 0; i < num_pages; i++) {
+            Page *page = bpm.fetch_page({fd_, i});
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(page->get_data()[PAGE_SIZE - 1], 'a' + i);
+            bpm.unpin_page({fd_, i}, false);
+        }
+    }
+
+    // Scenario: a header smaller than a page, written from an unaligned buffer, leaves the rest of the page intact.
+    std::vector<char> buf(PAGE_SIZE + 1);
+    char *hdr = buf.data() + 1;
+    memset(hdr, 'z', 20);
+    disk_manager_->write_page(fd_, 2, hdr, 20);
+    memset(hdr, 0, PAGE_SIZE);
+    disk_manager_->read_page(fd_, 2, hdr, 20);
+    EXPECT_EQ(std::string(hdr, 20), std::string(20, 'z'));
+    disk_manager_->read_page(fd_, 2, hdr, PAGE_SIZE);
+    EXPECT_EQ(hdr[19], 'z');
+    EXPECT_EQ(hdr[20], 'c');
+    EXPECT_EQ(hdr[PAGE_SIZE - 1], 'c');
+
+    // Scenario: a partial write past the end of file zero-fills the rest of the page.
+    memset(hdr, 'z', 20);
+    disk_manager_->write_page(fd_, num_pages, hdr, 20);
+    disk_manager_->read_page(fd_, num_pages, hdr, PAGE_SIZE);
+    EXPECT_EQ(hdr[19], 'z');
+    EXPECT_EQ(hdr[20], 0);
+    EXPECT_EQ(hdr[PAGE_SIZE - 1], 0);
+}
+
 TEST(LRUReplacerTest, SampleTest) {
     LRUReplacer lru_replacer(7);
 
@@ -328,6 +562,402 @@ TEST_F(BufferPoolManagerTest, SampleTest) {
     bpm->flush_all_pages(fd);
 }
 
+// NOLINTNEXTLINE
+TEST_F(BufferPoolManagerTest, PageCleanerTest) {
+    // 缓冲池大小为40时, 后台写线程在LRU尾部保持40 * PAGE_CLEANER_CLEAN_RATIO = 2个干净帧
+    const size_t buffer_pool_size = 40;
+    const int clean_target = static_cast<int>(buffer_pool_size * PAGE_CLEANER_CLEAN_RATIO);
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager, nullptr, "LRU");
+    int fd = BufferPoolManagerTest::fd_;
+
+    // Scenario: fill the buffer pool with dirty pages, unpinned in page order so page 0 is at the LRU tail.
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        PageId page_id_temp = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto *page = bpm->new_page(&page_id_temp);
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page %zu", i);
+    }
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, static_cast<int>(i)}, true));
+    }
+
+    // Scenario: after a cleaning round only the pages at the LRU tail are written back.
+    bpm->clean_victim_frames();
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        Page *page = bpm->pages_ + i;
+        EXPECT_EQ(page->get_page_id().page_no >= clean_target, page->is_dirty());
+    }
+
+    // Scenario: the written pages are on disk.
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < clean_target; ++i) {
+        disk_manager->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(0, strcmp(buf, ("page " + std::to_string(i)).c_str()));
+    }
+}
+
+// NOLINTNEXTLINE
+TEST_F(BufferPoolManagerTest, ReadAheadTest) {
+    const int num_pages = 100;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    int fd = BufferPoolManagerTest::fd_;
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(num_pages, disk_manager, nullptr);
+        for (int i = 0; i < num_pages; ++i) {
+            PageId page_id_temp = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            auto *page = bpm->new_page(&page_id_temp);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "page %d", i);
+            bpm->unpin_page(page_id_temp, true);
+        }
+        bpm->flush_all_pages(fd);
+    }
+
+    // Scenario: after a synchronous read-ahead every page is a hit and holds the data on disk.
+    auto bpm = std::make_unique<BufferPoolManager>(num_pages * 2, disk_manager, nullptr);
+    bpm->read_ahead(fd, 0, num_pages / 2);
+    for (int i = 0; i < num_pages / 2; ++i) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        EXPECT_EQ(0, strcmp(page->get_data(), ("page " + std::to_string(i)).c_str()));
+        bpm->unpin_page(PageId{fd, i}, false);
+    }
+    size_t hits, misses;
+    bpm->get_stats(&hits, &misses);
+    EXPECT_EQ(num_pages / 2, hits);
+    EXPECT_EQ(0, misses);
+
+    // Scenario: fetching pages while an asynchronous read-ahead is still reading them returns the right data.
+    // The request reaches past the end of the file, only the allocated pages are read.
+    bpm->prefetch_pages(fd, num_pages / 2, num_pages);
+    for (int i = num_pages / 2; i < num_pages; ++i) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        EXPECT_EQ(0, strcmp(page->get_data(), ("page " + std::to_string(i)).c_str()));
+        bpm->unpin_page(PageId{fd, i}, false);
+    }
+
+    // Scenario: pages allocated but never written are short reads. Whether fetch_page waits on the failed read-ahead
+    // or misses and reads the page itself, it throws instead of returning a zeroed page, and no frame stays pinned.
+    disk_manager->set_fd2pageno(fd, num_pages * 2);
+    for (int i = num_pages; i < num_pages * 2; ++i) {
+        bpm->prefetch_pages(fd, i, 1);
+        EXPECT_THROW(bpm->fetch_page(PageId{fd, i}), InternalError);
+    }
+    bpm->cancel_prefetch(fd);
+    disk_manager->set_fd2pageno(fd, num_pages);
+    for (size_t i = 0; i < bpm->pool_size_; ++i) {
+        EXPECT_EQ(0, bpm->pages_[i].pin_count_);
+    }
+    bpm->del_all_pages(fd);
+}
+
+// NOLINTNEXTLINE
+TEST_F(BufferPoolManagerTest, FlushAndDropFileTest) {
+    const int num_pages = 40;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(num_pages * 2, disk_manager, nullptr);
+    int fd = BufferPoolManagerTest::fd_;
+
+    // Scenario: dirty every other run of pages, so the flush has to write several contiguous runs.
+    for (int i = 0; i < num_pages; ++i) {
+        PageId page_id_temp = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        auto *page = bpm->new_page(&page_id_temp);
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page %d", i);
+        bpm->unpin_page(page_id_temp, (i / 5) % 2 == 0);
+    }
+    bpm->flush_all_pages(fd);
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; ++i) {
+        if ((i / 5) % 2 == 0) {
+            disk_manager->read_page(fd, i, buf, PAGE_SIZE);
+            EXPECT_EQ(0, strcmp(buf, ("page " + std::to_string(i)).c_str()));
+        }
+    }
+    for (size_t i = 0; i < bpm->pool_size_; ++i) {
+        EXPECT_FALSE(bpm->pages_[i].is_dirty());
+    }
+
+    // Scenario: dropping the file removes all its pages from the buffer pool.
+    bpm->del_all_pages(fd);
+    for (size_t i = 0; i < bpm->pool_size_; ++i) {
+        EXPECT_EQ(INVALID_PAGE_ID, bpm->pages_[i].get_page_id().page_no);
+    }
+}
+
+TEST_F(BufferPoolManagerTest, ResizeTest) {
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    int fd = BufferPoolManagerTest::fd_;
+    for (std::string replacer_type : {"LRU", "LRUK", "CLOCK"}) {
+        auto bpm = std::make_unique<BufferPoolManager>(16, disk_manager, nullptr, replacer_type, 64);
+        std::vector<PageId> page_ids;
+
+        // Scenario: growing the pool makes room for more pinned pages.
+        for (int i = 0; i < 32; ++i) {
+            PageId page_id_temp = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            auto *page = bpm->new_page(&page_id_temp);
+            if (i == 16) {
+                ASSERT_EQ(nullptr, page);
+                bpm->resize(32);
+                page = bpm->new_page(&page_id_temp);
+            }
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "%s %d", replacer_type.c_str(), i);
+            page_ids.push_back(page_id_temp);
+        }
+        EXPECT_THROW(bpm->resize(0), InternalError);
+        EXPECT_THROW(bpm->resize(65), InternalError);
+
+        // Scenario: shrinking writes back the evicted dirty pages; a pinned page stays until its last unpin.
+        for (int i = 0; i < 31; ++i) {
+            EXPECT_TRUE(bpm->unpin_page(page_ids[i], true));
+        }
+        Page *pinned = bpm->fetch_page(page_ids[31]);
+        frame_id_t pinned_frame = static_cast<frame_id_t>(pinned - bpm->pages_);
+        bpm->resize(4);
+        EXPECT_EQ(4u, bpm->pool_size_.load());
+        char buf[PAGE_SIZE];
+        for (int i = 0; i < 32; ++i) {
+            bool resident = false;
+            for (size_t f = 0; f < 4; ++f) {
+                resident |= bpm->pages_[f].get_page_id() == page_ids[i];
+            }
+            if (!resident && i != 31) {
+                disk_manager->read_page(fd, page_ids[i].page_no, buf, PAGE_SIZE);
+                EXPECT_EQ(replacer_type + " " + std::to_string(i), buf);
+            }
+        }
+        ASSERT_GE(pinned_frame, 4);
+        EXPECT_EQ(page_ids[31], bpm->pages_[pinned_frame].get_page_id());
+        EXPECT_TRUE(bpm->unpin_page(page_ids[31], true));
+        EXPECT_TRUE(bpm->unpin_page(page_ids[31], false));
+        for (size_t f = 4; f < 32; ++f) {
+            EXPECT_EQ(INVALID_PAGE_ID, bpm->pages_[f].get_page_id().page_no);
+        }
+
+        // Scenario: all pages are still readable through the smaller pool, and the pool can grow back.
+        for (int round = 0; round < 2; ++round) {
+            for (int i = 0; i < 32; ++i) {
+                auto *page = bpm->fetch_page(page_ids[i]);
+                ASSERT_NE(nullptr, page);
+                EXPECT_EQ(replacer_type + " " + std::to_string(i), page->get_data());
+                EXPECT_TRUE(bpm->unpin_page(page_ids[i], false));
+            }
+            bpm->resize(64);
+        }
+        bpm->del_all_pages(fd);
+    }
+}
+
+TEST_F(BufferPoolManagerTest, WarmRestartTest) {
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    int fd = BufferPoolManagerTest::fd_;
+    const std::string hot_pages_file = "warm_restart_test.hot";
+    std::vector<PageId> page_ids(20);
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(32, disk_manager, nullptr, "LRU");
+        for (int i = 0; i < 20; ++i) {
+            page_ids[i] = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            auto *page = bpm->new_page(&page_ids[i]);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "warm %d", i);
+            bpm->unpin_page(page_ids[i], true);
+        }
+        for (int i = 4; i >= 0; --i) {
+            bpm->fetch_page(page_ids[i]);
+            bpm->unpin_page(page_ids[i], false);
+        }
+        bpm->fetch_page(page_ids[10]);
+
+        // Scenario: pinned pages come first, then pages from the most to the least recently used.
+        std::vector<PageId> hot;
+        bpm->get_hot_pages(&hot);
+        ASSERT_EQ(20u, hot.size());
+        EXPECT_EQ(page_ids[10], hot[0]);
+        for (int i = 0; i < 5; ++i) {
+            EXPECT_EQ(page_ids[i], hot[i + 1]);
+        }
+        bpm->save_hot_pages(hot_pages_file);
+        bpm->unpin_page(page_ids[10], false);
+        bpm->flush_all_pages(fd);
+    }
+
+    // Scenario: a restarted, smaller pool loads the hottest pages that fit in the background.
+    auto bpm = std::make_unique<BufferPoolManager>(6, disk_manager, nullptr, "LRU");
+    bpm->load_hot_pages(hot_pages_file);
+    std::vector<PageId> expected = {page_ids[10], page_ids[0], page_ids[1], page_ids[2], page_ids[3], page_ids[4]};
+    for (int wait_ms = 0; wait_ms < 5000; wait_ms += 10) {
+        std::vector<PageId> resident;
+        bpm->get_hot_pages(&resident);
+        if (resident.size() == expected.size()) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bpm->reset_stats();
+    for (auto &page_id : expected) {
+        auto *page = bpm->fetch_page(page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ("warm " + std::to_string(page_id.page_no), std::string(page->get_data()));
+        bpm->unpin_page(page_id, false);
+    }
+    size_t hits, misses;
+    bpm->get_stats(&hits, &misses);
+    EXPECT_EQ(expected.size(), hits);
+    EXPECT_EQ(0u, misses);
+    unlink(hot_pages_file.c_str());
+}
+
+TEST(PageArenaTest, SampleTest) {
+    // Scenario: both the huge page and the fallback mapping hand out zeroed, page aligned, adjacent frames.
+    for (bool use_huge_pages : {true, false}) {
+        PageArena arena(100, use_huge_pages);
+        if (!use_huge_pages) {
+            EXPECT_EQ(PageArena::Backing::REGULAR, arena.backing());
+        }
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(arena.page_data(0)) % PAGE_SIZE);
+        for (size_t i = 0; i < arena.num_pages(); ++i) {
+            EXPECT_EQ(arena.page_data(0) + i * PAGE_SIZE, arena.page_data(i));
+            for (size_t j = 0; j < PAGE_SIZE; j += 512) {
+                EXPECT_EQ(0, arena.page_data(i)[j]);
+            }
+            memset(arena.page_data(i), 0xff, PAGE_SIZE);
+        }
+    }
+}
+
+TEST(PageLatchTest, OptimisticReadTest) {
+    // Scenario: a writer keeps two counters of a page equal under the write latch,
+    // lock-free readers must never observe them differing.
+    std::vector<char> data(PAGE_SIZE, 0);
+    Page page;
+    page.data_ = data.data();
+    int64_t *counters = reinterpret_cast<int64_t *>(page.get_data());
+
+    uint64_t version;
+    ASSERT_TRUE(page.read_version(&version));
+    page.Wlatch();
+    uint64_t locked_version;
+    EXPECT_FALSE(page.read_version(&locked_version));
+    page.WUnlatch();
+    EXPECT_FALSE(page.validate_version(version));
+    ASSERT_TRUE(page.read_version(&version));
+    EXPECT_TRUE(page.validate_version(version));
+
+    const int64_t rounds = 20000;
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                int64_t a, b;
+                page.optimistic_read([&]() {
+                    a = counters[0];
+                    b = counters[1];
+                });
+                if (a != b) {
+                    torn++;
+                }
+            }
+        });
+    }
+    for (int64_t i = 1; i <= rounds; ++i) {
+        page.Wlatch();
+        counters[0] = i;
+        counters[1] = i;
+        page.WUnlatch();
+    }
+    stop = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(0, torn.load());
+    EXPECT_EQ(rounds, counters[1]);
+}
+
+TEST(LoadSchedulerTest, SampleTest) {
+    LoadScheduler scheduler;
+    // 等到另一个线程在调度器中阻塞后再继续, 不依赖sleep的时长
+    auto wait_until = [](const std::function<bool()> &cond) {
+        while (!cond()) {
+            std::this_thread::yield();
+        }
+    };
+
+    // Scenario: LOADs and statements on other tables start right away.
+    scheduler.begin_load("t1");
+    scheduler.begin_load("t2");
+    scheduler.begin_statement({"t3"});
+    scheduler.end_statement({"t3"});
+    scheduler.end_load("t2");
+
+    // Scenario: a statement that touches a table being loaded waits until the LOAD ends.
+    std::atomic<bool> load_done{false};
+    bool started_after_load = false;
+    std::thread statement([&]() {
+        scheduler.begin_statement({"t3", "t1"});
+        started_after_load = load_done;
+        scheduler.end_statement({"t3", "t1"});
+    });
+    wait_until([&]() { return scheduler.num_waiting_statements() == 1; });
+    load_done = true;
+    scheduler.end_load("t1");
+    statement.join();
+    EXPECT_TRUE(started_after_load);
+
+    // Scenario: a waiting LOAD goes ahead of statements that arrive after it.
+    std::mutex order_latch;
+    std::vector<std::string> order;
+    auto record = [&](const std::string &name) {
+        std::lock_guard<std::mutex> guard(order_latch);
+        order.push_back(name);
+    };
+    scheduler.begin_statement({"t1"});
+    std::thread load([&]() {
+        scheduler.begin_load("t1");
+        record("load");
+        scheduler.end_load("t1");
+    });
+    wait_until([&]() { return scheduler.num_waiting_loads("t1") == 1; });
+    std::thread late_statement([&]() {
+        scheduler.begin_statement({"t1"});
+        record("statement");
+        scheduler.end_statement({"t1"});
+    });
+    wait_until([&]() { return scheduler.num_waiting_statements() == 1; });
+    record("first statement");
+    scheduler.end_statement({"t1"});
+    load.join();
+    late_statement.join();
+    EXPECT_EQ(order, (std::vector<std::string>{"first statement", "load", "statement"}));
+}
+
+TEST(IxSimdSearchTest, MatchesBinarySearch) {
+    // Scenario: the hybrid binary/SIMD search must agree with std::lower_bound and
+    // std::upper_bound for every length, including targets at INT_MIN and INT_MAX.
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> dist(-100, 100);
+    for (int n = 0; n <= 3 * IX_SIMD_SCAN_KEYS; ++n) {
+        std::vector<int> keys(n);
+        for (auto &key : keys) {
+            key = dist(rng);
+        }
+        std::sort(keys.begin(), keys.end());
+        if (n > 0) {
+            keys.front() = INT32_MIN;
+            keys.back() = INT32_MAX;
+        }
+        for (int target : {INT32_MIN, -101, -50, 0, 1, 50, 101, INT32_MAX}) {
+            EXPECT_EQ(std::lower_bound(keys.begin(), keys.end(), target) - keys.begin(),
+                      ix_int_lower_bound(keys.data(), n, target));
+            EXPECT_EQ(std::upper_bound(keys.begin(), keys.end(), target) - keys.begin(),
+                      ix_int_upper_bound(keys.data(), n, target));
+        }
+    }
+    std::cout << "in-node int search uses " << ix_int_search_impl() << std::endl;
+}
+
 // /** 注意：每个测试点只测试了单个文件！
 //  * 对于每个测试点，先创建和进入目录TEST_DB_NAME
 //  * 然后在此目录下创建和打开文件TEST_FILE_NAME_CCUR，记录其文件描述符fd */